@@ -3326,6 +3326,8 @@ int dsk2nib(const char *name, fileTYPE *f)
 		return 0;
 	}
 
+	if (FileOpenVDiskCached(f, name)) return 1;
+
 	static uint8_t dos_track[SECTORS * SECTOR_SIZE]; // , pro_track[SECTORS * SECTOR_SIZE];
 	static uint8_t raw_track[RAW_TRACK_uint8_tS];
 
@@ -3384,6 +3386,7 @@ int dsk2nib(const char *name, fileTYPE *f)
 	f->size = FileGetSize(f);
 	FileSeekLBA(f, 0);
 	printf("dsk2nib: vdsk size=%llu.\n", f->size);
+	FileStoreVDiskCache(f, name);
 
 	return 1;
 }
@@ -3391,6 +3394,8 @@ int dsk2nib(const char *name, fileTYPE *f)
 //--------------------------------------------------------------------------
 int x2trd(const char *name, fileTYPE *f)
 {
+	if (FileOpenVDiskCached(f, name)) return 1;
+
 	TDiskImage *img = new TDiskImage;
 	img->Open(getFullPath(name), true);
 
@@ -3407,6 +3412,7 @@ int x2trd(const char *name, fileTYPE *f)
 	f->size = FileGetSize(f);
 	FileSeekLBA(f, 0);
 	printf("x2trd: vdsk size=%llu.\n", f->size);
+	FileStoreVDiskCache(f, name);
 
 	return 1;
 }
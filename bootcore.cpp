@@ -15,16 +15,25 @@ extern int xml_load(const char *xml);
 int16_t btimeout;
 char bootcoretype[64];
 
+// Start of the ".rbf" or ".rbf.zst" extension, NULL if there is none.
+static const char *rbf_ext(const char *path)
+{
+	size_t len = strlen(path);
+	if (len > 8 && !strcmp(path + len - 8, ".rbf.zst")) return path + len - 8;
+	if (len > 4 && !strcmp(path + len - 4, ".rbf")) return path + len - 4;
+	return NULL;
+}
+
 bool isExactcoreName(char *path)
 {
 	char *spl = strrchr(path, '.');
-	return (spl && (!strcmp(spl, ".rbf") || !strcmp(spl, ".mra") || !strcmp(spl, ".mgl")));
+	return rbf_ext(path) || (spl && (!strcmp(spl, ".mra") || !strcmp(spl, ".mgl")));
 }
 
 char *getcoreName(char *path)
 {
-	char *spl = strrchr(path, '.');
-	if (spl && !strcmp(spl, ".rbf"))
+	char *spl = (char *)rbf_ext(path);
+	if (spl)
 	{
 		*spl = '\0';
 	}
@@ -125,23 +134,24 @@ char* loadLastcore()
 //
 // Returns:
 //   true if and only if B exactly matches the pattern
-//     "<A>_YYYYMMDD.rbf"
+//     "<A>_YYYYMMDD.rbf" or "<A>_YYYYMMDD.rbf.zst"
 //   where YYYYMMDD consists of 8 decimal digits.
 //   Returns false otherwise, including on NULL inputs.
 bool matchesCore_yyyyMMdd_rbf(const char *A, const char *B)
 {
 
-	static const char *ext = ".rbf";
-
 	if (!A || !B)
 		return false;
 
+	const char *ext = rbf_ext(B);
+	if (!ext)
+		return false;
+
 	size_t a_len = strlen(A);
-	size_t b_len = strlen(B);
-	size_t ext_len = strlen(ext);
+	size_t b_len = ext - B;
 
 	// A + '_' + 8 digits + ".rbf"
-	if (b_len != a_len + 1 + 8 + ext_len)
+	if (b_len != a_len + 1 + 8)
 		return false;
 
 	// Exact A prefix
@@ -152,10 +162,6 @@ bool matchesCore_yyyyMMdd_rbf(const char *A, const char *B)
 	if (B[a_len] != '_')
 		return false;
 
-	// Extension
-	if (strcmp(B + b_len - ext_len, ext) != 0)
-		return false;
-
 	// 8 digits YYYYMMDD
 	const char *digits = B + a_len + 1;
 	for (int i = 0; i < 8; i++)
@@ -238,7 +244,7 @@ static CoreMatch findCore(const char *name, const char *coreName)
 				break;
 			}
 
-			// Dated generic match: <core>_YYYYMMDD.rbf
+			// Dated generic match: <core>_YYYYMMDD.rbf[.zst]
 			if (matchesCore_yyyyMMdd_rbf(coreName, entry->d_name))
 			{
 				CoreMatch dated;
@@ -0,0 +1,168 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+#include <sys/sysmacros.h>
+#include <linux/magic.h>
+
+#include "buffer_pool.h"
+#include "file_io.h"
+
+#define IOBUF_MIN_SHIFT   12
+#define IOBUF_HUGE_SIZE   (2 * 1024 * 1024)
+#define IOBUF_SLOTS       32
+#define IOBUF_KEEP        2    // idle buffers kept per size
+
+#define CIFS_MAGIC        0xFF534D42
+#define SMB2_MAGIC        0xFE534D42
+
+struct iobuf_t
+{
+	void    *ptr;
+	uint8_t  shift;
+	uint8_t  in_use;
+	uint8_t  huge;
+};
+
+static iobuf_t pool[IOBUF_SLOTS] = {};
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void iobuf_free(iobuf_t *b)
+{
+	if (b->huge) munmap(b->ptr, (size_t)1 << b->shift);
+	else free(b->ptr);
+	memset(b, 0, sizeof(*b));
+}
+
+static void *iobuf_alloc(int shift, uint8_t *huge)
+{
+	size_t size = (size_t)1 << shift;
+
+	*huge = 0;
+	if (size >= IOBUF_HUGE_SIZE)
+	{
+		void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (p != MAP_FAILED)
+		{
+			*huge = 1;
+			return p;
+		}
+	}
+
+	void *p = NULL;
+	if (posix_memalign(&p, 4096, size)) return NULL;
+	return p;
+}
+
+void *iobuf_get(size_t size)
+{
+	int shift = IOBUF_MIN_SHIFT;
+	while (((size_t)1 << shift) < size) shift++;
+
+	pthread_mutex_lock(&pool_lock);
+
+	// An idle buffer of this size, else an empty slot, else the slot of an
+	// idle buffer of another size.
+	iobuf_t *slot = NULL;
+	for (int i = 0; i < IOBUF_SLOTS; i++)
+	{
+		iobuf_t *b = &pool[i];
+		if (b->ptr && !b->in_use && b->shift == shift)
+		{
+			b->in_use = 1;
+			pthread_mutex_unlock(&pool_lock);
+			return b->ptr;
+		}
+
+		if (!b->ptr) { if (!slot || slot->ptr) slot = b; }
+		else if (!b->in_use && !slot) slot = b;
+	}
+
+	if (slot && slot->ptr) iobuf_free(slot);
+
+	uint8_t huge;
+	void *p = iobuf_alloc(shift, &huge);
+	if (p && slot)
+	{
+		slot->ptr = p;
+		slot->shift = shift;
+		slot->huge = huge;
+		slot->in_use = 1;
+	}
+	else if (p && huge)
+	{
+		// Untracked buffers are released with free(), so keep them off huge pages.
+		munmap(p, (size_t)1 << shift);
+		if (posix_memalign(&p, 4096, (size_t)1 << shift)) p = NULL;
+	}
+
+	pthread_mutex_unlock(&pool_lock);
+
+	if (!p) printf("iobuf: cannot allocate %zu bytes\n", (size_t)1 << shift);
+	return p;
+}
+
+void iobuf_put(void *buf)
+{
+	if (!buf) return;
+
+	pthread_mutex_lock(&pool_lock);
+
+	iobuf_t *b = NULL;
+	for (int i = 0; i < IOBUF_SLOTS; i++)
+	{
+		if (pool[i].ptr == buf)
+		{
+			b = &pool[i];
+			break;
+		}
+	}
+
+	if (!b)
+	{
+		free(buf);
+	}
+	else
+	{
+		b->in_use = 0;
+
+		int idle = 0;
+		for (int i = 0; i < IOBUF_SLOTS; i++)
+		{
+			if (pool[i].ptr && !pool[i].in_use && pool[i].shift == b->shift) idle++;
+		}
+		if (idle > IOBUF_KEEP) iobuf_free(b);
+	}
+
+	pthread_mutex_unlock(&pool_lock);
+}
+
+size_t iobuf_chunk(fileTYPE *file)
+{
+	// Inflate is the bottleneck for zipped files, not the storage.
+	if (file->zip || !file->filp) return 64 * 1024;
+
+	int fd = fileno(file->filp);
+
+	struct statfs fs;
+	if (!fstatfs(fd, &fs))
+	{
+		uint32_t type = (uint32_t)fs.f_type;
+		if (type == NFS_SUPER_MAGIC || type == CIFS_MAGIC || type == SMB2_MAGIC) return 1024 * 1024;
+	}
+
+	struct stat64 st;
+	if (!fstat64(fd, &st))
+	{
+		// USB mass storage (SCSI disks) streams best in larger requests than
+		// the SD card.
+		unsigned int maj = major(st.st_dev);
+		if (maj == 8 || (maj >= 65 && maj <= 71) || (maj >= 128 && maj <= 135)) return 512 * 1024;
+	}
+
+	return 256 * 1024;
+}
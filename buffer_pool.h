@@ -0,0 +1,20 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <stddef.h>
+
+struct fileTYPE;
+
+// Process-wide pool of page-aligned I/O and conversion buffers.
+//
+// Leases are thread-safe, so a loader can hold two and hand one to the offload
+// core while it fills the other. Sizes round up to a power of two (4KB at
+// least); buffers of 2MB and up are backed by huge pages when the kernel has
+// any reserved. Released buffers are kept for reuse, a couple per size.
+void *iobuf_get(size_t size);
+void  iobuf_put(void *buf);
+
+// Preferred read chunk for a file, by the storage it lives on.
+size_t iobuf_chunk(fileTYPE *file);
+
+#endif
@@ -0,0 +1,240 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "cd.h"
+#include "file_io.h"
+#include "buffer_pool.h"
+
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
+
+// P/Q parity generator of libchdr (C linkage, its header has no guards).
+extern "C" void ecc_generate(uint8_t *sector);
+
+int cd_sgets(char *out, int sz, char **in)
+{
+	*out = 0;
+	do
+	{
+		char *instr = *in;
+		int cnt = 0;
+
+		while (*instr && *instr != 10)
+		{
+			if (*instr == 13)
+			{
+				instr++;
+				continue;
+			}
+
+			if (cnt < sz - 1)
+			{
+				out[cnt++] = *instr;
+				out[cnt] = 0;
+			}
+
+			instr++;
+		}
+
+		if (*instr == 10) instr++;
+		*in = instr;
+	} while (!*out && **in);
+
+	return *out;
+}
+
+char *cd_cue_file(char *path, int path_sz, char *arg)
+{
+	char *ptr = path + strlen(path) - 1;
+	while ((ptr - path) && (*ptr != '/') && (*ptr != '\\')) ptr--;
+	if (ptr - path) ptr++;
+
+	while (*arg == 0x20) arg++;
+
+	char *end = path + path_sz - 1;
+	if (*arg == '\"')
+	{
+		arg++;
+		while (*arg && (*arg != '\"') && (ptr < end)) *ptr++ = *arg++;
+	}
+	else
+	{
+		while (*arg && (*arg != 0x20) && (ptr < end)) *ptr++ = *arg++;
+	}
+	*ptr = 0;
+
+	return arg;
+}
+
+int cd_format_size(int format)
+{
+	switch (format)
+	{
+	case CD_FMT_RAW:   return 2352;
+	case CD_FMT_MODE1:
+	case CD_FMT_MODE2: return 2048;
+	case CD_FMT_SUB:   return 96;
+	}
+	return 0;
+}
+
+int cd_sector_slice(int sector_size, int format, int *src_ofs, int *dst_ofs, int *len)
+{
+	*src_ofs = 0;
+	*dst_ofs = 0;
+	*len = 2048;
+
+	switch (format)
+	{
+	case CD_FMT_RAW:
+		if (sector_size != 2352) *dst_ofs = 16;
+		*len = sector_size;
+		return 1;
+
+	case CD_FMT_MODE1:
+		if (sector_size == 2352) *src_ofs = 16;
+		return sector_size != 2336;
+
+	case CD_FMT_MODE2:
+		if (sector_size == 2352) *src_ofs = 24;
+		else if (sector_size == 2336) *src_ofs = 8;
+		return 1;
+
+	case CD_FMT_SUB:
+		// subcode is only kept with the sectors in CHD frames
+		*src_ofs = 2352;
+		*len = 96;
+		return sector_size == 2352;
+	}
+
+	return 0;
+}
+
+int cd_read_sectors(fileTYPE *f, __off64_t pos, int sector_size, int count, int format, uint8_t *dst)
+{
+	int src_ofs, dst_ofs, len;
+	if (count <= 0 || format == CD_FMT_SUB || !cd_sector_slice(sector_size, format, &src_ofs, &dst_ofs, &len)) return 0;
+
+	int stride = cd_format_size(format);
+
+	// whole sectors packed back to back: straight into the destination.
+	if (len == sector_size && stride == sector_size)
+	{
+		if (!FileSeek(f, pos, SEEK_SET)) return 0;
+		return FileReadAdv(f, dst, count * sector_size) / sector_size;
+	}
+
+	if (count == 1)
+	{
+		if (!FileSeek(f, pos + src_ofs, SEEK_SET)) return 0;
+		return FileReadAdv(f, dst + dst_ofs, len) == len;
+	}
+
+	// a run of sectors is read once and then sliced.
+	uint8_t *tmp = (uint8_t *)iobuf_get(count * sector_size);
+	if (!tmp) return 0;
+
+	int res = 0;
+	if (FileSeek(f, pos, SEEK_SET))
+	{
+		res = FileReadAdv(f, tmp, count * sector_size) / sector_size;
+		for (int i = 0; i < res; i++) memcpy(dst + i * stride + dst_ofs, tmp + i * sector_size + src_ofs, len);
+	}
+
+	iobuf_put(tmp);
+	return res;
+}
+
+// EDC lookup tables, slice-by-8 like crc32.cpp, built at compile time: the
+// EDC is a reflected CRC-32 with polynomial 0xD8018001 and no inversion.
+struct cd_edc_tables_t
+{
+	uint32_t t[8][256];
+};
+
+static constexpr cd_edc_tables_t cd_edc_make_tables()
+{
+	cd_edc_tables_t tab = {};
+	for (uint32_t i = 0; i < 256; i++)
+	{
+		uint32_t c = i;
+		for (int j = 0; j < 8; j++) c = (c >> 1) ^ ((c & 1) ? 0xD8018001 : 0);
+		tab.t[0][i] = c;
+	}
+
+	for (uint32_t i = 0; i < 256; i++)
+	{
+		for (int k = 1; k < 8; k++) tab.t[k][i] = (tab.t[k - 1][i] >> 8) ^ tab.t[0][tab.t[k - 1][i] & 0xFF];
+	}
+
+	return tab;
+}
+
+static constexpr cd_edc_tables_t cd_edc_tab = cd_edc_make_tables();
+
+uint32_t cd_edc(uint32_t edc, const uint8_t *buf, size_t len)
+{
+	const uint8_t *p = buf;
+
+	for (; len && ((uintptr_t)p & 3); len--) edc = cd_edc_tab.t[0][(edc ^ *p++) & 0xFF] ^ (edc >> 8);
+
+	for (; len >= 8; len -= 8, p += 8)
+	{
+		uint32_t lo, hi;
+		memcpy(&lo, p, 4);
+		memcpy(&hi, p + 4, 4);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+		lo = __builtin_bswap32(lo);
+		hi = __builtin_bswap32(hi);
+#endif
+		lo ^= edc;
+		edc = cd_edc_tab.t[7][lo & 0xFF] ^ cd_edc_tab.t[6][(lo >> 8) & 0xFF] ^
+		      cd_edc_tab.t[5][(lo >> 16) & 0xFF] ^ cd_edc_tab.t[4][lo >> 24] ^
+		      cd_edc_tab.t[3][hi & 0xFF] ^ cd_edc_tab.t[2][(hi >> 8) & 0xFF] ^
+		      cd_edc_tab.t[1][(hi >> 16) & 0xFF] ^ cd_edc_tab.t[0][hi >> 24];
+	}
+
+	while (len--) edc = cd_edc_tab.t[0][(edc ^ *p++) & 0xFF] ^ (edc >> 8);
+
+	return edc;
+}
+
+void cd_make_mode1_sector(uint8_t *sector, int lba)
+{
+	static const uint8_t sync[12] = { 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00 };
+	memcpy(sector, sync, sizeof(sync));
+
+	lba += 150;
+	sector[12] = BCD(lba / (75 * 60));
+	sector[13] = BCD((lba / 75) % 60);
+	sector[14] = BCD(lba % 75);
+	sector[15] = 0x01;
+
+	uint32_t edc = cd_edc(0, sector, 2064);
+	sector[2064] = edc >> 0;
+	sector[2065] = edc >> 8;
+	sector[2066] = edc >> 16;
+	sector[2067] = edc >> 24;
+	memset(sector + 2068, 0, 8);
+
+	ecc_generate(sector);
+}
+
+void cd_swap16(uint8_t *buf, int len)
+{
+	int i = 0;
+
+#ifdef __ARM_NEON
+	for (; i + 16 <= len; i += 16) vst1q_u8(buf + i, vrev16q_u8(vld1q_u8(buf + i)));
+#endif
+
+	for (; i + 1 < len; i += 2)
+	{
+		uint8_t temp = buf[i];
+		buf[i] = buf[i + 1];
+		buf[i + 1] = temp;
+	}
+}
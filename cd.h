@@ -78,4 +78,42 @@ typedef struct
 
 typedef int (*SendDataFunc) (uint8_t* buf, int len, uint8_t index);
 
+// Shared pieces of the per-core CUE parsers.
+// cd_sgets() returns the next non-empty line of a loaded CUE sheet.
+// cd_cue_file() replaces the file name part of path with the argument of a
+// FILE command (quoted or not), returning the rest of the line.
+int cd_sgets(char *out, int sz, char **in);
+char *cd_cue_file(char *path, int path_sz, char *arg);
+
+// Sector layouts returned by the sector readers.
+enum CDSectorFormat {
+	CD_FMT_RAW,   // 2352 bytes, 2048-byte images leave the header untouched
+	CD_FMT_MODE1, // 2048 bytes of user data
+	CD_FMT_MODE2, // 2048 bytes of form 1 user data
+	CD_FMT_SUB,   // 96 bytes of subcode (CHD only)
+};
+
+int cd_format_size(int format);
+
+// Where a sector of sector_size bytes (2048, 2336 or 2352) keeps the data of
+// the given format: source offset, destination offset and length.
+int cd_sector_slice(int sector_size, int format, int *src_ofs, int *dst_ofs, int *len);
+
+// Read count sectors of an image file starting at byte position pos into dst,
+// converted to format, cd_format_size(format) bytes apart. Runs of sectors go
+// out as one read. Returns the number of sectors read.
+int cd_read_sectors(fileTYPE *f, __off64_t pos, int sector_size, int count, int format, uint8_t *dst);
+
+// CD-ROM error detection code over len bytes, chained through edc (start
+// with 0). A Mode 1 sector covers bytes 0-2063, a Mode 2 form 1 sector
+// bytes 16-2071.
+uint32_t cd_edc(uint32_t edc, const uint8_t *buf, size_t len);
+
+// Turn the 2048 bytes at sector + 16 into a complete Mode 1 sector: sync,
+// header for lba (150 frames of lead-in added), EDC and P/Q parity.
+void cd_make_mode1_sector(uint8_t *sector, int lba);
+
+// Swap the bytes of 16-bit samples in place (CHD keeps audio big endian).
+void cd_swap16(uint8_t *buf, int len);
+
 #endif
@@ -8,6 +8,9 @@
 #include <string.h>
 #include <inttypes.h>
 #include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include "cfg.h"
 #include "debug.h"
 #include "file_io.h"
@@ -343,6 +346,31 @@ static void ini_parse_numeric(const ini_var_t *var, const char *text, void *out)
 	}
 }
 
+static void cfg_output_init()
+{
+	if (!orig_stdout) orig_stdout = stdout;
+	if (!dev_null)
+	{
+		dev_null = fopen("/dev/null", "w");
+		if (dev_null)
+		{
+			int null_fd = fileno(dev_null);
+			if (null_fd >= 0) fcntl(null_fd, F_SETFD, FD_CLOEXEC);
+			stdout = dev_null;
+		}
+	}
+}
+
+static void cfg_debug_output()
+{
+	if (cfg.debug == 2 && !debug_file)
+	{
+		debug_file = fopen("/tmp/debug.txt", "w");
+		setvbuf(debug_file, NULL, _IONBF, 0);
+	}
+	stdout = (cfg.debug == 2) ? debug_file : cfg.debug ? orig_stdout : dev_null;
+}
+
 // Used to determine if an array variable should be appended or restarted.
 static bool var_array_append[sizeof(ini_vars) / sizeof(ini_var_t)] = {};
 
@@ -435,12 +463,7 @@ static void ini_parse_var(char* buf)
 			ini_parse_numeric(var, &buf[i], var->var);
 			if (!strcasecmp(var->name, "DEBUG"))
 			{
-				if (cfg.debug == 2 && !debug_file)
-				{
-					debug_file = fopen("/tmp/debug.txt", "w");
-					setvbuf(debug_file, NULL, _IONBF, 0);
-				}
-				stdout = (cfg.debug == 2) ? debug_file : cfg.debug ? orig_stdout : dev_null;
+				cfg_debug_output();
 			}
 			break;
 		}
@@ -453,17 +476,7 @@ static void ini_parse(int alt, const char *vmode)
 	int section = 0;
 	int eof;
 
-	if (!orig_stdout) orig_stdout = stdout;
-	if (!dev_null)
-	{
-		dev_null = fopen("/dev/null", "w");
-		if (dev_null)
-		{
-			int null_fd = fileno(dev_null);
-			if (null_fd >= 0) fcntl(null_fd, F_SETFD, FD_CLOEXEC);
-			stdout = dev_null;
-		}
-	}
+	cfg_output_init();
 
 	ini_parser_debugf("Start INI parser for core \"%s\"(%s), video mode \"%s\".", user_io_get_core_name(0), user_io_get_core_name(1), vmode);
 
@@ -589,8 +602,103 @@ const char* cfg_get_label(uint8_t alt)
 	return label;
 }
 
+// Parsed INI kept in /tmp per core, so the core switches (each one restarts
+// the binary) skip the parse while the INI and the core names are unchanged.
+#define CFG_CACHE_MAGIC 0x43464743 // CFGC
+
+struct cfg_cache_t
+{
+	uint32_t magic;
+	uint32_t size;
+	char key[1024];
+	bool has_video_sections;
+	bool using_video_section;
+	int error_count;
+	char errors[CFG_ERRORS_MAX][CFG_ERRORS_STRLEN];
+	cfg_t cfg;
+};
+
+static cfg_cache_t cfg_cache;
+
+static const char *cfg_cache_name()
+{
+	static char name[300];
+	snprintf(name, sizeof(name), "/tmp/cfg_%s.cache", user_io_get_core_name(0));
+	return name;
+}
+
+static void cfg_cache_key(char *key, int size)
+{
+	const char *name = cfg_get_name(altcfg());
+	struct stat st = {};
+	if (stat(getFullPath(name), &st)) st.st_size = -1;
+
+	// video_get_core_mode_name returns a static buffer
+	char vmode[256];
+	snprintf(vmode, sizeof(vmode), "%s", video_get_core_mode_name(1));
+
+	// the cache holds cfg_t as-is: another build may lay it out differently,
+	// VDATE alone doesn't tell apart two builds of the same day
+	struct stat exe = {};
+	stat("/proc/self/exe", &exe);
+
+	snprintf(key, size, "%s|%lld.%09ld|%s|%lld|%lld.%09ld|%s|%s|%d%d|%s|%s", VDATE,
+		(long long)exe.st_mtim.tv_sec, (long)exe.st_mtim.tv_nsec, name, (long long)st.st_size,
+		(long long)st.st_mtim.tv_sec, (long)st.st_mtim.tv_nsec, user_io_get_core_name(0), user_io_get_core_name(1),
+		is_arcade() ? 1 : 0, arcade_is_vertical() ? 1 : 0, vmode, video_get_core_mode_name(0));
+}
+
+static int cfg_cache_load(const char *key)
+{
+	int fd = open(cfg_cache_name(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) return 0;
+
+	int ok = read(fd, &cfg_cache, sizeof(cfg_cache)) == sizeof(cfg_cache) && cfg_cache.magic == CFG_CACHE_MAGIC &&
+		cfg_cache.size == sizeof(cfg_cache) && !strcmp(cfg_cache.key, key);
+	close(fd);
+	if (!ok) return 0;
+
+	memcpy(&cfg, &cfg_cache.cfg, sizeof(cfg));
+	memcpy(cfg_errors, cfg_cache.errors, sizeof(cfg_errors));
+	cfg_error_count = cfg_cache.error_count;
+	has_video_sections = cfg_cache.has_video_sections;
+	using_video_section = cfg_cache.using_video_section;
+	return 1;
+}
+
+static void cfg_cache_save(const char *key)
+{
+	memset(&cfg_cache, 0, sizeof(cfg_cache));
+	cfg_cache.magic = CFG_CACHE_MAGIC;
+	cfg_cache.size = sizeof(cfg_cache);
+	snprintf(cfg_cache.key, sizeof(cfg_cache.key), "%s", key);
+	cfg_cache.has_video_sections = has_video_sections;
+	cfg_cache.using_video_section = using_video_section;
+	cfg_cache.error_count = cfg_error_count;
+	memcpy(cfg_cache.errors, cfg_errors, sizeof(cfg_errors));
+	memcpy(&cfg_cache.cfg, &cfg, sizeof(cfg));
+
+	int fd = open(cfg_cache_name(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0) return;
+
+	int ok = write(fd, &cfg_cache, sizeof(cfg_cache)) == sizeof(cfg_cache);
+	close(fd);
+	if (!ok) unlink(cfg_cache_name());
+}
+
 void cfg_parse()
 {
+	static char key[1024];
+	cfg_cache_key(key, sizeof(key));
+
+	cfg_output_init();
+	if (cfg_cache_load(key))
+	{
+		cfg_debug_output();
+		printf("Using cached %s\n", cfg_get_name(altcfg()));
+		return;
+	}
+
 	memset(&cfg, 0, sizeof(cfg));
 	cfg.csync = 1;
 	cfg.bootscreen = 1;
@@ -638,6 +746,7 @@ void cfg_parse()
 		}
 	}
 
+	cfg_cache_save(key);
 }
 
 bool cfg_has_video_sections()
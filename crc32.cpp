@@ -0,0 +1,90 @@
+#include <string.h>
+
+#include "crc32.h"
+
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+// Slice-by-8 lookup tables, built at compile time. Table 0 is the classic
+// byte-at-a-time table; table k advances a byte that sits k positions further
+// back, so eight input bytes are folded in with eight independent lookups.
+struct crc32_tables_t
+{
+	uint32_t t[8][256];
+};
+
+static constexpr crc32_tables_t crc32_make_tables()
+{
+	crc32_tables_t tab = {};
+	for (uint32_t i = 0; i < 256; i++)
+	{
+		uint32_t c = i;
+		for (int j = 0; j < 8; j++) c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+		tab.t[0][i] = c;
+	}
+
+	for (uint32_t i = 0; i < 256; i++)
+	{
+		for (int k = 1; k < 8; k++) tab.t[k][i] = (tab.t[k - 1][i] >> 8) ^ tab.t[0][tab.t[k - 1][i] & 0xFF];
+	}
+
+	return tab;
+}
+
+static constexpr crc32_tables_t crc32_tab = crc32_make_tables();
+
+static_assert(crc32_tab.t[0][1] == 0x77073096, "CRC-32 table");
+
+#if defined(__ARM_FEATURE_CRC32)
+
+// ARMv8 builds have the CRC32 instructions, which beat any table.
+uint32_t crc32_update(uint32_t crc, const void *data, size_t len)
+{
+	const uint8_t *p = (const uint8_t *)data;
+	crc = ~crc;
+
+	for (; len && ((uintptr_t)p & 3); len--) crc = __crc32b(crc, *p++);
+	for (; len >= 4; len -= 4, p += 4)
+	{
+		uint32_t w;
+		memcpy(&w, p, 4);
+		crc = __crc32w(crc, w);
+	}
+	while (len--) crc = __crc32b(crc, *p++);
+
+	return ~crc;
+}
+
+#else
+
+uint32_t crc32_update(uint32_t crc, const void *data, size_t len)
+{
+	const uint8_t *p = (const uint8_t *)data;
+	crc = ~crc;
+
+	// Align to 4 bytes so the word loads below are cheap on ARMv7.
+	for (; len && ((uintptr_t)p & 3); len--) crc = crc32_tab.t[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+
+	for (; len >= 8; len -= 8, p += 8)
+	{
+		uint32_t lo, hi;
+		memcpy(&lo, p, 4);
+		memcpy(&hi, p + 4, 4);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+		lo = __builtin_bswap32(lo);
+		hi = __builtin_bswap32(hi);
+#endif
+		lo ^= crc;
+		crc = crc32_tab.t[7][lo & 0xFF] ^ crc32_tab.t[6][(lo >> 8) & 0xFF] ^
+		      crc32_tab.t[5][(lo >> 16) & 0xFF] ^ crc32_tab.t[4][lo >> 24] ^
+		      crc32_tab.t[3][hi & 0xFF] ^ crc32_tab.t[2][(hi >> 8) & 0xFF] ^
+		      crc32_tab.t[1][(hi >> 16) & 0xFF] ^ crc32_tab.t[0][hi >> 24];
+	}
+
+	while (len--) crc = crc32_tab.t[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+
+	return ~crc;
+}
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// CRC-32 (IEEE 802.3, reflected polynomial 0xEDB88320), the one used by zip,
+// zlib, Ethernet FCS, WOZ and UDI images.
+//
+// Same calling convention as zlib's crc32(): start from 0 and pass the
+// previous result back in to continue over further buffers.
+uint32_t crc32_update(uint32_t crc, const void *data, size_t len);
+
+#endif
@@ -0,0 +1,278 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/syscall.h>
+
+#if __has_include(<linux/io_uring.h>) && defined(__NR_io_uring_setup)
+#include <linux/io_uring.h>
+#define HAVE_IO_URING
+#endif
+
+#include "file_async.h"
+
+#define ASYNC_FREE    0
+#define ASYNC_PENDING 1
+#define ASYNC_DONE    2
+
+struct asyncReq
+{
+	uint32_t     gen;
+	volatile int state;
+	int          res;
+	int          fd;
+	__off64_t    offset;
+	struct iovec iov;
+};
+
+static asyncReq reqs[FILE_ASYNC_MAX] = {};
+static uint32_t req_gen = 0;
+
+// Backend selected on first use: 1 - io_uring, 2 - worker thread.
+static int backend = 0;
+
+static asyncReq *req_get(int id)
+{
+	int n = (id & 0xFF) - 1;
+	if (n < 0 || n >= FILE_ASYNC_MAX) return NULL;
+	asyncReq *r = &reqs[n];
+	return (r->state != ASYNC_FREE && r->gen == (uint32_t)(id >> 8)) ? r : NULL;
+}
+
+#ifdef HAVE_IO_URING
+
+// Minimal io_uring, driven through the raw syscalls: one ring, READV only.
+static struct
+{
+	int fd;
+	unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+	unsigned *cq_head, *cq_tail, *cq_mask;
+	struct io_uring_sqe *sqes;
+	struct io_uring_cqe *cqes;
+} ring = {};
+
+static int uring_init()
+{
+	struct io_uring_params p = {};
+	int fd = syscall(__NR_io_uring_setup, FILE_ASYNC_MAX, &p);
+	if (fd < 0) return 0;
+
+	size_t sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	size_t cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP) sq_size = cq_size = (sq_size > cq_size) ? sq_size : cq_size;
+
+	uint8_t *sq = (uint8_t *)mmap(0, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+	uint8_t *cq = sq;
+	if (sq != MAP_FAILED && !(p.features & IORING_FEAT_SINGLE_MMAP))
+	{
+		cq = (uint8_t *)mmap(0, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+	}
+
+	void *sqes = mmap(0, p.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+	if (sq == MAP_FAILED || cq == MAP_FAILED || sqes == MAP_FAILED)
+	{
+		close(fd);
+		return 0;
+	}
+
+	ring.fd = fd;
+	ring.sq_head = (unsigned *)(sq + p.sq_off.head);
+	ring.sq_tail = (unsigned *)(sq + p.sq_off.tail);
+	ring.sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+	ring.sq_array = (unsigned *)(sq + p.sq_off.array);
+	ring.cq_head = (unsigned *)(cq + p.cq_off.head);
+	ring.cq_tail = (unsigned *)(cq + p.cq_off.tail);
+	ring.cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+	ring.cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+	ring.sqes = (struct io_uring_sqe *)sqes;
+	return 1;
+}
+
+static int uring_submit(int n)
+{
+	asyncReq *r = &reqs[n];
+
+	unsigned tail = *ring.sq_tail;
+	unsigned idx = tail & *ring.sq_mask;
+	struct io_uring_sqe *sqe = &ring.sqes[idx];
+
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = IORING_OP_READV;
+	sqe->fd = r->fd;
+	sqe->off = r->offset;
+	sqe->addr = (uint64_t)(uintptr_t)&r->iov;
+	sqe->len = 1;
+	sqe->user_data = n;
+
+	ring.sq_array[idx] = idx;
+	__atomic_store_n(ring.sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+	return syscall(__NR_io_uring_enter, ring.fd, 1, 0, 0, NULL, 0) == 1;
+}
+
+static void uring_reap(int wait)
+{
+	if (wait) syscall(__NR_io_uring_enter, ring.fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+
+	unsigned head = *ring.cq_head;
+	while (head != __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE))
+	{
+		struct io_uring_cqe *cqe = &ring.cqes[head & *ring.cq_mask];
+		asyncReq *r = &reqs[cqe->user_data];
+		r->res = cqe->res;
+		r->state = ASYNC_DONE;
+		head++;
+	}
+	__atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+}
+
+#endif
+
+// Worker thread fallback.
+static pthread_mutex_t worker_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t worker_cond = PTHREAD_COND_INITIALIZER;
+static int worker_queue[FILE_ASYNC_MAX];
+static int worker_head = 0, worker_tail = 0;
+
+static void *worker_thread(void *)
+{
+	pthread_mutex_lock(&worker_lock);
+	while (1)
+	{
+		if (worker_head == worker_tail)
+		{
+			pthread_cond_wait(&worker_cond, &worker_lock);
+			continue;
+		}
+
+		asyncReq *r = &reqs[worker_queue[worker_tail++ % FILE_ASYNC_MAX]];
+		pthread_mutex_unlock(&worker_lock);
+
+		ssize_t res = preadv64(r->fd, &r->iov, 1, r->offset);
+
+		pthread_mutex_lock(&worker_lock);
+		r->res = (res < 0) ? -errno : res;
+		r->state = ASYNC_DONE;
+		pthread_cond_broadcast(&worker_cond);
+	}
+
+	return NULL;
+}
+
+static int worker_init()
+{
+	pthread_attr_t attr;
+	pthread_attr_init(&attr);
+
+	// Stay off core #1 (main)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(0, &set);
+	pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+
+	pthread_t tid;
+	int ok = !pthread_create(&tid, &attr, worker_thread, NULL);
+	if (ok) pthread_detach(tid);
+
+	pthread_attr_destroy(&attr);
+	return ok;
+}
+
+static int async_init()
+{
+	if (!backend)
+	{
+		backend = -1;
+#ifdef HAVE_IO_URING
+		if (uring_init()) backend = 1;
+#endif
+		if (backend < 0 && worker_init()) backend = 2;
+		printf("File async backend: %s\n", (backend == 1) ? "io_uring" : (backend == 2) ? "thread" : "none");
+	}
+
+	return backend > 0;
+}
+
+int FileReadAsync(fileTYPE *file, __off64_t offset, void *buf, int length)
+{
+	int n = 0;
+	while (n < FILE_ASYNC_MAX && reqs[n].state != ASYNC_FREE) n++;
+	if (n >= FILE_ASYNC_MAX) return 0;
+
+	asyncReq *r = &reqs[n];
+	r->gen = ++req_gen & 0xFFFFFF;
+	r->offset = offset;
+	r->iov.iov_base = buf;
+	r->iov.iov_len = length;
+
+	// Zipped entries have no fd to read from: inflate now, keeping the file's position.
+	if (!file->filp || file->zip || !async_init())
+	{
+		__off64_t pos = file->offset;
+		r->res = (FileSeek(file, offset, SEEK_SET)) ? FileReadAdv(file, buf, length, -1) : -1;
+		FileSeek(file, pos, SEEK_SET);
+		r->state = ASYNC_DONE;
+		return (r->gen << 8) | (n + 1);
+	}
+
+	r->fd = fileno(file->filp);
+	r->state = ASYNC_PENDING;
+
+#ifdef HAVE_IO_URING
+	if (backend == 1)
+	{
+		if (!uring_submit(n))
+		{
+			r->state = ASYNC_FREE;
+			return 0;
+		}
+		return (r->gen << 8) | (n + 1);
+	}
+#endif
+
+	pthread_mutex_lock(&worker_lock);
+	worker_queue[worker_head++ % FILE_ASYNC_MAX] = n;
+	pthread_cond_broadcast(&worker_cond);
+	pthread_mutex_unlock(&worker_lock);
+
+	return (r->gen << 8) | (n + 1);
+}
+
+int FileAsyncReady(int id)
+{
+	asyncReq *r = req_get(id);
+	if (!r) return 1;
+
+#ifdef HAVE_IO_URING
+	if (backend == 1 && r->state == ASYNC_PENDING) uring_reap(0);
+#endif
+
+	return r->state == ASYNC_DONE;
+}
+
+int FileAsyncWait(int id)
+{
+	asyncReq *r = req_get(id);
+	if (!r) return -1;
+
+#ifdef HAVE_IO_URING
+	if (backend == 1)
+	{
+		while (r->state == ASYNC_PENDING) uring_reap(1);
+	}
+	else
+#endif
+	{
+		pthread_mutex_lock(&worker_lock);
+		while (r->state == ASYNC_PENDING) pthread_cond_wait(&worker_cond, &worker_lock);
+		pthread_mutex_unlock(&worker_lock);
+	}
+
+	int res = (r->res < 0) ? -1 : r->res;
+	r->state = ASYNC_FREE;
+	return res;
+}
@@ -0,0 +1,26 @@
+#ifndef FILE_ASYNC_H
+#define FILE_ASYNC_H
+
+#include <stdint.h>
+#include "file_io.h"
+
+// Asynchronous reads on opened files, next to the synchronous FileReadAdv().
+//
+// Requests go to io_uring when the kernel has it, else to a worker thread on
+// core #0. A read never touches the file's own position, so a handler can
+// queue the next sectors while it still serves the current ones with the
+// synchronous calls. Entries inside a zip are read synchronously at submit.
+//
+// Main thread only. Every request has to be collected with FileAsyncWait().
+#define FILE_ASYNC_MAX 16
+
+// Returns a request id, or 0 if the request could not be queued.
+int FileReadAsync(fileTYPE *file, __off64_t offset, void *buf, int length);
+
+// Non-zero once the request has completed.
+int FileAsyncReady(int id);
+
+// Wait for the request and release it. Returns the bytes read, -1 on error.
+int FileAsyncWait(int id);
+
+#endif
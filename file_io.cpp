@@ -15,10 +15,13 @@
 #include <sys/ioctl.h>
 #include <sys/mount.h>
 #include <linux/magic.h>
+#include <pthread.h>
+#include <time.h>
 #include <algorithm>
 #include <vector>
 #include <string>
 #include <set>
+#include <unordered_map>
 #include "lib/miniz/miniz.h"
 #include "osd.h"
 #include "fpga_io.h"
@@ -32,6 +35,8 @@
 #include "miniz.h"
 #include "scheduler.h"
 #include "video.h"
+#include "buffer_pool.h"
+#include "search.h"
 #include "support.h"
 
 #define MIN(a,b) (((a)<(b)) ? (a) : (b))
@@ -135,6 +140,7 @@ fileTYPE::fileTYPE()
 	zip = 0;
 	size = 0;
 	offset = 0;
+	stream = 0;
 }
 
 fileTYPE::~fileTYPE()
@@ -147,14 +153,127 @@ int fileTYPE::opened()
 	return filp || zip;
 }
 
+// Inflate checkpoints: snapshot of the extract iterator (inflator state and
+// 32KB dictionary) taken once per interval while the entry is being read,
+// so seeks only have to inflate from the nearest checkpoint below the target.
+#define ZIP_CP_MIN_INTERVAL (1024 * 1024)
+#define ZIP_CP_MAX_NUM      256
+
+struct zipCheckpoint
+{
+	mz_zip_reader_extract_iter_state state;
+	uint8_t                          *dict;
+};
+
 struct fileZipArchive
 {
 	mz_zip_archive                    archive;
 	int                               index;
 	mz_zip_reader_extract_iter_state* iter;
 	__off64_t                         offset;
+
+	zipCheckpoint*                    cp;
+	int                               cp_num;
+	__off64_t                         cp_interval;
 };
 
+static void zip_checkpoint_init(fileZipArchive *zip)
+{
+	zip->cp = nullptr;
+	zip->cp_num = 0;
+
+	// stored entries are seeked directly, checkpoints assume reading from a file
+	if (zip->iter->file_stat.m_method != MZ_DEFLATED || zip->archive.m_zip_type != MZ_ZIP_TYPE_FILE) return;
+
+	__off64_t size = zip->iter->file_stat.m_uncomp_size;
+	zip->cp_interval = ZIP_CP_MIN_INTERVAL;
+	while (size / zip->cp_interval >= ZIP_CP_MAX_NUM) zip->cp_interval <<= 1;
+
+	zip->cp_num = (int)(size / zip->cp_interval) + 1;
+	zip->cp = (zipCheckpoint*)calloc(zip->cp_num, sizeof(zipCheckpoint));
+	if (!zip->cp) zip->cp_num = 0;
+}
+
+static void zip_checkpoint_free(fileZipArchive *zip)
+{
+	for (int i = 0; i < zip->cp_num; i++) free(zip->cp[i].dict);
+	free(zip->cp);
+	zip->cp = nullptr;
+	zip->cp_num = 0;
+}
+
+static void zip_checkpoint_save(fileZipArchive *zip)
+{
+	mz_zip_reader_extract_iter_state *iter = zip->iter;
+	int k = (int)(zip->offset / zip->cp_interval);
+	if (k >= zip->cp_num || zip->cp[k].dict) return;
+	if (iter->status < 0) return;
+
+	zipCheckpoint *cp = &zip->cp[k];
+	cp->dict = (uint8_t*)malloc(TINFL_LZ_DICT_SIZE);
+	if (!cp->dict) return;
+
+	memcpy(cp->dict, iter->pWrite_buf, TINFL_LZ_DICT_SIZE);
+	cp->state = *iter;
+
+	// unconsumed input will be read again from the archive
+	cp->state.cur_file_ofs -= cp->state.read_buf_avail;
+	cp->state.comp_remaining += cp->state.read_buf_avail;
+	cp->state.read_buf_avail = 0;
+	cp->state.read_buf_ofs = 0;
+}
+
+// Restore the closest checkpoint at or below offset if it gets there faster
+// than inflating forward from the current position.
+static void zip_checkpoint_restore(fileZipArchive *zip, __off64_t offset)
+{
+	int k = (int)(offset / zip->cp_interval);
+	if (k >= zip->cp_num) k = zip->cp_num - 1;
+
+	for (; k >= 0; k--)
+	{
+		zipCheckpoint *cp = &zip->cp[k];
+		if (!cp->dict || (__off64_t)cp->state.out_buf_ofs > offset) continue;
+		if (offset >= zip->offset && (__off64_t)cp->state.out_buf_ofs <= zip->offset) return;
+
+		mz_zip_reader_extract_iter_state *iter = zip->iter;
+		void *read_buf = iter->pRead_buf;
+		void *write_buf = iter->pWrite_buf;
+
+		*iter = cp->state;
+		iter->pRead_buf = read_buf;
+		iter->pWrite_buf = write_buf;
+		memcpy(write_buf, cp->dict, TINFL_LZ_DICT_SIZE);
+
+		zip->offset = iter->out_buf_ofs;
+		return;
+	}
+}
+
+// Read from the zip entry, taking checkpoints at interval boundaries.
+static size_t zip_read(fileZipArchive *zip, void *buf, size_t len)
+{
+	size_t done = 0;
+	while (done < len)
+	{
+		size_t want = len - done;
+		if (zip->cp_num)
+		{
+			__off64_t next = (zip->offset / zip->cp_interval + 1) * zip->cp_interval;
+			want = MIN((__off64_t)want, next - zip->offset);
+		}
+
+		size_t ret = mz_zip_reader_extract_iter_read(zip->iter, (uint8_t*)buf + done, want);
+		zip->offset += ret;
+		done += ret;
+
+		if (zip->cp_num && !(zip->offset % zip->cp_interval)) zip_checkpoint_save(zip);
+		if (ret < want) break;
+	}
+
+	return done;
+}
+
 
 static int OpenZipfileCached(char *path, int flags)
 {
@@ -343,12 +462,19 @@ int FileClose(fileTYPE *file)
 {
 	int err = 0;
 
+	if (file->stream)
+	{
+		FileStreamStop(file->stream);
+		file->stream = 0;
+	}
+
 	if (file->zip)
 	{
 		if (file->zip->iter)
 		{
 			mz_zip_reader_extract_iter_free(file->zip->iter);
 		}
+		zip_checkpoint_free(file->zip);
 		mz_zip_reader_end(&file->zip->archive);
 
 		delete file->zip;
@@ -362,14 +488,7 @@ int FileClose(fileTYPE *file)
 			err = -1;
 			printf("FileClose error on %s (%s).\n", file->name, strerror(errno));
 		}
-		if (file->type == 1)
-		{
-			if (file->name[0] == '/')
-			{
-				shm_unlink(file->name);
-			}
-			file->type = 0;
-		}
+		file->type = 0;
 	}
 
 	file->zip = nullptr;
@@ -455,6 +574,8 @@ int FileOpenZip(fileTYPE *file, const char *name, uint32_t crc32)
 	}
 
 	file->zip->offset = 0;
+	zip_checkpoint_init(file->zip);
+	if (file->zip->cp_num) zip_checkpoint_save(file->zip);
 	file->offset = 0;
 	file->mode = O_RDONLY;
 	return 1;
@@ -519,12 +640,15 @@ int FileOpenEx(fileTYPE *file, const char *name, int mode, char mute, int use_zi
 			return 0;
 		}
 		file->zip->offset = 0;
+		zip_checkpoint_init(file->zip);
+		if (file->zip->cp_num) zip_checkpoint_save(file->zip);
 		file->offset = 0;
 		file->mode = mode;
 	}
 	else
 	{
-		int fd = (mode == -1) ? shm_open("/vdsk", O_CREAT | O_RDWR | O_TRUNC | O_CLOEXEC, 0777) : open(full_path, mode | O_CLOEXEC, 0777);
+		// every virtual disk is a separate anonymous memfd, so several drives can hold converted images at once
+		int fd = (mode == -1) ? memfd_create(name, MFD_CLOEXEC) : open(full_path, mode | O_CLOEXEC, 0777);
 		if (fd <= 0)
 		{
 			if(!mute) printf("FileOpenEx(open) File:%s, error: %s.\n", full_path, strerror(errno));
@@ -621,6 +745,352 @@ int FileOpen(fileTYPE *file, const char *name, char mute)
 	return FileOpenEx(file, name, O_RDONLY, mute);
 }
 
+// Converted virtual disks are kept in memory keyed by source path, mtime and size,
+// so remounting or swapping back to a disk copies the image instead of converting it again.
+#define VDISK_CACHE_NUM  8
+#define VDISK_CACHE_MAX  (32 * 1024 * 1024)
+
+struct vdiskCache
+{
+	char      path[1024];
+	time_t    mtime;
+	__off64_t src_size;
+	int       fd;
+	__off64_t size;
+	uint32_t  used;
+};
+
+static vdiskCache vdisk_cache[VDISK_CACHE_NUM] = {};
+static uint32_t vdisk_cache_seq = 0;
+
+static int vdisk_copy(int dst, int src, __off64_t size)
+{
+	const size_t buf_size = 1024 * 1024;
+	uint8_t *buf = (uint8_t *)iobuf_get(buf_size);
+	if (!buf) return 0;
+
+	int ret = 1;
+	__off64_t pos = 0;
+	while (pos < size)
+	{
+		ssize_t len = pread64(src, buf, MIN((__off64_t)buf_size, size - pos), pos);
+		if (len <= 0 || pwrite64(dst, buf, len, pos) != len)
+		{
+			ret = 0;
+			break;
+		}
+		pos += len;
+	}
+
+	iobuf_put(buf);
+	return ret;
+}
+
+static vdiskCache *vdisk_find(const char *src, struct stat64 *st)
+{
+	for (int i = 0; i < VDISK_CACHE_NUM; i++)
+	{
+		vdiskCache *c = &vdisk_cache[i];
+		if (c->fd > 0 && !strcmp(c->path, src) && c->mtime == st->st_mtime && c->src_size == st->st_size) return c;
+	}
+	return NULL;
+}
+
+int FileOpenVDiskCached(fileTYPE *file, const char *src)
+{
+	struct stat64 *st = getPathStat(src);
+	if (!st) return 0;
+
+	vdiskCache *c = vdisk_find(src, st);
+	if (!c) return 0;
+
+	if (!FileOpenEx(file, "vdsk", -1)) return 0;
+	if (!vdisk_copy(fileno(file->filp), c->fd, c->size))
+	{
+		FileClose(file);
+		return 0;
+	}
+
+	c->used = ++vdisk_cache_seq;
+	file->size = c->size;
+	FileSeekLBA(file, 0);
+	printf("vdisk: %s from cache, size=%llu.\n", src, file->size);
+	return 1;
+}
+
+void FileStoreVDiskCache(fileTYPE *file, const char *src)
+{
+	if (!file->filp || file->type != 1 || file->size <= 0) return;
+
+	struct stat64 *st = getPathStat(src);
+	if (!st || vdisk_find(src, st)) return;
+
+	// replace the least recently used slot, and drop old ones while over the memory budget
+	vdiskCache *c = &vdisk_cache[0];
+	for (int i = 0; i < VDISK_CACHE_NUM && c->fd > 0; i++)
+	{
+		if (vdisk_cache[i].fd <= 0 || vdisk_cache[i].used < c->used) c = &vdisk_cache[i];
+	}
+
+	__off64_t total = file->size;
+	for (int i = 0; i < VDISK_CACHE_NUM; i++)
+	{
+		if (vdisk_cache[i].fd > 0 && &vdisk_cache[i] != c) total += vdisk_cache[i].size;
+	}
+
+	while (total > VDISK_CACHE_MAX)
+	{
+		vdiskCache *old = NULL;
+		for (int i = 0; i < VDISK_CACHE_NUM; i++)
+		{
+			if (vdisk_cache[i].fd > 0 && &vdisk_cache[i] != c && (!old || vdisk_cache[i].used < old->used)) old = &vdisk_cache[i];
+		}
+		if (!old) break;
+
+		total -= old->size;
+		close(old->fd);
+		memset(old, 0, sizeof(vdiskCache));
+	}
+
+	if (c->fd > 0) close(c->fd);
+	memset(c, 0, sizeof(vdiskCache));
+
+	if (total > VDISK_CACHE_MAX) return;
+
+	fflush(file->filp);
+	c->fd = memfd_create("vdsk_cache", MFD_CLOEXEC);
+	if (c->fd <= 0 || !vdisk_copy(c->fd, fileno(file->filp), file->size))
+	{
+		if (c->fd > 0) close(c->fd);
+		c->fd = 0;
+		return;
+	}
+
+	snprintf(c->path, sizeof(c->path), "%s", src);
+	c->mtime = st->st_mtime;
+	c->src_size = st->st_size;
+	c->size = file->size;
+	c->used = ++vdisk_cache_seq;
+}
+
+// Stream read-ahead. Streams are tracked by fd and the prefetch is a pread()
+// into a scratch buffer, which leaves the data in the page cache for the
+// consumer's own reads without touching its file position. Stream ids carry a
+// generation so an id left behind by an evicted or stopped slot is ignored.
+#define STREAM_SLOTS       8
+#define STREAM_CHUNK       (128 * 1024)
+#define STREAM_WINDOW_MIN  (256 * 1024)
+#define STREAM_WINDOW_MAX  (4 * 1024 * 1024)
+#define STREAM_WINDOW_SEC  2
+
+struct fileStream
+{
+	int       fd;
+	uint32_t  gen;
+	int       busy;      // prefetch thread is reading this fd
+	int       eof;
+	__off64_t last_end;  // end of the consumer's last read
+	__off64_t frontier;  // prefetched up to here
+	uint32_t  rate;      // consumption, bytes per second
+	uint64_t  rate_t0;
+	uint32_t  rate_bytes;
+	uint64_t  used;
+	unsigned long reads, underruns;
+};
+
+static fileStream streams[STREAM_SLOTS] = {};
+static uint32_t stream_gen = 0;
+static pthread_mutex_t stream_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t stream_cond = PTHREAD_COND_INITIALIZER;
+static int stream_thread_up = 0;
+
+static uint64_t stream_now_ms()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static __off64_t stream_window(fileStream *s)
+{
+	__off64_t w = (__off64_t)s->rate * STREAM_WINDOW_SEC;
+	return (w < STREAM_WINDOW_MIN) ? STREAM_WINDOW_MIN : (w > STREAM_WINDOW_MAX) ? STREAM_WINDOW_MAX : w;
+}
+
+static fileStream *stream_get(int id)
+{
+	int n = (id & 0xFF) - 1;
+	if (n < 0 || n >= STREAM_SLOTS) return NULL;
+	fileStream *s = &streams[n];
+	return (s->fd > 0 && s->gen == (uint32_t)(id >> 8)) ? s : NULL;
+}
+
+static void *stream_thread(void *)
+{
+	static uint8_t scratch[STREAM_CHUNK];
+
+	pthread_mutex_lock(&stream_lock);
+	while (1)
+	{
+		// Serve the stream with the least data ahead of its consumer.
+		fileStream *job = NULL;
+		__off64_t job_lead = 0;
+		for (int i = 0; i < STREAM_SLOTS; i++)
+		{
+			fileStream *s = &streams[i];
+			if (s->fd <= 0 || s->eof) continue;
+			if (s->frontier < s->last_end) s->frontier = s->last_end;
+			__off64_t lead = s->frontier - s->last_end;
+			if (lead >= stream_window(s)) continue;
+			if (!job || lead < job_lead)
+			{
+				job = s;
+				job_lead = lead;
+			}
+		}
+
+		if (!job)
+		{
+			struct timespec ts;
+			clock_gettime(CLOCK_REALTIME, &ts);
+			ts.tv_nsec += 100 * 1000000;
+			if (ts.tv_nsec >= 1000000000) { ts.tv_sec++; ts.tv_nsec -= 1000000000; }
+			pthread_cond_timedwait(&stream_cond, &stream_lock, &ts);
+			continue;
+		}
+
+		int fd = job->fd;
+		__off64_t pos = job->frontier;
+		job->busy = 1;
+		pthread_mutex_unlock(&stream_lock);
+
+		ssize_t len = pread64(fd, scratch, STREAM_CHUNK, pos);
+
+		pthread_mutex_lock(&stream_lock);
+		job->busy = 0;
+		if (len <= 0) job->eof = 1;
+		else if (job->frontier == pos) job->frontier = pos + len;
+		pthread_cond_broadcast(&stream_cond);
+	}
+
+	return NULL;
+}
+
+int FileStreamStart(int fd)
+{
+	if (fd <= 0) return 0;
+
+	pthread_mutex_lock(&stream_lock);
+
+	if (!stream_thread_up)
+	{
+		pthread_attr_t attr;
+		pthread_attr_init(&attr);
+
+		// Stay off core #1 (main)
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(0, &set);
+		pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+
+		pthread_t tid;
+		if (!pthread_create(&tid, &attr, stream_thread, NULL))
+		{
+			pthread_detach(tid);
+			stream_thread_up = 1;
+		}
+		pthread_attr_destroy(&attr);
+	}
+
+	// Take a free slot, or the least recently read one that isn't mid-read.
+	int n = -1;
+	for (int i = 0; i < STREAM_SLOTS; i++)
+	{
+		if (streams[i].busy) continue;
+		if (streams[i].fd <= 0) { n = i; break; }
+		if (n < 0 || streams[i].used < streams[n].used) n = i;
+	}
+
+	int id = 0;
+	if (stream_thread_up && n >= 0)
+	{
+		fileStream *s = &streams[n];
+		memset(s, 0, sizeof(*s));
+		s->fd = fd;
+		s->gen = ++stream_gen & 0xFFFFFF;
+		s->used = s->rate_t0 = stream_now_ms();
+		id = (s->gen << 8) | (n + 1);
+
+		posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+	}
+
+	pthread_mutex_unlock(&stream_lock);
+	return id;
+}
+
+int FileStreamRead(int id, __off64_t pos, int len)
+{
+	if (len <= 0) return 1;
+
+	pthread_mutex_lock(&stream_lock);
+
+	fileStream *s = stream_get(id);
+	if (s)
+	{
+		__off64_t end = pos + len;
+		if (!s->reads || pos != s->last_end)
+		{
+			// The first read or a seek: restart the prefetch from here.
+			s->frontier = end;
+			s->eof = 0;
+		}
+		else if (end > s->frontier)
+		{
+			s->underruns++;
+			s->frontier = end;
+		}
+
+		s->last_end = end;
+		s->reads++;
+
+		uint64_t now = stream_now_ms();
+		s->used = now;
+		s->rate_bytes += len;
+		if (now - s->rate_t0 >= 1000)
+		{
+			uint32_t rate = (uint32_t)((uint64_t)s->rate_bytes * 1000 / (now - s->rate_t0));
+			s->rate = s->rate ? (s->rate + rate) / 2 : rate;
+			s->rate_bytes = 0;
+			s->rate_t0 = now;
+		}
+
+		if (s->frontier - s->last_end < stream_window(s) / 2) pthread_cond_broadcast(&stream_cond);
+	}
+
+	pthread_mutex_unlock(&stream_lock);
+	return s != NULL;
+}
+
+void FileStreamStop(int id)
+{
+	pthread_mutex_lock(&stream_lock);
+
+	fileStream *s = stream_get(id);
+	if (s)
+	{
+		while (s->busy) pthread_cond_wait(&stream_cond, &stream_lock);
+		if (s->reads) printf("Stream: %lu reads, %lu underruns, %u KB/s\n", s->reads, s->underruns, s->rate / 1024);
+		s->fd = 0;
+	}
+
+	pthread_mutex_unlock(&stream_lock);
+}
+
+void FileSetStream(fileTYPE *file)
+{
+	if (!file->stream && file->filp && !file->zip) file->stream = FileStreamStart(fileno(file->filp));
+}
+
 int FileSeek(fileTYPE *file, __off64_t offset, int origin)
 {
 	if (file->filp)
@@ -644,6 +1114,20 @@ int FileSeek(fileTYPE *file, __off64_t offset, int origin)
 			offset = file->size - offset;
 		}
 
+		mz_zip_reader_extract_iter_state *zi = file->zip->iter;
+		if (zi->file_stat.m_method == 0 && file->zip->archive.m_zip_type == MZ_ZIP_TYPE_FILE)
+		{
+			// stored entry: just move the read position
+			if (offset > file->size) offset = file->size;
+			__off64_t delta = offset - file->zip->offset;
+			zi->cur_file_ofs += delta;
+			zi->comp_remaining -= delta;
+			zi->out_buf_ofs += delta;
+			file->zip->offset = offset;
+		}
+
+		if (file->zip->cp_num) zip_checkpoint_restore(file->zip, offset);
+
 		if (offset < file->zip->offset)
 		{
 			mz_zip_reader_extract_iter_state *iter = mz_zip_reader_extract_iter_new(&file->zip->archive, file->zip->index, 0);
@@ -659,19 +1143,24 @@ int FileSeek(fileTYPE *file, __off64_t offset, int origin)
 			file->zip->offset = 0;
 		}
 
-		static char buf[4*1024];
+		const size_t buf_size = iobuf_chunk(file);
+		char *buf = (char *)iobuf_get(buf_size);
+		if (!buf) return 0;
+
 		while (file->zip->offset < offset)
 		{
-			const size_t want_len = MIN((__off64_t)sizeof(buf), offset - file->zip->offset);
-			const size_t read_len = mz_zip_reader_extract_iter_read(file->zip->iter, buf, want_len);
-			file->zip->offset += read_len;
+			const size_t want_len = MIN((__off64_t)buf_size, offset - file->zip->offset);
+			const size_t read_len = zip_read(file->zip, buf, want_len);
 			if (read_len < want_len)
 			{
 				printf("FileSeek(mz_zip_reader_extract_iter_read) Failed to advance iterator, error:%s\n",
 				       mz_zip_get_error_string(mz_zip_get_last_error(&file->zip->archive)));
+				iobuf_put(buf);
 				return 0;
 			}
 		}
+
+		iobuf_put(buf);
 	}
 	else
 	{
@@ -703,17 +1192,23 @@ int FileReadAdv(fileTYPE *file, void *pBuffer, int length, int failres)
 			clearerr(file->filp);
 			return failres;
 		}
+
+		// A stream evicted from its slot picks up a new one on the next read.
+		if (file->stream && !FileStreamRead(file->stream, file->offset, ret))
+		{
+			file->stream = FileStreamStart(fileno(file->filp));
+			FileStreamRead(file->stream, file->offset, ret);
+		}
 	}
 	else if (file->zip)
 	{
-		ret = mz_zip_reader_extract_iter_read(file->zip->iter, pBuffer, length);
+		ret = zip_read(file->zip, pBuffer, length);
 		if (!ret)
 		{
 			printf("FileReadEx(mz_zip_reader_extract_iter_read) Failed to read, error:%s\n",
 			       mz_zip_get_error_string(mz_zip_get_last_error(&file->zip->archive)));
 			return failres;
 		}
-		file->zip->offset += ret;
 	}
 	else
 	{
@@ -1361,6 +1856,65 @@ struct DirentComp
 	size_t iterations = 0;
 };
 
+// Sort keys: entry class and the first 8 lowercased characters of the name (extension stripped
+// the same way DirentComp does it), packed so most comparisons are a single integer compare.
+// Only ties on the packed prefix fall back to DirentComp on the full entries.
+struct DirentKey
+{
+	uint64_t prefix;
+	uint32_t cls;
+	uint32_t idx;
+};
+
+static DirentKey dirent_key(const direntext_t &de, uint32_t idx)
+{
+	DirentKey key = {};
+	key.idx = idx;
+
+	if (de.de.d_type == DT_DIR) key.cls = !strcmp(de.altname, "..") ? 0 : 1;
+	else key.cls = 2;
+
+	int len = strlen(de.altname);
+	if ((len > 4) && (de.altname[len - 4] == '.')) len -= 4;
+
+	for (int i = 0; i < 8; i++)
+	{
+		key.prefix <<= 8;
+		if (i < len) key.prefix |= (uint8_t)tolower((uint8_t)de.altname[i]);
+	}
+
+	return key;
+}
+
+static void dirent_sort(DirentVector &items)
+{
+	std::vector<DirentKey> keys;
+	keys.reserve(items.size());
+	for (uint32_t i = 0; i < items.size(); i++) keys.push_back(dirent_key(items[i], i));
+
+	DirentComp comp;
+	std::sort(keys.begin(), keys.end(), [&](const DirentKey &k1, const DirentKey &k2)
+	{
+#ifdef USE_SCHEDULER
+		if (++comp.iterations % YieldIterations == 0)
+		{
+			scheduler_yield();
+		}
+#endif
+
+		if (k1.cls != k2.cls) return k1.cls < k2.cls;
+		if (k1.prefix != k2.prefix) return k1.prefix < k2.prefix;
+		if (!k1.cls) return false;
+		return comp(items[k1.idx], items[k2.idx]);
+	});
+
+	// Entries are large, so they are moved once into their final order instead of swapped while sorting.
+	DirentVector sorted;
+	sorted.reserve(items.size());
+	for (const DirentKey &key : keys) sorted.push_back(items[key.idx]);
+	items.swap(sorted);
+}
+
 void AdjustDirectory(char *path)
 {
 	if (!FileExists(path)) return;
@@ -1395,13 +1949,54 @@ static bool IsInSameFolder(const char *folder, const char *path)
 }
 
 static int names_loaded = 0;
+static char *names = 0;
+static std::unordered_map<std::string, const char*> names_index;
+
+// names.txt is indexed once by the name at the start of each line ("name: Display Name"),
+// so a large folder costs one lookup per entry instead of a scan of the whole file.
+static void names_load()
+{
+	names_index.clear();
+	if (names)
+	{
+		free(names);
+		names = 0;
+	}
+
+	int size = FileLoad("names.txt", 0, 0);
+	if (size)
+	{
+		names = (char*)malloc(size + 1);
+		if (names)
+		{
+			names[0] = 0;
+			FileLoad("names.txt", names, 0);
+			names[size] = 0;
+
+			char *line = names;
+			while (*line)
+			{
+				char *eol = strchr(line, '\n');
+				if (!eol) eol = line + strlen(line);
+
+				char *sep = (char*)memchr(line, ':', eol - line);
+				if (sep && sep > line) names_index.emplace(std::string(line, sep - line), sep + 1);
+
+				line = *eol ? eol + 1 : eol;
+			}
+		}
+	}
+	names_loaded = 1;
+}
+
 static void get_display_name(direntext_t *dext, const char *ext, int options)
 {
-	static char *names = 0;
 	memcpy(dext->altname, dext->de.d_name, sizeof(dext->altname));
 	if (dext->de.d_type == DT_DIR) return;
 
 	int len = strlen(dext->altname);
+	if (len > 8 && !strcasecmp(dext->altname + len - 8, ".rbf.zst")) dext->altname[len -= 4] = 0;
+
 	int xml = (len > 4 && (!strcasecmp(dext->altname + len - 4, ".mgl") || !strcasecmp(dext->altname + len - 4, ".mra")));
 	int rbf = (len > 4 && !strcasecmp(dext->altname + len - 4, ".rbf"));
 	if (rbf || xml)
@@ -1423,55 +2018,28 @@ static void get_display_name(direntext_t *dext, const char *ext, int options)
 			}
 		}
 
-		if (!names_loaded)
-		{
-			if (names)
-			{
-				free(names);
-				names = 0;
-			}
-
-			int size = FileLoad("names.txt", 0, 0);
-			if (size)
-			{
-				names = (char*)malloc(size + 1);
-				if (names)
-				{
-					names[0] = 0;
-					FileLoad("names.txt", names, 0);
-					names[size] = 0;
-				}
-			}
-			names_loaded = 1;
-		}
+		if (!names_loaded) names_load();
 
-		if (names)
+		auto it = names_index.find(dext->altname);
+		if (it != names_index.end())
 		{
-			strcat(dext->altname, ":");
-			len = strlen(dext->altname);
-			char *transl = strstr(names, dext->altname);
-			if (transl)
+			const char *transl = it->second;
+			int copy = 0;
+			len = 0;
+			while (*transl && len < (int)sizeof(dext->altname) - 1)
 			{
-				int copy = 0;
-				transl += len;
-				len = 0;
-				while (*transl && len < (int)sizeof(dext->altname) - 1)
+				if (!copy && *transl <= 32)
 				{
-					if (!copy && *transl <= 32)
-					{
-						transl++;
-						continue;
-					}
+					transl++;
+					continue;
+				}
 
-					if (copy && *transl < 32) break;
+				if (copy && *transl < 32) break;
 
-					copy = 1;
-					dext->altname[len++] = *transl++;
-				}
-				len++;
+				copy = 1;
+				dext->altname[len++] = *transl++;
 			}
-
-			dext->altname[len - 1] = 0;
+			dext->altname[len] = 0;
 		}
 		return;
 	}
@@ -1485,6 +2053,119 @@ static void get_display_name(direntext_t *dext, const char *ext, int options)
 	if (fext) *fext = 0;
 }
 
+// Checks a regular file against the scan's filters. Zip files accepted as folders
+// are turned into DT_DIR entries.
+static int file_selectable(struct dirent64 *de, const char *extension, int options, int has_trd, const char *prefix, int *isZip)
+{
+	// skip hidden files
+	if (!strncasecmp(de->d_name, ".", 1)) return 0;
+	//skip non-selectable files
+	if (!strcasecmp(de->d_name, "menu.rbf") || !strcasecmp(de->d_name, "menu.rbf.zst")) return 0;
+	if (!strncasecmp(de->d_name, "menu_20", 7)) return 0;
+	if (!strncasecmp(de->d_name, "boot", 4))
+	{
+		int len = strlen(de->d_name);
+		if ((len == 8 || (len == 9 && de->d_name[4] >= '0' && de->d_name[4] <= '9')) && !strcasecmp(de->d_name + len - 4, ".rom"))
+		{
+			return 0;
+		}
+	}
+
+	//check the prefix if given
+	if (prefix && strncasecmp(prefix, de->d_name, strlen(prefix))) return 0;
+
+	if (*extension)
+	{
+		const char *ext = extension;
+		int found = (has_trd && x2trd_ext_supp(de->d_name));
+		if (!found && !(options & SCANO_NOZIP) && !strcasecmp(de->d_name + strlen(de->d_name) - 4, ".zip") && (options & SCANO_DIR))
+		{
+			// Fake that zip-file is a directory.
+			de->d_type = DT_DIR;
+			*isZip = 1;
+			found = 1;
+		}
+		if (!found && is_minimig() && !memcmp(extension, "HDF", 3))
+		{
+			found = !strcasecmp(de->d_name + strlen(de->d_name) - 4, ".iso");
+		}
+		if (!found && (options & SCANO_CORES))
+		{
+			int len = strlen(de->d_name);
+			found = (len > 8 && !strcasecmp(de->d_name + len - 8, ".rbf.zst"));
+		}
+
+		char *fext = strrchr(de->d_name, '.');
+		if (fext) fext++;
+		while (!found && *ext && fext)
+		{
+			char e[4];
+			memcpy(e, ext, 3);
+			if (e[2] == ' ')
+			{
+				e[2] = 0;
+				if (e[1] == ' ') e[1] = 0;
+			}
+
+			e[3] = 0;
+			found = 1;
+			for (int i = 0; i < 4; i++)
+			{
+				if (e[i] == '*') break;
+				if (e[i] == '?' && fext[i]) continue;
+
+				if (tolower(e[i]) != tolower(fext[i])) found = 0;
+
+				if (!e[i] || !found) break;
+			}
+			if (found) break;
+
+			if (strlen(ext) < 3) break;
+			ext += 3;
+		}
+		if (!found) return 0;
+	}
+
+	return 1;
+}
+
+// Fills the list from the search index instead of reading the folder: matches come
+// from the folder and all of its subfolders, named by their path relative to it.
+static int ScanSearch(const char *path, const char *extension, int options, int has_trd, const char *filter)
+{
+	static std::vector<search_hit_t> hits;
+	if (search_find(path, filter, hits, 2000) < 0) return 0;
+
+	for (auto &hit : hits)
+	{
+		const char *base = strrchr(hit.name.c_str(), '/');
+		base = base ? base + 1 : hit.name.c_str();
+		if (hit.name.length() >= sizeof(((struct dirent64*)0)->d_name)) continue;
+
+		struct dirent64 de = {};
+		int isZip = 0;
+		strcpy(de.d_name, base);
+		de.d_type = hit.is_dir ? DT_DIR : DT_REG;
+
+		if (hit.is_dir)
+		{
+			if (!(options & SCANO_DIR)) continue;
+		}
+		else if (!file_selectable(&de, extension, options, has_trd, NULL, &isZip)) continue;
+
+		direntext_t dext;
+		memset(&dext, 0, sizeof(dext));
+		memcpy(&dext.de, &de, sizeof(dext.de));
+		if (isZip) dext.flags |= DT_EXT_ZIP;
+		get_display_name(&dext, extension, options);
+		strcpy(dext.de.d_name, hit.name.c_str());
+		DirItem.push_back(dext);
+	}
+
+	printf("Search \"%s\" in %s: %d matches\n", filter, path, (int)DirItem.size());
+	return 1;
+}
+
 int ScanDirectory(char* path, int mode, const char *extension, int options, const char *prefix, const char *filter)
 {
 	static char file_name[1024];
@@ -1498,7 +2179,6 @@ int ScanDirectory(char* path, int mode, const char *extension, int options, cons
 		ext += 3;
 	}
 
-	int extlen = strlen(extension);
     int filterlen = filter ? strlen(filter) : 0;
 	//printf("scan dir\n");
 
@@ -1532,6 +2212,13 @@ int ScanDirectory(char* path, int mode, const char *extension, int options, cons
 
 		if (options & SCANO_NEOGEO) neogeo_scan_xml(path);
 
+		if (filter && !(options & (SCANO_CORES | SCANO_NEOGEO | SCANO_TXT)) && !strcasestr(path, ".zip") && ScanSearch(path, extension, options, has_trd, filter))
+		{
+			if (!flist_nDirEntries()) return 0;
+			dirent_sort(DirItem);
+			return flist_nDirEntries();
+		}
+
 		sprintf(full_path, "%s/%s", getRootDir(), path);
 		int path_len = strlen(full_path);
 
@@ -1632,8 +2319,9 @@ int ScanDirectory(char* path, int mode, const char *extension, int options, cons
 					}
 				}
 			}
-			// Handle (possible) symbolic link type in the directory entry
-			else if (de->d_type == DT_LNK || de->d_type == DT_REG)
+			// Handle (possible) symbolic link type in the directory entry.
+			// Regular files need no stat: readdir already reports their type.
+			else if (de->d_type == DT_LNK)
 			{
 				sprintf(full_path + path_len, "/%s", de->d_name);
 
@@ -1733,69 +2421,7 @@ int ScanDirectory(char* path, int mode, const char *extension, int options, cons
 				}
 				else if (de->d_type == DT_REG)
 				{
-					// skip hidden files
-					if (!strncasecmp(de->d_name, ".", 1)) continue;
-					//skip non-selectable files
-					if (!strcasecmp(de->d_name, "menu.rbf")) continue;
-					if (!strncasecmp(de->d_name, "menu_20", 7)) continue;
-					if (!strncasecmp(de->d_name, "boot", 4))
-					{
-						int len = strlen(de->d_name);
-						if ((len == 8 || (len == 9 && de->d_name[4] >= '0' && de->d_name[4] <= '9')) && !strcasecmp(de->d_name + len - 4, ".rom"))
-						{
-							continue;
-						}
-					}
-
-					//check the prefix if given
-					if (prefix && strncasecmp(prefix, de->d_name, strlen(prefix))) continue;
-
-					if (extlen > 0)
-					{
-						const char *ext = extension;
-						int found = (has_trd && x2trd_ext_supp(de->d_name));
-						if (!found && !(options & SCANO_NOZIP) && !strcasecmp(de->d_name + strlen(de->d_name) - 4, ".zip") && (options & SCANO_DIR))
-						{
-							// Fake that zip-file is a directory.
-							de->d_type = DT_DIR;
-							isZip = 1;
-							found = 1;
-						}
-						if (!found && is_minimig() && !memcmp(extension, "HDF", 3))
-						{
-							found = !strcasecmp(de->d_name + strlen(de->d_name) - 4, ".iso");
-						}
-
-						char *fext = strrchr(de->d_name, '.');
-						if (fext) fext++;
-						while (!found && *ext && fext)
-						{
-							char e[4];
-							memcpy(e, ext, 3);
-							if (e[2] == ' ')
-							{
-								e[2] = 0;
-								if (e[1] == ' ') e[1] = 0;
-							}
-
-							e[3] = 0;
-							found = 1;
-							for (int i = 0; i < 4; i++)
-							{
-								if (e[i] == '*') break;
-								if (e[i] == '?' && fext[i]) continue;
-
-								if (tolower(e[i]) != tolower(fext[i])) found = 0;
-
-								if (!e[i] || !found) break;
-							}
-							if (found) break;
-
-							if (strlen(ext) < 3) break;
-							ext += 3;
-						}
-						if (!found) continue;
-					}
+					if (!file_selectable(de, extension, options, has_trd, prefix, &isZip)) continue;
 				}
 				else
 				{
@@ -1834,7 +2460,7 @@ int ScanDirectory(char* path, int mode, const char *extension, int options, cons
 		printf("Got %d dir entries\n", flist_nDirEntries());
 		if (!flist_nDirEntries()) return 0;
 
-		std::sort(DirItem.begin(), DirItem.end(), DirentComp());
+		dirent_sort(DirItem);
 		if (file_name[0])
 		{
 			int pos = -1;
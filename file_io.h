@@ -22,6 +22,7 @@ struct fileTYPE
 	fileZipArchive *zip;
 	__off64_t       size;
 	__off64_t       offset;
+	int             stream;
 	char            path[1024];
 	char            name[261];
 };
@@ -85,8 +86,23 @@ int  isUSBMounted();
 int  FileOpenZip(fileTYPE *file, const char *name, uint32_t crc32);
 int  FileOpenEx(fileTYPE *file, const char *name, int mode, char mute = 0, int use_zip = 1);
 int  FileOpen(fileTYPE *file, const char *name, char mute = 0);
+
+// virtual disk (FileOpenEx with mode -1) conversion cache
+int  FileOpenVDiskCached(fileTYPE *file, const char *src);
+void FileStoreVDiskCache(fileTYPE *file, const char *src);
 int FileClose(fileTYPE *file);
 
+// Read-ahead for sequential media streams (CD audio, MSU-1, MD+ audio).
+// A background thread keeps the page cache filled ahead of the consumer by a
+// window sized from its consumption rate; a read that catches up with the
+// prefetched data counts as an underrun, reported when the stream stops.
+// FileSetStream() enables it on an opened file, after which FileReadAdv()
+// feeds it; the fd calls are for streams read through plain stdio.
+void FileSetStream(fileTYPE *file);
+int  FileStreamStart(int fd);
+int  FileStreamRead(int id, __off64_t pos, int len);
+void FileStreamStop(int id);
+
 __off64_t FileGetSize(fileTYPE *file);
 
 int FileSeek(fileTYPE *file, __off64_t offset, int origin);
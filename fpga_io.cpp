@@ -8,6 +8,9 @@
 #include <termios.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <fcntl.h>
+#include <time.h>
+#include <zstd.h>
 
 #include "fpga_io.h"
 #include "file_io.h"
@@ -341,26 +344,13 @@ static int fpgamgr_program_poll_usermode(void)
 }
 
 /*
-* FPGA Manager to program the FPGA. This is the interface used by FPGA driver.
+* Finish programming once all RBF data has been written.
 * Return 0 for sucess, non-zero for error.
 */
-static int socfpga_load(const void *rbf_data, size_t rbf_size)
+static int socfpga_load_finish(void)
 {
 	unsigned long status;
 
-	if ((uint32_t)rbf_data & 0x3) {
-		printf("FPGA: Unaligned data, realign to 32bit boundary.\n");
-		return -EINVAL;
-	}
-
-	/* Initialize the FPGA Manager */
-	status = fpgamgr_program_init();
-	if (status)
-		return status;
-
-	/* Write the RBF data to FPGA Manager */
-	fpgamgr_program_write(rbf_data, rbf_size);
-
 	/* Ensure the FPGA entering config done */
 	status = fpgamgr_program_poll_cd();
 	if (status)
@@ -423,6 +413,163 @@ static int make_env(const char *name, const char *cfg)
 	return 0;
 }
 
+// Bitstream source for the streaming loader: plain .rbf or zstd compressed .rbf.zst
+#define RBF_CHUNK (512 * 1024)
+
+struct rbfStream
+{
+	int fd;
+	ZSTD_DStream *zds;
+	ZSTD_inBuffer in;
+	uint8_t *inbuf;
+	int eof;
+
+	// per phase time, us
+	uint32_t t_read;
+	uint32_t t_unpack;
+};
+
+static uint32_t time_us()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int rbf_read(rbfStream *s, uint8_t *dst, int size)
+{
+	uint32_t t = time_us();
+	int pos = 0;
+	while (pos < size)
+	{
+		int ret = read(s->fd, dst + pos, size - pos);
+		if (ret < 0) return -1;
+		if (!ret)
+		{
+			s->eof = 1;
+			break;
+		}
+		pos += ret;
+	}
+	s->t_read += time_us() - t;
+	return pos;
+}
+
+// Fill dst completely unless the stream ends. Returns the size, -1 on error.
+static int rbf_fill(rbfStream *s, uint8_t *dst, int size)
+{
+	if (!s->zds) return rbf_read(s, dst, size);
+
+	ZSTD_outBuffer out = { dst, (size_t)size, 0 };
+	while (out.pos < out.size)
+	{
+		if (s->in.pos == s->in.size)
+		{
+			if (s->eof) break;
+
+			int ret = rbf_read(s, s->inbuf, ZSTD_DStreamInSize());
+			if (ret < 0) return -1;
+			s->in.src = s->inbuf;
+			s->in.size = ret;
+			s->in.pos = 0;
+			if (!ret) break;
+		}
+
+		uint32_t t = time_us();
+		size_t ret = ZSTD_decompressStream(s->zds, &out, &s->in);
+		s->t_unpack += time_us() - t;
+		if (ZSTD_isError(ret))
+		{
+			printf("RBF: %s\n", ZSTD_getErrorName(ret));
+			return -1;
+		}
+	}
+
+	return out.pos;
+}
+
+// Read and decompress on the offload core while the previous chunk is written
+// to the FPGA manager. Returns 0 for success, 1 if the stream failed after
+// programming had started (the FPGA is unconfigured then), or a negative error.
+static int rbf_program(rbfStream *s, const char *path)
+{
+	uint8_t *buf[2];
+	buf[0] = (uint8_t*)malloc(RBF_CHUNK + 4);
+	buf[1] = (uint8_t*)malloc(RBF_CHUNK + 4);
+	if (!buf[0] || !buf[1])
+	{
+		printf("Couldn't allocate RBF buffers.\n");
+		free(buf[0]);
+		free(buf[1]);
+		return -1;
+	}
+
+	uint32_t t_start = time_us();
+	uint32_t t_write = 0, t_wait = 0, t_finish;
+	uint32_t total = 0;
+	int ret = -1;
+
+	int len = rbf_fill(s, buf[0], RBF_CHUNK);
+	int off = 0;
+	uint32_t remain = UINT32_MAX;
+	if (len >= 16 && !memcmp(buf[0], "MiSTer", 6))
+	{
+		remain = *(uint32_t*)(buf[0] + 12);
+		off = 16;
+	}
+
+	if (len <= off)
+	{
+		printf("Couldn't read file %s\n", path);
+		goto done;
+	}
+
+	fpga_core_reset(1);
+	do_bridge(0);
+	ret = fpgamgr_program_init();
+	if (ret) goto done;
+
+	for (int cur = 0; len > off && remain; cur ^= 1)
+	{
+		uint8_t *next = buf[cur ^ 1];
+		int next_len = 0;
+		offload_add_work([s, next, &next_len] { next_len = rbf_fill(s, next, RBF_CHUNK); });
+
+		uint32_t t = time_us();
+		uint32_t n = len - off;
+		if (n > remain) n = remain;
+		fpgamgr_program_write(buf[cur] + off, n);
+		remain -= n;
+		total += n;
+		t_write += time_us() - t;
+
+		t = time_us();
+		offload_wait();
+		t_wait += time_us() - t;
+
+		len = next_len;
+		off = 0;
+		if (len < 0)
+		{
+			printf("Couldn't read file %s\n", path);
+			ret = 1;
+			goto done;
+		}
+	}
+
+	t_finish = time_us();
+	ret = socfpga_load_finish();
+	t_finish = time_us() - t_finish;
+
+	printf("Bitstream: %u bytes in %u ms (read %u, unpack %u, write %u, wait %u, finish %u ms)\n", total,
+		(time_us() - t_start) / 1000, s->t_read / 1000, s->t_unpack / 1000, t_write / 1000, t_wait / 1000, t_finish / 1000);
+
+done:
+	free(buf[0]);
+	free(buf[1]);
+	return ret;
+}
+
 int fpga_load_rbf(const char *name, const char *cfg, const char *xml)
 {
 	OsdDisable();
@@ -442,8 +589,9 @@ int fpga_load_rbf(const char *name, const char *cfg, const char *xml)
 	if(name[0] == '/') strcpy(path, name);
 	else sprintf(path, "%s/%s", !strcasecmp(name, "menu.rbf") ? getStorageDir(0) : getRootDir(), name);
 
-	int rbf = open(path, O_RDONLY);
-	if (rbf < 0)
+	rbfStream s = {};
+	s.fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (s.fd < 0)
 	{
 		char error[4096];
 		snprintf(error,4096,"%s\nNot Found", name);
@@ -451,57 +599,42 @@ int fpga_load_rbf(const char *name, const char *cfg, const char *xml)
 		Info(error,5000);
 		return -1;
 	}
-	else
+
+	int len = strlen(path);
+	if (len > 4 && !strcasecmp(path + len - 4, ".zst"))
 	{
-		struct stat64 st;
-		if (fstat64(rbf, &st)<0)
+		s.zds = ZSTD_createDStream();
+		s.inbuf = (uint8_t*)malloc(ZSTD_DStreamInSize());
+		if (!s.zds || !s.inbuf)
 		{
-			printf("Couldn't get info of file %s\n", path);
+			printf("Couldn't allocate zstd stream.\n");
 			ret = -1;
 		}
 		else
 		{
-			printf("Bitstream size: %lld bytes\n", st.st_size);
-
-			void *buf = malloc(st.st_size);
-			if (!buf)
-			{
-				printf("Couldn't allocate %llu bytes.\n", st.st_size);
-				ret = -1;
-			}
-			else
-			{
-				fpga_core_reset(1);
-				if (read(rbf, buf, st.st_size)<st.st_size)
-				{
-					printf("Couldn't read file %s\n", name);
-					ret = -1;
-				}
-				else
-				{
-					void *p = buf;
-					__off64_t sz = st.st_size;
-					if (!memcmp(buf, "MiSTer", 6))
-					{
-						sz = *(uint32_t*)(((uint8_t*)buf) + 12);
-						p = (void*)(((uint8_t*)buf) + 16);
-					}
-					do_bridge(0);
-					ret = socfpga_load(p, sz);
-					if (ret)
-					{
-						printf("Error %d while loading %s\n", ret, path);
-					}
-					else
-					{
-						do_bridge(1);
-					}
-				}
-				free(buf);
-			}
+			ZSTD_initDStream(s.zds);
+		}
+	}
+
+	if (!ret)
+	{
+		ret = rbf_program(&s, path);
+		if (ret)
+		{
+			printf("Error %d while loading %s\n", ret, path);
+		}
+		else
+		{
+			do_bridge(1);
 		}
 	}
-	close(rbf);
+
+	if (s.zds) ZSTD_freeDStream(s.zds);
+	free(s.inbuf);
+	close(s.fd);
+
+	// The FPGA lost its old core when the stream broke mid-way: fall back to the menu.
+	if (ret > 0 && strcasecmp(name, "menu.rbf")) return fpga_load_rbf("menu.rbf");
 
 	app_restart(!strcasecmp(name, "menu.rbf") ? "menu.rbf" : path, xml);
 	return ret;
@@ -2,7 +2,14 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <vector>
+#include <algorithm>
 #include "input.h"
 #include "file_io.h"
 #include "user_io.h"
@@ -476,34 +483,198 @@ static bool parse_mapping_string(char *map_str, char *guid, int dev_fd, uint32_t
 #define GCDB_DIR  "/media/fat/linux/gamecontrollerdb/"
 
 
-bool read_controller_map_from_file(char *fname, char *guid, int dev_fd, uint32_t *fill_map)
+//The text db files are compiled into a GUID-sorted table kept in the config dir and mmapped,
+//so a hot-plugged controller costs a binary search instead of a scan of the whole file.
+//The table is rebuilt when the source file's mtime or size changes.
+#define GCDB_TABLE_MAGIC   0x42444347 // "GCDB"
+#define GCDB_TABLE_VERSION 1
+
+struct gcdb_table_hdr
+{
+	uint32_t magic;
+	uint32_t version;
+	int64_t  src_mtime;
+	int64_t  src_size;
+	uint32_t count;
+	uint32_t pool_size;
+};
+
+struct gcdb_table_entry
+{
+	char     guid[GUID_LEN - 1]; //lower case, not terminated
+	uint32_t offset;             //",name,mapping" in the pool
+};
+
+struct gcdb_table
+{
+	const char *src;
+	const char *cache;
+	char       *data;
+	size_t      size;
+	bool        mapped;
+};
+
+static gcdb_table gcdb_tables[] = {
+	{ GCDB_DIR "gamecontrollerdb_user.txt", "gamecontrollerdb_user.bin", NULL, 0, false },
+	{ GCDB_DIR "gamecontrollerdb.txt", "gamecontrollerdb.bin", NULL, 0, false },
+};
+
+static void gcdb_table_free(gcdb_table *tbl)
 {
+	if (tbl->data)
+	{
+		if (tbl->mapped) munmap(tbl->data, tbl->size);
+		else free(tbl->data);
+	}
+	tbl->data = NULL;
+	tbl->size = 0;
+	tbl->mapped = false;
+}
+
+static bool gcdb_table_valid(gcdb_table *tbl, const struct stat64 *st)
+{
+	if (!tbl->data || tbl->size < sizeof(gcdb_table_hdr)) return false;
+
+	gcdb_table_hdr *hdr = (gcdb_table_hdr *)tbl->data;
+	return hdr->magic == GCDB_TABLE_MAGIC && hdr->version == GCDB_TABLE_VERSION &&
+		hdr->src_mtime == (int64_t)st->st_mtime && hdr->src_size == (int64_t)st->st_size &&
+		(uint64_t)tbl->size == sizeof(gcdb_table_hdr) + (uint64_t)hdr->count * sizeof(gcdb_table_entry) + hdr->pool_size;
+}
+
+// A table read from the card can be truncated or corrupted: every entry has to point into the pool.
+static bool gcdb_table_pool_valid(gcdb_table *tbl)
+{
+	gcdb_table_hdr *hdr = (gcdb_table_hdr *)tbl->data;
+	gcdb_table_entry *entries = (gcdb_table_entry *)(tbl->data + sizeof(gcdb_table_hdr));
+	const char *pool = (const char *)(entries + hdr->count);
+
+	if (!hdr->pool_size) return !hdr->count;
+	if (pool[hdr->pool_size - 1]) return false;
+	for (uint32_t i = 0; i < hdr->count; i++)
+	{
+		if (entries[i].offset >= hdr->pool_size) return false;
+	}
+	return true;
+}
+
+static bool gcdb_table_build(gcdb_table *tbl, const struct stat64 *st)
+{
+	PROFILE_FUNCTION();
+
 	fileTextReader reader;
-	char matched[1024] = {};
-	char *map_start = NULL;
+	if (!FileOpenTextReader(&reader, tbl->src)) return false;
+
+	printf("Gamecontrollerdb: compiling %s\n", tbl->src);
+
+	std::vector<gcdb_table_entry> entries;
+	std::vector<char> pool;
+	const char *line;
+	while ((line = FileReadLine(&reader)))
+	{
+		if (line[0] == '#') continue;
+		const char *gcom = strchr(line, ',');
+		if (!gcom || gcom - line != GUID_LEN - 1) continue;
+
+		gcdb_table_entry entry;
+		for (int i = 0; i < GUID_LEN - 1; i++) entry.guid[i] = tolower(line[i]);
+		entry.offset = pool.size();
+		pool.insert(pool.end(), gcom, gcom + strlen(gcom) + 1);
+		entries.push_back(entry);
+	}
+
+	//stable: entries of the same GUID keep their file order, the last matching one wins
+	std::stable_sort(entries.begin(), entries.end(), [](const gcdb_table_entry &a, const gcdb_table_entry &b)
+	{
+		return memcmp(a.guid, b.guid, sizeof(a.guid)) < 0;
+	});
 
-	if (FileOpenTextReader(&reader, fname))
+	gcdb_table_hdr hdr = { GCDB_TABLE_MAGIC, GCDB_TABLE_VERSION, (int64_t)st->st_mtime, (int64_t)st->st_size, (uint32_t)entries.size(), (uint32_t)pool.size() };
+	size_t size = sizeof(hdr) + entries.size() * sizeof(gcdb_table_entry) + pool.size();
+	char *data = (char *)malloc(size);
+	if (!data) return false;
+
+	memcpy(data, &hdr, sizeof(hdr));
+	memcpy(data + sizeof(hdr), entries.data(), entries.size() * sizeof(gcdb_table_entry));
+	memcpy(data + sizeof(hdr) + entries.size() * sizeof(gcdb_table_entry), pool.data(), pool.size());
+
+	gcdb_table_free(tbl);
+	tbl->data = data;
+	tbl->size = size;
+	tbl->mapped = false;
+
+	FileSaveConfig(tbl->cache, data, size);
+	return true;
+}
+
+static bool gcdb_table_open(gcdb_table *tbl)
+{
+	struct stat64 st;
+	if (stat64(tbl->src, &st))
+	{
+		gcdb_table_free(tbl);
+		return false;
+	}
+
+	if (gcdb_table_valid(tbl, &st)) return true;
+	gcdb_table_free(tbl);
+
+	char path[256];
+	snprintf(path, sizeof(path), "%s/%s", CONFIG_DIR, tbl->cache);
+	int fd = open(getFullPath(path), O_RDONLY | O_CLOEXEC);
+	if (fd >= 0)
 	{
-		const char *line;
-		printf("Gamecontrollerdb: searching for GUID %s in file %s\n", guid, fname);
-		while ((line = FileReadLine(&reader)))
+		struct stat64 cst;
+		if (!fstat64(fd, &cst) && cst.st_size >= (off64_t)sizeof(gcdb_table_hdr))
 		{
-			if (line[0] == '#') continue;
-			const char *gcom = strchr(line, ',');
-			if (!strncasecmp(line, guid, gcom-line))
+			void *data = mmap(NULL, cst.st_size, PROT_READ, MAP_SHARED, fd, 0);
+			if (data != MAP_FAILED)
 			{
-				if (cdb_entry_matches((char *)gcom))
-				{
-					map_start = strchr((char *)gcom+1, ',');
-					if (map_start)
-					{
-						strncpy(matched, map_start+1, sizeof(matched));
-					}
-				}
+				tbl->data = (char *)data;
+				tbl->size = cst.st_size;
+				tbl->mapped = true;
 			}
 		}
+		close(fd);
+		if (gcdb_table_valid(tbl, &st) && gcdb_table_pool_valid(tbl)) return true;
+		gcdb_table_free(tbl);
+	}
+
+	return gcdb_table_build(tbl, &st);
+}
 
+static bool read_controller_map_from_table(gcdb_table *tbl, char *guid, int dev_fd, uint32_t *fill_map)
+{
+	char matched[1024] = {};
+
+	if (!gcdb_table_open(tbl)) return false;
+
+	gcdb_table_hdr *hdr = (gcdb_table_hdr *)tbl->data;
+	gcdb_table_entry *entries = (gcdb_table_entry *)(tbl->data + sizeof(gcdb_table_hdr));
+	const char *pool = (const char *)(entries + hdr->count);
+
+	char key[GUID_LEN - 1];
+	for (int i = 0; i < GUID_LEN - 1; i++) key[i] = tolower(guid[i]);
+
+	printf("Gamecontrollerdb: searching for GUID %s in %s\n", guid, tbl->src);
+	gcdb_table_entry *it = std::lower_bound(entries, entries + hdr->count, key, [](const gcdb_table_entry &e, const char *k)
+	{
+		return memcmp(e.guid, k, sizeof(e.guid)) < 0;
+	});
+
+	for (; it < entries + hdr->count && !memcmp(it->guid, key, sizeof(key)); it++)
+	{
+		char line[1024];
+		snprintf(line, sizeof(line), "%s", pool + it->offset);
+		if (cdb_entry_matches(line))
+		{
+			char *map_start = strchr(line + 1, ',');
+			if (map_start)
+			{
+				strncpy(matched, map_start+1, sizeof(matched));
+			}
+		}
 	}
+
 	if (matched[0] != 0)
 	{
 		printf("Gamecontrollerdb: found match, using config %s\n", matched);
@@ -513,6 +684,11 @@ bool read_controller_map_from_file(char *fname, char *guid, int dev_fd, uint32_t
 	return false;
 }
 
+void gcdb_init()
+{
+	for (size_t i = 0; i < sizeof(gcdb_tables) / sizeof(gcdb_tables[0]); i++) gcdb_table_open(&gcdb_tables[i]);
+}
+
 static int gcdb_controller_idx(uint16_t bustype, uint16_t vid, uint16_t pid, uint16_t version)
 {
 	for (int i=0; i < MAX_GCDB_ENTRIES; i++)
@@ -554,14 +730,10 @@ bool gcdb_map_for_controller(uint16_t bustype, uint16_t vid, uint16_t pid, uint1
 		}
 		sprintf(guid_str, "%04x0000%04x0000%04x0000%04x0000", (uint16_t)(bustype << 8 | bustype >> 8), (uint16_t)( vid << 8 |  vid >> 8), (uint16_t)(pid << 8 | pid >> 8), (uint16_t)(version << 8 | version >> 8));
 
-		char path[256] = {GCDB_DIR};
-		strcat(path, "gamecontrollerdb_user.txt");
 		bool found_entry = false;
-		if (!(found_entry = read_controller_map_from_file(path, guid_str, dev_fd, fill_map)))
+		for (size_t i = 0; !found_entry && i < sizeof(gcdb_tables) / sizeof(gcdb_tables[0]); i++)
 		{
-			strcpy(path, GCDB_DIR);
-			strcat(path, "gamecontrollerdb.txt");
-			found_entry = read_controller_map_from_file(path, guid_str, dev_fd, fill_map);
+			found_entry = read_controller_map_from_table(&gcdb_tables[i], guid_str, dev_fd, fill_map);
 		}
 
 
@@ -9,6 +9,8 @@
 //Including terminating nul
 #define GUID_LEN 33 
 
+// Compile/refresh the GUID tables of the db files so later lookups don't scan text.
+void gcdb_init();
 bool gcdb_map_for_controller(uint16_t bustype, uint16_t vid, uint16_t pid, uint16_t version, int dev_fd, uint32_t *fill_map);
 void gcdb_show_string_for_ctrl_map(uint16_t bustype, uint16_t vid, uint16_t pid, uint16_t version,int dev_fd, const char *name, uint32_t *cur_map);
 void get_ctrl_index_maps(int dev_fd, char *guid, uint16_t *btn_map, uint16_t *abs_map);
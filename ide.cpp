@@ -19,6 +19,7 @@
 #include "spi.h"
 #include "user_io.h"
 #include "file_io.h"
+#include "file_async.h"
 #include "hardware.h"
 #include "ide.h"
 #include "ide_cdrom.h"
@@ -79,6 +80,65 @@ void ide_recvbuf(ide_config *ide, uint16_t reg, uint32_t length, uint16_t *data)
 const uint32_t ide_io_max_size = 32;
 uint8_t ide_buf[ide_io_max_size * 512];
 
+// Read-ahead of the next block of sectors: queued once a block has been read,
+// so the disk works while the block is being sent to the core.
+// A read-ahead that isn't used is left to finish on its own (stale) and is
+// reaped before its buffer is used again.
+static struct
+{
+	fileTYPE *f;
+	uint32_t  lba;
+	uint32_t  cnt;
+	int       id;
+	int       stale;
+	fileTYPE *seq_f;   // where the last read command ended
+	uint32_t  seq_lba;
+} ide_ra = {};
+
+static uint8_t ide_ra_buf[ide_io_max_size * 512];
+
+static void ide_ra_drop()
+{
+	// only one read owns the buffer: the queue waits for the stale one first
+	if (ide_ra.id) ide_ra.stale = ide_ra.id;
+	ide_ra.id = 0;
+}
+
+static int ide_ra_reap()
+{
+	if (ide_ra.stale && FileAsyncReady(ide_ra.stale))
+	{
+		FileAsyncWait(ide_ra.stale);
+		ide_ra.stale = 0;
+	}
+	return !ide_ra.stale;
+}
+
+// Before the image is closed or replaced.
+static void ide_ra_flush()
+{
+	if (ide_ra.id) FileAsyncWait(ide_ra.id);
+	if (ide_ra.stale) FileAsyncWait(ide_ra.stale);
+	ide_ra.id = 0;
+	ide_ra.stale = 0;
+	ide_ra.seq_f = 0;
+}
+
+static void ide_ra_queue(drive_t *drive, uint32_t lba, uint32_t cnt)
+{
+	ide_ra_drop();
+	if (!ide_ra_reap()) return;
+
+	// zipped images would be read synchronously, not worth it.
+	if (!drive->f || drive->f->zip || lba < drive->offset) return;
+	if (((uint64_t)(lba - drive->offset + cnt) << 9) > (uint64_t)drive->f->size) return;
+
+	ide_ra.f = drive->f;
+	ide_ra.lba = lba;
+	ide_ra.cnt = cnt;
+	ide_ra.id = FileReadAsync(drive->f, (__off64_t)(lba - drive->offset) << 9, ide_ra_buf, cnt * 512);
+}
+
 ide_config ide_inst[2] = {};
 
 uint16_t ide_check()
@@ -93,6 +153,7 @@ uint16_t ide_check()
 
 int ide_img_mount(fileTYPE *f, const char *name, int rw)
 {
+	ide_ra_flush();
 	FileClose(f);
 	int writable = 0, ret = 0;
 
@@ -417,6 +478,7 @@ static void fill_fake_rdb(drive_t *drive, uint32_t sector, int cnt)
 
 void ide_img_set(uint32_t drvnum, fileTYPE *f, int cd, int sectors, int heads, int offset, int type)
 {
+	ide_ra_flush();
 	int drv = (drvnum & 1);
 	int port = (drvnum >> 1);
 
@@ -770,6 +832,24 @@ inline int readhdd(drive_t *drive, uint32_t lba, int cnt)
 	}
 }
 
+static int ide_read(drive_t *drive, uint32_t lba, int cnt)
+{
+	if (ide_ra.id && ide_ra.f == drive->f && ide_ra.lba == lba && ide_ra.cnt == (uint32_t)cnt)
+	{
+		int res = FileAsyncWait(ide_ra.id);
+		ide_ra.id = 0;
+		if (res == cnt * 512)
+		{
+			memcpy(ide_buf, ide_ra_buf, res);
+			FileSeekLBA(drive->f, lba - drive->offset + cnt);
+			return res;
+		}
+	}
+
+	ide_ra_drop();
+	return readhdd(drive, lba, cnt);
+}
+
 static void process_read(ide_config *ide, int multi)
 {
 	uint32_t lba = get_lba(ide);
@@ -778,8 +858,12 @@ static void process_read(ide_config *ide, int multi)
 	dbg2_printf("  sector_count: %d\n", ide->regs.sector_count);
 
 	uint32_t cnt = multi ? get_cnt(ide) : 1;
+
+	// read past the end of the command only while the commands follow each other
+	int seq = (ide_ra.seq_f == ide->drive[ide->regs.drv].f && ide_ra.seq_lba == lba);
+
 	ide->null = !FileSeekLBA(ide->drive[ide->regs.drv].f, (lba <= ide->drive[ide->regs.drv].offset) ? 0 : (lba - ide->drive[ide->regs.drv].offset));
-	if (!ide->null) ide->null = (readhdd(&ide->drive[ide->regs.drv], lba, cnt) <= 0);
+	if (!ide->null) ide->null = (ide_read(&ide->drive[ide->regs.drv], lba, cnt) <= 0);
 	if (ide->null) memset(ide_buf, 0, cnt * 512);
 
 	while (1)
@@ -787,6 +871,11 @@ static void process_read(ide_config *ide, int multi)
 		lba += cnt;
 		ide->regs.sector_count -= cnt;
 		put_lba(ide, lba);
+		ide_ra.seq_f = ide->drive[ide->regs.drv].f;
+		ide_ra.seq_lba = lba;
+
+		// next block of this command, or the same size past its end
+		if (!ide->null && (ide->regs.sector_count || seq)) ide_ra_queue(&ide->drive[ide->regs.drv], lba, ide->regs.sector_count ? (multi ? get_cnt(ide) : 1) : cnt);
 
 		ide->regs.io_size = cnt;
 		ide->regs.status = ATA_STATUS_RDP | ATA_STATUS_RDY | ATA_STATUS_DRQ | ATA_STATUS_IRQ;
@@ -812,7 +901,7 @@ static void process_read(ide_config *ide, int multi)
 		}
 
 		cnt = multi ? get_cnt(ide) : 1;
-		if (!ide->null) ide->null = (readhdd(&ide->drive[ide->regs.drv], lba, cnt) <= 0);
+		if (!ide->null) ide->null = (ide_read(&ide->drive[ide->regs.drv], lba, cnt) <= 0);
 		if (ide->null) memset(ide_buf, 0, cnt * 512);
 
 		ide_req = 0;
@@ -834,6 +923,7 @@ static void process_write(ide_config *ide, int multi)
 	uint32_t cnt = 1;
 	uint16_t ide_req;
 
+	ide_ra_drop();
 	ide->null = (ide->regs.cmd != 0xFA) ? !FileSeekLBA(ide->drive[ide->regs.drv].f, (lba <= ide->drive[ide->regs.drv].offset) ? 0 : (lba - ide->drive[ide->regs.drv].offset)) : 1;
 	uint8_t irq = 0;
 
@@ -1117,6 +1207,8 @@ int ide_open(uint8_t unit, const char* filename)
 	static fileTYPE hdd_file[4] = {};
 	chs_t chs = {};
 
+	ide_ra_flush();
+
 	if (!is_minimig()
 	    || ((minimig_config.ide_cfg & 1) && minimig_config.hardfile[unit].cfg))
 	{
@@ -1180,19 +1180,8 @@ int cdrom_read_raw_sector(drive_t *drive, uint32_t lba, uint8_t *buf)
 
 	if (sz == BYTES_PER_COOKED_REDBOOK_FRAME)
 	{
-		memset(buf, 0, BYTES_PER_RAW_REDBOOK_FRAME);
-		buf[0] = 0x00;
-		memset(buf + 1, 0xff, 10);
-		buf[11] = 0x00;
-		uint32_t f_lba = lba + REDBOOK_FRAME_PADDING;
-		uint8_t mm = (uint8_t)(f_lba / (REDBOOK_FRAMES_PER_SECOND * 60));
-		uint8_t ss = (uint8_t)((f_lba / REDBOOK_FRAMES_PER_SECOND) % 60);
-		uint8_t ff = (uint8_t)(f_lba % REDBOOK_FRAMES_PER_SECOND);
-		buf[12] = (uint8_t)(((mm / 10) << 4) | (mm % 10));
-		buf[13] = (uint8_t)(((ss / 10) << 4) | (ss % 10));
-		buf[14] = (uint8_t)(((ff / 10) << 4) | (ff % 10));
-		buf[15] = 0x01;
 		if (FileReadAdv(&track->f, buf + 16, 2048, -1) <= 0) return -1;
+		cd_make_mode1_sector(buf, lba);
 		return 0;
 	}
 
@@ -1931,6 +1920,7 @@ void ide_cdda_send_sector()
 
 			}
 			uint32_t pos = read_track->skip + (drv->play_start_lba - read_track->start) * read_track->sectorSize;
+			FileSetStream(&read_track->f);
 			if (FileSeek(&read_track->f, pos, SEEK_SET))
 			{
 				FileReadAdv(&read_track->f, cdda_buf, sizeof(cdda_buf), -1);
@@ -36,6 +36,7 @@
 #include "frame_timer.h"
 #include "scaler.h"
 #include "file_io.h"
+#include "input_latency.h"
 
 #define NUMDEV 30
 #define UINPUT_NAME "MiSTer virtual input"
@@ -1922,6 +1923,278 @@ static void input_lightgun_load(int idx)
 	FileLoadConfig(name, input[idx].guncal, 4 * sizeof(int32_t));
 }
 
+// Device quirks, matched by VID/PID when a device is opened.
+// Table must stay sorted by vid (checked at compile time), entries of the same vid
+// are applied in table order so later ones can override earlier ones.
+
+#define QF_LIGHTGUN  0x01 // set lightgun flag
+#define QF_GUNCAL    0x02 // apply guncal defaults and load saved calibration
+#define QF_LATE      0x04 // applied after the MiSTer-S1/A1 and JAMMA overrides
+
+struct input_quirk_t
+{
+	uint16_t vid;
+	uint16_t pid_min;
+	uint16_t pid_max;
+	const char *match; // substring required in name or uniq, NULL - any
+	int quirk;         // QUIRK_NONE - keep current
+	int flags;
+	int guncal[4];
+	int (*setup)(int dev); // extra setup, returns 0 if device must be skipped
+};
+
+static int quirk_sony(int dev)
+{
+	// don't use Accelerometer
+	return !strcasestr(input[dev].name, "Motion");
+}
+
+static int quirk_ds4(int dev)
+{
+	if (strcasestr(input[dev].name, "Touchpad")) input[dev].quirk = QUIRK_DS4TOUCH;
+	return 1;
+}
+
+static int quirk_mayflash(int dev)
+{
+	input[dev].num = 2; // force mayflash mode 1/2 as second joystick.
+	return 1;
+}
+
+static int quirk_wiimote(int dev)
+{
+	// don't use Accelerometer
+	if (strcasestr(input[dev].name, "Accelerometer")) return 0;
+	if (strcasestr(input[dev].name, "Motion Plus")) return 0;
+
+	if (!strcasestr(input[dev].name, "Pro Controller"))
+	{
+		static const int cal[4] = { 0, 767, 1, 1023 };
+		input[dev].quirk = QUIRK_WIIMOTE;
+		memcpy(input[dev].guncal, cal, sizeof(input[dev].guncal));
+		input_lightgun_load(dev);
+	}
+	return 1;
+}
+
+static int quirk_nintendo(int dev)
+{
+	// don't use Accelerometer
+	return !strstr(input[dev].name, " IMU");
+}
+
+static int quirk_joycon_l(int dev)
+{
+	input[dev].misc_flags = 1 << 30;
+	return 1;
+}
+
+static int quirk_joycon_r(int dev)
+{
+	input[dev].misc_flags = 1 << 29;
+	return 1;
+}
+
+static int quirk_raspad(int dev)
+{
+	input[dev].num = 1;
+	input[dev].map_shown = 1;
+	input[dev].lightgun = 0;
+	return 1;
+}
+
+static int quirk_vcs(int dev)
+{
+	input[dev].spinner_acc = -1;
+	input[dev].misc_flags = 0;
+	return 1;
+}
+
+static int quirk_openfire(int dev)
+{
+	// OF generates 3 devices, so just focus on the one actual gamepad slot.
+	int len = strlen(input[dev].name);
+	if (len >= 5 && !memcmp(input[dev].name + len - 5, "Mouse", 5)) return 1;
+	if (len >= 8 && !memcmp(input[dev].name + len - 8, "Keyboard", 8)) return 1;
+
+	static const int cal[4] = { -32767, 32767, -32767, 32767 };
+	input[dev].quirk = QUIRK_LIGHTGUN;
+	input[dev].lightgun = 1;
+	memcpy(input[dev].guncal, cal, sizeof(input[dev].guncal));
+	input_lightgun_load(dev);
+	return 1;
+}
+
+#define GUN_CAL_15BIT { 0, 32767, 0, 32767 }
+
+static constexpr input_quirk_t input_quirks[] =
+{
+	{ 0x0079, 0x1802, 0x1802, NULL, QUIRK_NONE, QF_LIGHTGUN, {}, quirk_mayflash },                              // Mayflash
+	{ 0x045e, 0x0b00, 0x0b00, NULL, QUIRK_SHIFT, QF_LATE, {}, NULL },                                           // XBox Elite 2, paddles as shift for chatpad
+	{ 0x0483, 0x5750, 0x5753, NULL, QUIRK_LIGHTGUN_MOUSE, QF_LIGHTGUN | QF_GUNCAL, { 0, 767, 0, 1023 }, NULL }, // Retroshooter
+	{ 0x054c, 0x0000, 0xffff, NULL, QUIRK_NONE, 0, {}, quirk_sony },
+	{ 0x054c, 0x0268, 0x0268, NULL, QUIRK_DS3, 0, {}, NULL },
+	{ 0x054c, 0x05c4, 0x05c4, NULL, QUIRK_DS4, 0, {}, quirk_ds4 },
+	{ 0x054c, 0x09cc, 0x09cc, NULL, QUIRK_DS4, 0, {}, quirk_ds4 },
+	{ 0x054c, 0x0ba0, 0x0ba0, NULL, QUIRK_DS4, 0, {}, quirk_ds4 },
+	{ 0x054c, 0x0ce6, 0x0ce6, NULL, QUIRK_DS4, 0, {}, quirk_ds4 },
+	{ 0x057e, 0x0306, 0x0306, NULL, QUIRK_NONE, 0, {}, quirk_wiimote },
+	{ 0x057e, 0x0330, 0x0330, NULL, QUIRK_NONE, 0, {}, quirk_wiimote },
+	{ 0x057e, 0x0000, 0xffff, NULL, QUIRK_NONE, 0, {}, quirk_nintendo },
+	{ 0x057e, 0x2006, 0x2006, NULL, QUIRK_JOYCON, 0, {}, quirk_joycon_l },
+	{ 0x057e, 0x2007, 0x2007, NULL, QUIRK_JOYCON, 0, {}, quirk_joycon_r },
+	{ 0x0738, 0x4758, 0x4758, NULL, QUIRK_MADCATZ360, 0, {}, NULL },                                             // Madcatz Arcade Stick 360
+	{ 0x0b9a, 0x016a, 0x016a, NULL, QUIRK_LIGHTGUN_CRT, QF_LIGHTGUN | QF_GUNCAL, { 25, 245, 145, 700 }, NULL }, // Namco GunCon 2
+	{ 0x0b9a, 0x0800, 0x0800, NULL, QUIRK_LIGHTGUN, QF_LIGHTGUN | QF_GUNCAL, { -32768, 32767, -32768, 32767 }, NULL }, // Namco GunCon 3
+	{ 0x1209, 0x595a, 0x595a, "RZordPsGun", QUIRK_LIGHTGUN, QF_LIGHTGUN | QF_GUNCAL, GUN_CAL_15BIT, NULL },     // Namco Guncon via RetroZord
+	{ 0x16c0, 0x0f01, 0x0f02, NULL, QUIRK_LIGHTGUN, QF_LIGHTGUN | QF_GUNCAL, { 0, 65535, 0, 65535 }, NULL },    // Sinden (PIDs depend on gun color/config)
+	{ 0x16c0, 0x0f38, 0x0f39, NULL, QUIRK_LIGHTGUN, QF_LIGHTGUN | QF_GUNCAL, { 0, 65535, 0, 65535 }, NULL },
+	{ 0x16d0, 0x0f01, 0x0f02, NULL, QUIRK_LIGHTGUN, QF_LIGHTGUN | QF_GUNCAL, { 0, 65535, 0, 65535 }, NULL },
+	{ 0x16d0, 0x0f38, 0x0f39, NULL, QUIRK_LIGHTGUN, QF_LIGHTGUN | QF_GUNCAL, { 0, 65535, 0, 65535 }, NULL },
+	{ 0x16d0, 0x127e, 0x127e, "ReflexPSGun", QUIRK_LIGHTGUN, QF_LIGHTGUN | QF_GUNCAL, GUN_CAL_15BIT, NULL },    // Namco Guncon via Reflex Adapt
+	{ 0x222a, 0x0001, 0x0001, NULL, QUIRK_TOUCHGUN, QF_GUNCAL, { 0, 16383, 2047, 14337 }, quirk_raspad },      // RasPad3 touchscreen
+	{ 0x2341, 0x0000, 0xffff, "RZordPsGun", QUIRK_LIGHTGUN, QF_LIGHTGUN | QF_GUNCAL, GUN_CAL_15BIT, NULL },     // Namco Guncon via Arduino
+	{ 0x2341, 0x8042, 0x8049, NULL, QUIRK_LIGHTGUN, QF_LIGHTGUN | QF_GUNCAL, GUN_CAL_15BIT, NULL },             // GUN4IR
+	{ 0x3250, 0x1001, 0x1001, NULL, QUIRK_VCS, QF_LATE, {}, quirk_vcs },                                        // Atari VCS wireless joystick with spinner
+	{ 0x3673, 0x0100, 0x0103, NULL, QUIRK_LIGHTGUN, QF_LIGHTGUN | QF_GUNCAL, GUN_CAL_15BIT, NULL },             // Blamcon
+	{ 0x3673, 0x0200, 0x0203, NULL, QUIRK_LIGHTGUN, QF_LIGHTGUN | QF_GUNCAL, GUN_CAL_15BIT, NULL },
+	{ 0xd209, 0x1601, 0x1601, NULL, QUIRK_NONE, QF_LIGHTGUN, {}, NULL },                                        // Ultimarc lightgun
+	// OpenFIRE has a user-configurable PID, but the VID is reserved and every device name has the prefix "OpenFIRE"
+	{ 0xf143, 0x0000, 0xffff, "OpenFIRE ", QUIRK_NONE, 0, {}, quirk_openfire },
+};
+
+static constexpr bool quirks_sorted(const input_quirk_t *q, size_t n)
+{
+	return n < 2 || (q[0].vid <= q[1].vid && quirks_sorted(q + 1, n - 1));
+}
+static_assert(quirks_sorted(input_quirks, sizeof(input_quirks) / sizeof(input_quirks[0])), "input_quirks must be sorted by vid");
+
+// User additions from linux/input_quirks.txt, one device per line:
+//   VID PID[-PID] lightgun|lightgun_crt|lightgun_mouse|ignore [cal_x_min cal_x_max cal_y_min cal_y_max]
+// Applied after the built-in entries, so they can override them.
+#define USER_QUIRKS_FILE "linux/input_quirks.txt"
+#define USER_QUIRKS_MAX  64
+
+static input_quirk_t user_quirks[USER_QUIRKS_MAX];
+static int user_quirks_num = -1;
+
+static int quirk_ignore(int)
+{
+	return 0;
+}
+
+static int quirk_cmp(const void *a, const void *b)
+{
+	const input_quirk_t *qa = (const input_quirk_t*)a;
+	const input_quirk_t *qb = (const input_quirk_t*)b;
+	return (int)qa->vid - (int)qb->vid;
+}
+
+static void load_user_quirks()
+{
+	user_quirks_num = 0;
+
+	fileTextReader reader = {};
+	if (!FileOpenTextReader(&reader, USER_QUIRKS_FILE)) return;
+
+	const char *line;
+	while ((line = FileReadLine(&reader)) && user_quirks_num < USER_QUIRKS_MAX)
+	{
+		unsigned int vid, pid_min, pid_max;
+		char type[32];
+		int cal[4] = GUN_CAL_15BIT;
+		int n;
+
+		if (sscanf(line, "%x %x-%x %31s %n", &vid, &pid_min, &pid_max, type, &n) != 4)
+		{
+			if (sscanf(line, "%x %x %31s %n", &vid, &pid_min, type, &n) != 3)
+			{
+				printf("input quirks: bad line: %s\n", line);
+				continue;
+			}
+			pid_max = pid_min;
+		}
+
+		input_quirk_t *q = &user_quirks[user_quirks_num];
+		memset(q, 0, sizeof(*q));
+		q->vid = vid;
+		q->pid_min = pid_min;
+		q->pid_max = pid_max;
+
+		if (!strcasecmp(type, "ignore")) q->setup = quirk_ignore;
+		else
+		{
+			if (!strcasecmp(type, "lightgun")) q->quirk = QUIRK_LIGHTGUN;
+			else if (!strcasecmp(type, "lightgun_crt")) q->quirk = QUIRK_LIGHTGUN_CRT;
+			else if (!strcasecmp(type, "lightgun_mouse")) q->quirk = QUIRK_LIGHTGUN_MOUSE;
+			else
+			{
+				printf("input quirks: unknown type: %s\n", type);
+				continue;
+			}
+
+			sscanf(line + n, "%d %d %d %d", &cal[0], &cal[1], &cal[2], &cal[3]);
+			q->flags = QF_LIGHTGUN | QF_GUNCAL;
+			memcpy(q->guncal, cal, sizeof(q->guncal));
+		}
+
+		printf("input quirks: %04x:%04x-%04x %s\n", q->vid, q->pid_min, q->pid_max, type);
+		user_quirks_num++;
+	}
+
+	// insertion sort keeps the file order within a vid
+	for (int i = 1; i < user_quirks_num; i++)
+	{
+		input_quirk_t q = user_quirks[i];
+		int j = i - 1;
+		while (j >= 0 && quirk_cmp(&user_quirks[j], &q) > 0)
+		{
+			user_quirks[j + 1] = user_quirks[j];
+			j--;
+		}
+		user_quirks[j + 1] = q;
+	}
+}
+
+// Apply all entries of the table matching the device and pass. Returns 0 if device must be skipped.
+static int apply_quirks(const input_quirk_t *tbl, int num, int dev, const char *uniq, int late)
+{
+	// lower bound of vid
+	int lo = 0, hi = num;
+	while (lo < hi)
+	{
+		int mid = (lo + hi) / 2;
+		if (tbl[mid].vid < input[dev].vid) lo = mid + 1;
+		else hi = mid;
+	}
+
+	for (const input_quirk_t *q = tbl + lo; q < tbl + num && q->vid == input[dev].vid; q++)
+	{
+		if (input[dev].pid < q->pid_min || input[dev].pid > q->pid_max) continue;
+		if (!(q->flags & QF_LATE) != !late) continue;
+		if (q->match && !strstr(uniq, q->match) && !strstr(input[dev].name, q->match)) continue;
+
+		if (q->quirk != QUIRK_NONE) input[dev].quirk = q->quirk;
+		if (q->setup && !q->setup(dev)) return 0;
+		if (q->flags & QF_LIGHTGUN) input[dev].lightgun = 1;
+		if (q->flags & QF_GUNCAL)
+		{
+			memcpy(input[dev].guncal, q->guncal, sizeof(input[dev].guncal));
+			input_lightgun_load(dev);
+		}
+	}
+
+	return 1;
+}
+
+static int input_apply_quirks(int dev, const char *uniq, int late)
+{
+	if (user_quirks_num < 0) load_user_quirks();
+
+	if (!apply_quirks(input_quirks, sizeof(input_quirks) / sizeof(input_quirks[0]), dev, uniq, late)) return 0;
+	return apply_quirks(user_quirks, user_quirks_num, dev, uniq, late);
+}
+
 int input_has_lightgun()
 {
 	for (int i = 0; i < NUMDEV; i++)
@@ -5248,213 +5521,13 @@ int input_test(int getchar)
 							}
 						}
 
-						// RasPad3 touchscreen
-						if (input[n].vid == 0x222a && input[n].pid == 1)
-						{
-							input[n].quirk = QUIRK_TOUCHGUN;
-							input[n].num = 1;
-							input[n].map_shown = 1;
-
-							input[n].lightgun = 0;
-							input[n].guncal[0] = 0;
-							input[n].guncal[1] = 16383;
-							input[n].guncal[2] = 2047;
-							input[n].guncal[3] = 14337;
-							input_lightgun_load(n);
-						}
-
-						if (input[n].vid == 0x054c)
-						{
-							if (strcasestr(input[n].name, "Motion"))
-							{
-								// don't use Accelerometer
-								close(pool[n].fd);
-								pool[n].fd = -1;
-								continue;
-							}
-
-							if (input[n].pid == 0x0268)  input[n].quirk = QUIRK_DS3;
-							else if (input[n].pid == 0x05c4 || input[n].pid == 0x09cc || input[n].pid == 0x0ba0 || input[n].pid == 0x0ce6)
-							{
-								input[n].quirk = QUIRK_DS4;
-								if (strcasestr(input[n].name, "Touchpad"))
-								{
-									input[n].quirk = QUIRK_DS4TOUCH;
-								}
-							}
-						}
-
-						if (input[n].vid == 0x0079 && input[n].pid == 0x1802)
-						{
-							input[n].lightgun = 1;
-							input[n].num = 2; // force mayflash mode 1/2 as second joystick.
-						}
-
-						if (input[n].vid == 0x057e && (input[n].pid == 0x0306 || input[n].pid == 0x0330))
-						{
-							if (strcasestr(input[n].name, "Accelerometer"))
-							{
-								// don't use Accelerometer
-								close(pool[n].fd);
-								pool[n].fd = -1;
-								continue;
-							}
-							else if (strcasestr(input[n].name, "Motion Plus"))
-							{
-								// don't use Accelerometer
-								close(pool[n].fd);
-								pool[n].fd = -1;
-								continue;
-							}
-							else if (!strcasestr(input[n].name, "Pro Controller"))
-							{
-								input[n].quirk = QUIRK_WIIMOTE;
-								input[n].guncal[0] = 0;
-								input[n].guncal[1] = 767;
-								input[n].guncal[2] = 1;
-								input[n].guncal[3] = 1023;
-								input_lightgun_load(n);
-							}
-						}
-
-						if (input[n].vid == 0x057e)
-						{
-							if (strstr(input[n].name, " IMU"))
-							{
-								// don't use Accelerometer
-								close(pool[n].fd);
-								pool[n].fd = -1;
-								continue;
-							}
-						}
-
-						if (input[n].vid == 0x057e && input[n].pid == 0x2006)
-						{
-							input[n].misc_flags = 1 << 30;
-							input[n].quirk = QUIRK_JOYCON;
-						}
-						if (input[n].vid == 0x057e && input[n].pid == 0x2007)
-						{
-							input[n].misc_flags = 1 << 29;
-							input[n].quirk = QUIRK_JOYCON;
-						}
-
-						//Ultimarc lightgun
-						if (input[n].vid == 0xd209 && input[n].pid == 0x1601)
-						{
-							input[n].lightgun = 1;
-						}
-
-						//Namco Guncon via Arduino, RetroZord or Reflex Adapt
-						if (((input[n].vid == 0x2341 || (input[n].vid == 0x1209 && input[n].pid == 0x595A)) && (strstr(uniq, "RZordPsGun") || strstr(input[n].name, "RZordPsGun"))) ||
-							(input[n].vid == 0x16D0 && input[n].pid == 0x127E && (strstr(uniq, "ReflexPSGun") || strstr(input[n].name, "ReflexPSGun"))))
+						if (!input_apply_quirks(n, uniq, 0))
 						{
-							input[n].quirk = QUIRK_LIGHTGUN;
-							input[n].lightgun = 1;
-							input[n].guncal[0] = 0;
-							input[n].guncal[1] = 32767;
-							input[n].guncal[2] = 0;
-							input[n].guncal[3] = 32767;
-							input_lightgun_load(n);
-						}
-
-						//Namco GunCon 2
-						if (input[n].vid == 0x0b9a && input[n].pid == 0x016a)
-						{
-							input[n].quirk = QUIRK_LIGHTGUN_CRT;
-							input[n].lightgun = 1;
-							input[n].guncal[0] = 25;
-							input[n].guncal[1] = 245;
-							input[n].guncal[2] = 145;
-							input[n].guncal[3] = 700;
-							input_lightgun_load(n);
-						}
-
-						//Namco GunCon 3
-						if (input[n].vid == 0x0b9a && input[n].pid == 0x0800)
-						{
-							input[n].quirk = QUIRK_LIGHTGUN;
-							input[n].lightgun = 1;
-							input[n].guncal[0] = -32768;
-							input[n].guncal[1] = 32767;
-							input[n].guncal[2] = -32768;
-							input[n].guncal[3] = 32767;
-							input_lightgun_load(n);
-						}
-
-						//GUN4IR Lightgun
-						if (input[n].vid == 0x2341 && input[n].pid >= 0x8042 && input[n].pid <= 0x8049)
-						{
-							input[n].quirk = QUIRK_LIGHTGUN;
-							input[n].lightgun = 1;
-							input[n].guncal[0] = 0;
-							input[n].guncal[1] = 32767;
-							input[n].guncal[2] = 0;
-							input[n].guncal[3] = 32767;
-							input_lightgun_load(n);
-						}
-
-						//OpenFIRE Lightgun
-						//!Note that OF has a user-configurable PID, but the VID is reserved and every device name has the prefix "OpenFIRE"
-						if (input[n].vid == 0xf143 && strstr(input[n].name, "OpenFIRE "))
-						{
-							// OF generates 3 devices, so just focus on the one actual gamepad slot.
-							char *nameInit = input[n].name;
-							if(memcmp(nameInit+strlen(input[n].name)-5, "Mouse", 5) != 0 && memcmp(nameInit+strlen(input[n].name)-8, "Keyboard", 8) != 0)
-							{
-								input[n].quirk = QUIRK_LIGHTGUN;
-								input[n].lightgun = 1;
-								input[n].guncal[0] = -32767;
-								input[n].guncal[1] = 32767;
-								input[n].guncal[2] = -32767;
-								input[n].guncal[3] = 32767;
-								input_lightgun_load(n);
-							}
-						}
-
-						//Blamcon Lightgun
-						if (input[n].vid == 0x3673 && ((input[n].pid >= 0x0100 && input[n].pid <= 0x0103) || (input[n].pid >= 0x0200 && input[n].pid <= 0x0203)))
-						{
-							input[n].quirk = QUIRK_LIGHTGUN;
-							input[n].lightgun = 1;
-							input[n].guncal[0] = 0;
-							input[n].guncal[1] = 32767;
-							input[n].guncal[2] = 0;
-							input[n].guncal[3] = 32767;
-							input_lightgun_load(n);
-						}
-
-						//Retroshooter
-						if (input[n].vid == 0x0483 && input[n].pid >= 0x5750 && input[n].pid <= 0x5753)
-						{
-							input[n].quirk = QUIRK_LIGHTGUN_MOUSE;
-							input[n].lightgun = 1;
-							input[n].guncal[0] = 0;
-							input[n].guncal[1] = 767;
-							input[n].guncal[2] = 0;
-							input[n].guncal[3] = 1023;
-							input_lightgun_load(n);
-						}
-
-						//Sinden Lightgun (two different PIDs, four different PIDs depending on gun color/config)
-						if ((input[n].vid == 0x16c0 || input[n].vid == 0x16d0) && (
-            					input[n].pid == 0x0f01 ||
-            					input[n].pid == 0x0f02 ||
-            					input[n].pid == 0x0f38 ||
-            					input[n].pid == 0x0f39))
-						{
-    							input[n].quirk = QUIRK_LIGHTGUN;
-    							input[n].lightgun = 1;
-    							input[n].guncal[0] = 0;
-    							input[n].guncal[1] = 65535;
-    							input[n].guncal[2] = 0;
-    							input[n].guncal[3] = 65535;
-    							input_lightgun_load(n);
+							close(pool[n].fd);
+							pool[n].fd = -1;
+							continue;
 						}
 
-						//Madcatz Arcade Stick 360
-						if (input[n].vid == 0x0738 && input[n].pid == 0x4758) input[n].quirk = QUIRK_MADCATZ360;
-
 						// mr.Spinner
 						// 0x120  - Button
 						// Axis 7 - EV_REL is spinner
@@ -5482,12 +5555,11 @@ int input_test(int getchar)
 							input[n].quirk = QUIRK_JAMMA2;
 						}
 
-						//Atari VCS wireless joystick with spinner
-						if (input[n].vid == 0x3250 && input[n].pid == 0x1001)
+						if (!input_apply_quirks(n, uniq, 1))
 						{
-							input[n].quirk = QUIRK_VCS;
-							input[n].spinner_acc = -1;
-							input[n].misc_flags = 0;
+							close(pool[n].fd);
+							pool[n].fd = -1;
+							continue;
 						}
 
 						//Arduino and Teensy devices may share the same VID:PID, so additional field UNIQ is used to differentiate them
@@ -5518,10 +5590,6 @@ int input_test(int getchar)
 							snprintf(input[n].idstr, sizeof(input[n].idstr), "%04x_%04x", input[n].vid, input[n].pid);
 						}
 
-						//XBox Elite 2 controller, use paddles as a special shift for chatpad accessory.
-						//Works only through cable or USB dongle.
-						if (input[n].vid == 0x045e && input[n].pid == 0x0b00) input[n].quirk = QUIRK_SHIFT;
-
 						// use specific keyboard(s) as a joystick
 						for (int i = 0; i < (int)cfg.keyboard_as_joystick[0]; i++) input[n].force_joy = (input[n].vid == (cfg.keyboard_as_joystick[i + 1] >> 16) && input[n].pid == (cfg.keyboard_as_joystick[i + 1] & 0xFFFF));
 
@@ -5646,6 +5714,8 @@ int input_test(int getchar)
 						memset(&ev, 0, sizeof(ev));
 						if (read(pool[i].fd, &ev, sizeof(ev)) == sizeof(ev))
 						{
+							if (!getchar) LATENCY_READ(i, pool[i].fd, input[i].vid, input[i].pid, &ev);
+
 							if (getchar)
 							{
 								if (ev.type == EV_KEY && ev.value >= 1)
@@ -6258,6 +6328,7 @@ int input_test(int getchar)
 						}
 						request_screenshot(p, scaled);
 					}
+					else if (!strncmp(cmd, "input_", 6)) input_latency_cmd(cmd);
 					else if (!strncmp(cmd, "volume ", 7))
 					{
 						if (!strcmp(cmd + 7, "mute")) set_volume(0x81);
@@ -6335,6 +6406,8 @@ int input_poll(int getchar)
 	int ret = input_test(getchar);
 	if (getchar) return ret;
 
+	LATENCY_MAPPED();
+
 	uinp_check_key();
 
 	static int prev_dx = 0;
@@ -6409,6 +6482,7 @@ int input_poll(int getchar)
 		}
 	}
 
+	LATENCY_POLL_DONE();
 	return 0;
 }
 
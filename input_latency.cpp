@@ -0,0 +1,510 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <linux/input.h>
+#include <linux/uinput.h>
+
+#include "input_latency.h"
+#include "file_io.h"
+
+uint32_t input_latency_flags = 0;
+
+/////////////////////////////////////////////////////////////////////////
+// Latency histograms
+//
+// Stages of a joystick event:
+//   kernel:  evdev timestamp -> read() in input_test
+//   map:     read() -> input_test done (mapping, autofire, key_states)
+//   send:    input_test done -> new mask written to FPGA by user_io_digital_joystick
+//   total:   evdev timestamp -> FPGA
+//
+// Only the first event since the last joystick update is tracked, so the
+// numbers show the worst case for an input change within a poll cycle.
+/////////////////////////////////////////////////////////////////////////
+
+enum
+{
+	LAT_KERNEL = 0,
+	LAT_MAP,
+	LAT_SEND,
+	LAT_TOTAL,
+	LAT_STAGES
+};
+
+static const char *lat_stage_name[LAT_STAGES] = { "kernel", "map", "send", "total" };
+
+#define LAT_BUCKETS 24 // log2 buckets of us, last one is open ended
+
+struct lat_hist_t
+{
+	uint32_t cnt;
+	uint32_t min;
+	uint32_t max;
+	uint64_t sum;
+	uint32_t bucket[LAT_BUCKETS];
+};
+
+static lat_hist_t lat_hist[LAT_STAGES];
+
+static int lat_pending = 0;
+static int lat_mapped = 0;
+static uint32_t lat_kernel_us;
+static uint64_t lat_read_us;
+static uint64_t lat_mapped_us;
+
+static uint64_t mono_us()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+}
+
+static void lat_add(int stage, uint32_t us)
+{
+	lat_hist_t *h = &lat_hist[stage];
+
+	int b = 0;
+	while (b < LAT_BUCKETS - 1 && us >= (2u << b)) b++;
+	h->bucket[b]++;
+
+	if (!h->cnt || us < h->min) h->min = us;
+	if (us > h->max) h->max = us;
+	h->sum += us;
+	h->cnt++;
+}
+
+// upper bound of the bucket holding the given percentile
+static uint32_t lat_percentile(const lat_hist_t *h, int pct)
+{
+	uint32_t need = (uint32_t)(((uint64_t)h->cnt * pct + 99) / 100);
+	uint32_t acc = 0;
+	for (int b = 0; b < LAT_BUCKETS; b++)
+	{
+		acc += h->bucket[b];
+		if (acc >= need) return (b == LAT_BUCKETS - 1) ? h->max : (2u << b) - 1;
+	}
+	return h->max;
+}
+
+static void lat_reset()
+{
+	memset(lat_hist, 0, sizeof(lat_hist));
+	lat_pending = 0;
+	lat_mapped = 0;
+}
+
+static void lat_dump(FILE *f)
+{
+	fprintf(f, "stage      count      min      avg      p50      p99      max (us)\n");
+	for (int s = 0; s < LAT_STAGES; s++)
+	{
+		const lat_hist_t *h = &lat_hist[s];
+		fprintf(f, "%-8s %7u %8u %8u %8u %8u %8u\n", lat_stage_name[s], h->cnt, h->min,
+			h->cnt ? (uint32_t)(h->sum / h->cnt) : 0, lat_percentile(h, 50), lat_percentile(h, 99), h->max);
+	}
+
+	fprintf(f, "\n   <us  ");
+	for (int s = 0; s < LAT_STAGES; s++) fprintf(f, "%9s", lat_stage_name[s]);
+	fprintf(f, "\n");
+
+	for (int b = 0; b < LAT_BUCKETS; b++)
+	{
+		int used = 0;
+		for (int s = 0; s < LAT_STAGES; s++) used |= lat_hist[s].bucket[b];
+		if (!used) continue;
+
+		if (b == LAT_BUCKETS - 1) fprintf(f, "%8s", "more");
+		else fprintf(f, "%8u", 2u << b);
+		for (int s = 0; s < LAT_STAGES; s++) fprintf(f, "%9u", lat_hist[s].bucket[b]);
+		fprintf(f, "\n");
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////
+// Recording
+/////////////////////////////////////////////////////////////////////////
+
+#define REC_MAGIC   0x5645494D // "MIEV"
+#define REC_VERSION 1
+#define REC_DEVS    32
+
+enum
+{
+	REC_EVENT = 0,
+	REC_ABSINFO
+};
+
+struct rec_hdr_t
+{
+	uint32_t magic;
+	uint32_t version;
+};
+
+struct rec_entry_t
+{
+	uint32_t t_us;   // since start of recording
+	uint16_t vid;
+	uint16_t pid;
+	uint16_t type;
+	uint16_t code;
+	uint8_t  dev;
+	uint8_t  kind;
+	uint16_t reserved;
+	int32_t  value;
+	int32_t  min;    // REC_ABSINFO only
+	int32_t  max;
+};
+
+static FILE *rec_file = NULL;
+static uint64_t rec_start;
+static uint8_t rec_abs_seen[REC_DEVS][(ABS_CNT + 7) / 8];
+
+static void rec_stop()
+{
+	if (!rec_file) return;
+
+	fclose(rec_file);
+	rec_file = NULL;
+	input_latency_flags &= ~LATENCY_RECORD;
+	printf("input_record: stopped.\n");
+}
+
+static void rec_start_file(const char *name)
+{
+	rec_stop();
+
+	const char *path = (name[0] == '/') ? name : getFullPath(name);
+	rec_file = fopen(path, "wb");
+	if (!rec_file)
+	{
+		printf("input_record: cannot create %s\n", path);
+		return;
+	}
+
+	rec_hdr_t hdr = { REC_MAGIC, REC_VERSION };
+	fwrite(&hdr, sizeof(hdr), 1, rec_file);
+
+	memset(rec_abs_seen, 0, sizeof(rec_abs_seen));
+	rec_start = mono_us();
+	input_latency_flags |= LATENCY_RECORD;
+	printf("input_record: recording to %s\n", path);
+}
+
+static void rec_event(int dev, int fd, uint16_t vid, uint16_t pid, const struct input_event *ev)
+{
+	if (dev >= REC_DEVS) return;
+
+	rec_entry_t e = {};
+	e.t_us = (uint32_t)(mono_us() - rec_start);
+	e.vid = vid;
+	e.pid = pid;
+	e.dev = dev;
+
+	// replay needs the axis ranges to create a matching device
+	if (ev->type == EV_ABS && ev->code < ABS_CNT && !(rec_abs_seen[dev][ev->code / 8] & (1 << (ev->code % 8))))
+	{
+		struct input_absinfo absinfo;
+		if (ioctl(fd, EVIOCGABS(ev->code), &absinfo) >= 0)
+		{
+			rec_abs_seen[dev][ev->code / 8] |= 1 << (ev->code % 8);
+			e.kind = REC_ABSINFO;
+			e.type = EV_ABS;
+			e.code = ev->code;
+			e.value = absinfo.value;
+			e.min = absinfo.minimum;
+			e.max = absinfo.maximum;
+			fwrite(&e, sizeof(e), 1, rec_file);
+		}
+	}
+
+	e.kind = REC_EVENT;
+	e.type = ev->type;
+	e.code = ev->code;
+	e.value = ev->value;
+	e.min = 0;
+	e.max = 0;
+	fwrite(&e, sizeof(e), 1, rec_file);
+}
+
+/////////////////////////////////////////////////////////////////////////
+// Replay through uinput devices with the recorded VID/PID, so the
+// events take the same path as the ones from real controllers.
+/////////////////////////////////////////////////////////////////////////
+
+struct replay_t
+{
+	rec_entry_t *rec;
+	int num;
+};
+
+static volatile int replay_running = 0;
+
+static void *replay_thread(void *arg)
+{
+	replay_t *rp = (replay_t*)arg;
+	int fds[REC_DEVS];
+	struct uinput_user_dev uinp[REC_DEVS];
+	int used[REC_DEVS] = {};
+	uint8_t evbits[REC_DEVS] = {};
+
+	memset(uinp, 0, sizeof(uinp));
+	for (int i = 0; i < REC_DEVS; i++) fds[i] = -1;
+
+	for (int i = 0; i < rp->num; i++)
+	{
+		const rec_entry_t *e = &rp->rec[i];
+		if (e->dev >= REC_DEVS) continue;
+
+		int d = e->dev;
+		if (!used[d])
+		{
+			used[d] = 1;
+			fds[d] = open("/dev/uinput", O_WRONLY | O_NDELAY | O_CLOEXEC);
+			if (fds[d] < 0)
+			{
+				printf("input_replay: unable to open /dev/uinput\n");
+				continue;
+			}
+
+			snprintf(uinp[d].name, UINPUT_MAX_NAME_SIZE, "MiSTer replay %04x:%04x", e->vid, e->pid);
+			uinp[d].id.bustype = BUS_USB;
+			uinp[d].id.vendor = e->vid;
+			uinp[d].id.product = e->pid;
+			uinp[d].id.version = 1;
+		}
+
+		if (fds[d] < 0) continue;
+
+		if (e->kind == REC_ABSINFO && e->code < ABS_CNT)
+		{
+			uinp[d].absmin[e->code] = e->min;
+			uinp[d].absmax[e->code] = e->max;
+		}
+
+		if (e->type < 8 && !(evbits[d] & (1 << e->type)))
+		{
+			evbits[d] |= 1 << e->type;
+			ioctl(fds[d], UI_SET_EVBIT, e->type);
+		}
+
+		if (e->type == EV_KEY) ioctl(fds[d], UI_SET_KEYBIT, e->code);
+		else if (e->type == EV_ABS) ioctl(fds[d], UI_SET_ABSBIT, e->code);
+		else if (e->type == EV_REL) ioctl(fds[d], UI_SET_RELBIT, e->code);
+		else if (e->type == EV_MSC) ioctl(fds[d], UI_SET_MSCBIT, e->code);
+	}
+
+	for (int d = 0; d < REC_DEVS; d++)
+	{
+		if (fds[d] < 0) continue;
+
+		if (write(fds[d], &uinp[d], sizeof(uinp[d])) != sizeof(uinp[d]) || ioctl(fds[d], UI_DEV_CREATE))
+		{
+			printf("input_replay: unable to create device %d\n", d);
+			close(fds[d]);
+			fds[d] = -1;
+		}
+	}
+
+	// give input_test time to pick up the new devices
+	sleep(2);
+
+	printf("input_replay: playing %d records.\n", rp->num);
+
+	uint64_t start = mono_us();
+	for (int i = 0; i < rp->num && replay_running; i++)
+	{
+		const rec_entry_t *e = &rp->rec[i];
+		if (e->kind != REC_EVENT || e->dev >= REC_DEVS || fds[e->dev] < 0) continue;
+
+		uint64_t due = start + e->t_us;
+		uint64_t now = mono_us();
+		if (due > now)
+		{
+			struct timespec ts = { (time_t)((due - now) / 1000000), (long)(((due - now) % 1000000) * 1000) };
+			nanosleep(&ts, NULL);
+		}
+
+		struct input_event ev = {};
+		ev.type = e->type;
+		ev.code = e->code;
+		ev.value = e->value;
+		if (write(fds[e->dev], &ev, sizeof(ev)) != sizeof(ev)) printf("input_replay: write failed\n");
+	}
+
+	// let the last events drain before the devices disappear
+	sleep(1);
+
+	for (int d = 0; d < REC_DEVS; d++)
+	{
+		if (fds[d] < 0) continue;
+		ioctl(fds[d], UI_DEV_DESTROY);
+		close(fds[d]);
+	}
+
+	printf("input_replay: done.\n");
+
+	free(rp->rec);
+	free(rp);
+	replay_running = 0;
+	return NULL;
+}
+
+static void replay_start(const char *name)
+{
+	if (replay_running)
+	{
+		printf("input_replay: already running.\n");
+		return;
+	}
+
+	const char *path = (name[0] == '/') ? name : getFullPath(name);
+	FILE *f = fopen(path, "rb");
+	if (!f)
+	{
+		printf("input_replay: cannot open %s\n", path);
+		return;
+	}
+
+	rec_hdr_t hdr = {};
+	fseek(f, 0, SEEK_END);
+	long size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	if (fread(&hdr, sizeof(hdr), 1, f) != 1 || hdr.magic != REC_MAGIC || hdr.version != REC_VERSION)
+	{
+		printf("input_replay: %s is not an input recording.\n", path);
+		fclose(f);
+		return;
+	}
+
+	replay_t *rp = (replay_t*)malloc(sizeof(replay_t));
+	if (!rp)
+	{
+		printf("input_replay: out of memory.\n");
+		fclose(f);
+		return;
+	}
+
+	rp->num = (size - sizeof(hdr)) / sizeof(rec_entry_t);
+	rp->rec = (rec_entry_t*)malloc(rp->num * sizeof(rec_entry_t) + 1);
+	if (!rp->rec || (int)fread(rp->rec, sizeof(rec_entry_t), rp->num, f) != rp->num)
+	{
+		printf("input_replay: failed to read %s\n", path);
+		fclose(f);
+		free(rp->rec);
+		free(rp);
+		return;
+	}
+	fclose(f);
+
+	replay_running = 1;
+
+	pthread_t thread;
+	if (pthread_create(&thread, NULL, replay_thread, rp))
+	{
+		printf("input_replay: failed to start thread.\n");
+		replay_running = 0;
+		free(rp->rec);
+		free(rp);
+		return;
+	}
+	pthread_detach(thread);
+}
+
+/////////////////////////////////////////////////////////////////////////
+
+void latency_event_read(int dev, int fd, uint16_t vid, uint16_t pid, const struct input_event *ev)
+{
+	if (input_latency_flags & LATENCY_RECORD) rec_event(dev, fd, vid, pid, ev);
+
+	if ((input_latency_flags & LATENCY_MEASURE) && !lat_pending && ev->type)
+	{
+		// evdev stamps events with CLOCK_REALTIME by default
+		struct timespec rt;
+		clock_gettime(CLOCK_REALTIME, &rt);
+		int64_t k = ((int64_t)rt.tv_sec - ev->time.tv_sec) * 1000000 + (rt.tv_nsec / 1000 - ev->time.tv_usec);
+
+		lat_kernel_us = (k < 0) ? 0 : (uint32_t)k;
+		lat_read_us = mono_us();
+		lat_pending = 1;
+		lat_mapped = 0;
+	}
+}
+
+void latency_event_mapped()
+{
+	if (lat_pending && !lat_mapped)
+	{
+		lat_mapped_us = mono_us();
+		lat_mapped = 1;
+	}
+}
+
+void latency_joystick_sent()
+{
+	if (!lat_pending) return;
+
+	uint64_t now = mono_us();
+	if (!lat_mapped) lat_mapped_us = now;
+
+	lat_add(LAT_KERNEL, lat_kernel_us);
+	lat_add(LAT_MAP, (uint32_t)(lat_mapped_us - lat_read_us));
+	lat_add(LAT_SEND, (uint32_t)(now - lat_mapped_us));
+	lat_add(LAT_TOTAL, lat_kernel_us + (uint32_t)(now - lat_read_us));
+	lat_pending = 0;
+}
+
+void latency_poll_done()
+{
+	// events which didn't change any joystick (keyboard, mouse, noise)
+	lat_pending = 0;
+}
+
+#define LATENCY_LOG "/tmp/input_latency.txt"
+
+int input_latency_cmd(const char *cmd)
+{
+	if (!strncmp(cmd, "input_latency ", 14))
+	{
+		const char *arg = cmd + 14;
+		if (!strcmp(arg, "on"))
+		{
+			lat_reset();
+			input_latency_flags |= LATENCY_MEASURE;
+		}
+		else if (!strcmp(arg, "off")) input_latency_flags &= ~LATENCY_MEASURE;
+		else if (!strcmp(arg, "reset")) lat_reset();
+		else if (!strcmp(arg, "dump"))
+		{
+			lat_dump(stdout);
+			FILE *f = fopen(LATENCY_LOG, "w");
+			if (f)
+			{
+				lat_dump(f);
+				fclose(f);
+			}
+		}
+		return 1;
+	}
+
+	if (!strncmp(cmd, "input_record ", 13))
+	{
+		if (!strcmp(cmd + 13, "stop")) rec_stop();
+		else rec_start_file(cmd + 13);
+		return 1;
+	}
+
+	if (!strncmp(cmd, "input_replay ", 13))
+	{
+		if (!strcmp(cmd + 13, "stop")) replay_running = 0;
+		else replay_start(cmd + 13);
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,29 @@
+#ifndef INPUT_LATENCY_H
+#define INPUT_LATENCY_H
+
+#include <stdint.h>
+#include <linux/input.h>
+
+#define LATENCY_MEASURE  1
+#define LATENCY_RECORD   2
+
+extern uint32_t input_latency_flags;
+
+void latency_event_read(int dev, int fd, uint16_t vid, uint16_t pid, const struct input_event *ev);
+void latency_event_mapped();
+void latency_joystick_sent();
+void latency_poll_done();
+
+// MiSTer_cmd handlers:
+//   input_latency on|off|reset|dump
+//   input_record <file>|stop
+//   input_replay <file>
+int input_latency_cmd(const char *cmd);
+
+// hot path wrappers, cost a single test while instrumentation is off
+#define LATENCY_READ(dev, fd, vid, pid, ev) do { if (input_latency_flags) latency_event_read(dev, fd, vid, pid, ev); } while(0)
+#define LATENCY_MAPPED()                    do { if (input_latency_flags & LATENCY_MEASURE) latency_event_mapped(); } while(0)
+#define LATENCY_SENT()                      do { if (input_latency_flags & LATENCY_MEASURE) latency_joystick_sent(); } while(0)
+#define LATENCY_POLL_DONE()                 do { if (input_latency_flags & LATENCY_MEASURE) latency_poll_done(); } while(0)
+
+#endif
@@ -62,6 +62,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "audio.h"
 #include "joymapping.h"
 #include "recent.h"
+#include "search.h"
 #include "support.h"
 #include "bootcore.h"
 #include "ide.h"
@@ -463,6 +464,9 @@ void SelectFile(const char* path, const char* pFileExt, int Options, unsigned ch
 		if (home_dir) home_dir++;
 		else home_dir = home;
 
+		// type-to-search goes through the index of the core's games folder
+		if (!is_menu()) search_index(home);
+
 		if (Options & SCANO_SAVES)
 		{
 			snprintf(tmp, sizeof(tmp), "%s/%s", SAVE_DIR, CoreName2);
@@ -843,7 +847,8 @@ const char* get_rbf_name_bootcore(char *str)
 	if (!p) return str;
 
 	char *spl = strrchr(p + 1, '.');
-	if (spl && (!strcmp(spl, ".rbf") || !strcmp(spl, ".mra") || !strcmp(spl, ".mgl")))
+	if (spl && !strcmp(spl, ".zst") && spl - 4 > p && !strncmp(spl - 4, ".rbf", 4)) spl -= 4;
+	if (spl && (!strncmp(spl, ".rbf", 4) || !strcmp(spl, ".mra") || !strcmp(spl, ".mgl")))
 	{
 		*spl = 0;
 	}
@@ -8077,6 +8082,33 @@ void ScrollLongName(void)
 }
 
 // print directory contents
+// Year and manufacturer of an indexed MRA, shown on the expanded line of the selection.
+static int mra_info_line(int k, char *s)
+{
+	direntext_t *item = flist_DirItem(k);
+	if (item->de.d_type == DT_DIR) return 0;
+
+	int len = strlen(item->de.d_name);
+	if (len <= 4 || strcasecmp(item->de.d_name + len - 4, ".mra")) return 0;
+
+	static char path[1024];
+	snprintf(path, sizeof(path), "%s/%s", getFullPath(flist_Path()), item->de.d_name);
+
+	mra_info_t info;
+	if (!mra_index_lookup(path, &info) || (!info.year[0] && !info.manufacturer[0] && !info.rotation_dir)) return 0;
+
+	memset(s, ' ', 32);
+	s[32] = 0;
+	len = snprintf(s + 1, 27, "%s%s%s", info.year, (info.year[0] && info.manufacturer[0]) ? " " : "", info.manufacturer);
+	s[1 + ((len < 26) ? len : 26)] = ' ';
+	if (info.rotation_dir)
+	{
+		if (len > 20) s[20] = 22;
+		strcpy(&s[21], " <VERT>");
+	}
+	return 1;
+}
+
 void PrintDirectory(int expand)
 {
 	char s[40];
@@ -8088,7 +8120,7 @@ void PrintDirectory(int expand)
 	{
 		int k = flist_iFirstEntry() + OsdGetSize() - 1;
 		if (flist_nDirEntries() && k == flist_iSelectedEntry() && k < flist_nDirEntries()
-			&& strlen(flist_DirItem(k)->altname) > 28 && !(!cfg.rbf_hide_datecode && flist_DirItem(k)->datecode[0])
+			&& ((strlen(flist_DirItem(k)->altname) > 28 && !(!cfg.rbf_hide_datecode && flist_DirItem(k)->datecode[0])) || mra_info_line(k, s))
 			&& flist_DirItem(k)->de.d_type != DT_DIR && k < flist_nDirEntries() - 1)
 		{
 			//make room for last expanded line
@@ -8199,6 +8231,11 @@ void PrintDirectory(int expand)
 			OsdWriteOffset(i, s, sel, 0, 0, leftchar);
 			i++;
 		}
+		else if (sel && expand && k < flist_nDirEntries() && i < OsdGetSize() && mra_info_line(k, s))
+		{
+			OsdWriteOffset(i, s, sel, 0, 0, leftchar);
+			i++;
+		}
 
 		k++;
 	}
@@ -119,4 +119,18 @@ void offload_add_work(std::function<void()> handler)
 	pthread_cond_signal(&s_cond_work);
 
 	pthread_mutex_unlock(&s_queue_lock);
-}
\ No newline at end of file
+}
+
+void offload_wait()
+{
+	PROFILE_FUNCTION();
+
+	pthread_mutex_lock(&s_queue_lock);
+
+	while (s_queue_head != s_queue_tail)
+	{
+		pthread_cond_wait(&s_cond_available, &s_queue_lock);
+	}
+
+	pthread_mutex_unlock(&s_queue_lock);
+}
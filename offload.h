@@ -9,4 +9,7 @@ void offload_stop();
 
 void offload_add_work(std::function<void()> work);
 
+// Block until all queued work has finished.
+void offload_wait();
+
 #endif
\ No newline at end of file
@@ -0,0 +1,493 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <unordered_map>
+
+#include "file_io.h"
+#include "hardware.h"
+#include "search.h"
+
+#define SEARCH_MAGIC     0x58495254 // TRIX
+#define SEARCH_VERSION   1
+#define SEARCH_TRI_BITS  16
+#define SEARCH_MAX_DEPTH 16
+#define SEARCH_MAX_ITEMS 1000000
+
+struct searchEntry
+{
+	uint32_t name;   // relative path, offset in names
+	uint16_t base;   // file name offset within the path
+	uint16_t is_dir;
+};
+
+struct searchDir
+{
+	uint32_t name;   // relative path, offset in names
+	uint32_t first;  // direct children: entries[first .. first+count)
+	uint32_t count;
+	uint32_t pad;
+	int64_t  mtime;
+};
+
+struct searchFileHdr
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t dirs;
+	uint32_t entries;
+	uint32_t names;
+	char     root[1024];
+};
+
+struct searchIndex
+{
+	std::string root;
+	std::vector<char> names;         // 0-terminated paths, names[0] is the root ("")
+	std::vector<char> lower;         // lowercased copy of names, same offsets
+	std::vector<searchEntry> entries;
+	std::vector<searchDir> dirs;
+	std::vector<uint32_t> post_start; // trigram bucket -> range in post
+	std::vector<uint32_t> post;       // entry numbers, ascending per bucket
+};
+
+static pthread_mutex_t search_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t search_cond = PTHREAD_COND_INITIALIZER;
+static searchIndex *search_ready = NULL;
+
+static int search_thread = 0;
+static int req_pending = 0;
+static int req_busy = 0;
+static std::string req_root, req_full, req_cache;
+
+static uint32_t tri_hash(const char *p)
+{
+	uint32_t h = ((uint8_t)p[0] * 0x9E3779B1u) ^ ((uint8_t)p[1] * 0x85EBCA77u) ^ ((uint8_t)p[2] * 0xC2B2AE3Du);
+	return h >> (32 - SEARCH_TRI_BITS);
+}
+
+static uint32_t name_add(searchIndex *idx, const char *name)
+{
+	uint32_t off = idx->names.size();
+	idx->names.insert(idx->names.end(), name, name + strlen(name) + 1);
+	return off;
+}
+
+static void entry_add(searchIndex *idx, const char *dir, const char *name, int is_dir)
+{
+	char path[1024];
+	int len = *dir ? snprintf(path, sizeof(path), "%s/%s", dir, name) : snprintf(path, sizeof(path), "%s", name);
+	if (len >= (int)sizeof(path)) return;
+
+	searchEntry e;
+	e.name = name_add(idx, path);
+	e.base = *dir ? strlen(dir) + 1 : 0;
+	e.is_dir = is_dir;
+	idx->entries.push_back(e);
+}
+
+static int search_abort()
+{
+	return __atomic_load_n(&req_pending, __ATOMIC_RELAXED);
+}
+
+// Walk the tree, re-reading only the directories whose mtime changed since the old index.
+static int index_walk(searchIndex *idx, const searchIndex *old, const std::unordered_map<std::string, uint32_t> &old_dirs,
+	const char *full_root, const std::string &rel, int depth, int *changed)
+{
+	if (search_abort()) return 0;
+
+	std::string full = rel.empty() ? std::string(full_root) : std::string(full_root) + "/" + rel;
+	struct stat st;
+	if (stat(full.c_str(), &st) || !S_ISDIR(st.st_mode)) return 1;
+
+	uint32_t d = idx->dirs.size();
+	searchDir dir = {};
+	dir.name = rel.empty() ? 0 : name_add(idx, rel.c_str());
+	dir.first = idx->entries.size();
+	dir.mtime = st.st_mtime;
+	idx->dirs.push_back(dir);
+
+	auto it = old ? old_dirs.find(rel) : old_dirs.end();
+	if (it != old_dirs.end() && old->dirs[it->second].mtime == st.st_mtime)
+	{
+		const searchDir *od = &old->dirs[it->second];
+		for (uint32_t i = od->first; i < od->first + od->count; i++)
+		{
+			const searchEntry *oe = &old->entries[i];
+			entry_add(idx, rel.c_str(), old->names.data() + oe->name + oe->base, oe->is_dir);
+		}
+	}
+	else
+	{
+		DIR *dp = opendir(full.c_str());
+		if (!dp) return 1;
+
+		*changed = 1;
+		struct dirent64 *de;
+		while ((de = readdir64(dp)))
+		{
+			// skip hidden files and folders along with "." and ".."
+			if (de->d_name[0] == '.') continue;
+			if (!strcmp(de->d_name, "System Volume Information")) continue;
+
+			int type = de->d_type;
+			if (type != DT_DIR && type != DT_REG)
+			{
+				std::string path = full + "/" + de->d_name;
+				if (stat(path.c_str(), &st)) continue;
+				type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : DT_UNKNOWN;
+			}
+
+			if (type != DT_DIR && type != DT_REG) continue;
+			if (idx->entries.size() >= SEARCH_MAX_ITEMS) break;
+			entry_add(idx, rel.c_str(), de->d_name, type == DT_DIR);
+		}
+		closedir(dp);
+	}
+
+	idx->dirs[d].count = idx->entries.size() - idx->dirs[d].first;
+	if (depth >= SEARCH_MAX_DEPTH) return 1;
+
+	uint32_t first = idx->dirs[d].first;
+	uint32_t count = idx->dirs[d].count;
+	for (uint32_t i = first; i < first + count; i++)
+	{
+		if (!idx->entries[i].is_dir) continue;
+
+		std::string sub(idx->names.data() + idx->entries[i].name);
+		if (!index_walk(idx, old, old_dirs, full_root, sub, depth + 1, changed)) return 0;
+	}
+
+	return 1;
+}
+
+static void index_finish(searchIndex *idx)
+{
+	idx->lower.resize(idx->names.size());
+	for (size_t i = 0; i < idx->names.size(); i++) idx->lower[i] = tolower((uint8_t)idx->names[i]);
+
+	// Two passes over the file names: count the distinct trigrams per bucket, then fill.
+	idx->post_start.assign((1 << SEARCH_TRI_BITS) + 1, 0);
+	std::vector<uint32_t> tri;
+	for (int pass = 0; pass < 2; pass++)
+	{
+		for (uint32_t n = 0; n < idx->entries.size(); n++)
+		{
+			const char *s = idx->lower.data() + idx->entries[n].name + idx->entries[n].base;
+			int len = strlen(s);
+
+			tri.clear();
+			for (int i = 0; i + 3 <= len; i++) tri.push_back(tri_hash(s + i));
+			std::sort(tri.begin(), tri.end());
+			tri.erase(std::unique(tri.begin(), tri.end()), tri.end());
+
+			for (uint32_t h : tri)
+			{
+				if (!pass) idx->post_start[h + 1]++;
+				else idx->post[idx->post_start[h]++] = n;
+			}
+		}
+
+		if (!pass)
+		{
+			for (uint32_t h = 0; h < (1 << SEARCH_TRI_BITS); h++) idx->post_start[h + 1] += idx->post_start[h];
+			idx->post.resize(idx->post_start[1 << SEARCH_TRI_BITS]);
+		}
+		else
+		{
+			// filling advanced every start to the next bucket's start
+			for (uint32_t h = (1 << SEARCH_TRI_BITS); h > 0; h--) idx->post_start[h] = idx->post_start[h - 1];
+			idx->post_start[0] = 0;
+		}
+	}
+}
+
+static searchIndex *index_load(const char *cache, const char *root)
+{
+	FILE *fp = fopen(cache, "rb");
+	if (!fp) return NULL;
+
+	searchIndex *idx = NULL;
+	searchFileHdr hdr;
+	if (fread(&hdr, sizeof(hdr), 1, fp) == 1 && hdr.magic == SEARCH_MAGIC && hdr.version == SEARCH_VERSION &&
+		!strncmp(hdr.root, root, sizeof(hdr.root)) && hdr.entries <= SEARCH_MAX_ITEMS && hdr.names)
+	{
+		idx = new searchIndex;
+		idx->root = root;
+		idx->dirs.resize(hdr.dirs);
+		idx->entries.resize(hdr.entries);
+		idx->names.resize(hdr.names);
+		if (fread(idx->dirs.data(), sizeof(searchDir), hdr.dirs, fp) != hdr.dirs ||
+			fread(idx->entries.data(), sizeof(searchEntry), hdr.entries, fp) != hdr.entries ||
+			fread(idx->names.data(), 1, hdr.names, fp) != hdr.names || idx->names.back())
+		{
+			delete idx;
+			idx = NULL;
+		}
+	}
+	fclose(fp);
+
+	if (idx)
+	{
+		for (auto &e : idx->entries)
+		{
+			// base points into the name, the file name part must be inside the pool too
+			if ((uint64_t)e.name + e.base >= idx->names.size())
+			{
+				delete idx;
+				return NULL;
+			}
+		}
+		for (auto &d : idx->dirs)
+		{
+			if (d.name >= idx->names.size() || d.first > idx->entries.size() || d.count > idx->entries.size() - d.first)
+			{
+				delete idx;
+				return NULL;
+			}
+		}
+		index_finish(idx);
+	}
+
+	return idx;
+}
+
+static void index_save(const char *cache, const searchIndex *idx)
+{
+	std::string tmp = std::string(cache) + ".tmp";
+	FILE *fp = fopen(tmp.c_str(), "wb");
+	if (!fp) return;
+
+	searchFileHdr hdr = {};
+	hdr.magic = SEARCH_MAGIC;
+	hdr.version = SEARCH_VERSION;
+	hdr.dirs = idx->dirs.size();
+	hdr.entries = idx->entries.size();
+	hdr.names = idx->names.size();
+	snprintf(hdr.root, sizeof(hdr.root), "%s", idx->root.c_str());
+
+	int ok = fwrite(&hdr, sizeof(hdr), 1, fp) == 1 &&
+		fwrite(idx->dirs.data(), sizeof(searchDir), hdr.dirs, fp) == hdr.dirs &&
+		fwrite(idx->entries.data(), sizeof(searchEntry), hdr.entries, fp) == hdr.entries &&
+		fwrite(idx->names.data(), 1, hdr.names, fp) == hdr.names;
+	ok = !fclose(fp) && ok;
+
+	if (ok) ok = !rename(tmp.c_str(), cache);
+	if (!ok) unlink(tmp.c_str());
+}
+
+static void index_publish(searchIndex *idx)
+{
+	pthread_mutex_lock(&search_lock);
+	searchIndex *old = search_ready;
+	search_ready = idx;
+	pthread_mutex_unlock(&search_lock);
+	delete old;
+}
+
+static void index_build(const std::string &root, const std::string &full_root, const std::string &cache)
+{
+	unsigned long start = GetTimer(0);
+
+	pthread_mutex_lock(&search_lock);
+	searchIndex *old = (search_ready && search_ready->root == root) ? search_ready : NULL;
+	pthread_mutex_unlock(&search_lock);
+
+	// Only this thread replaces the published index, so it stays valid here.
+	searchIndex *loaded = NULL;
+	if (!old)
+	{
+		old = loaded = index_load(cache.c_str(), root.c_str());
+		if (loaded)
+		{
+			printf("Search: loaded index of %s (%d entries)\n", root.c_str(), (int)loaded->entries.size());
+			index_publish(loaded);
+		}
+	}
+
+	std::unordered_map<std::string, uint32_t> old_dirs;
+	if (old)
+	{
+		for (uint32_t i = 0; i < old->dirs.size(); i++) old_dirs.emplace(old->names.data() + old->dirs[i].name, i);
+	}
+
+	searchIndex *idx = new searchIndex;
+	idx->root = root;
+	idx->names.push_back(0);
+
+	int changed = 0;
+	if (!index_walk(idx, old, old_dirs, full_root.c_str(), "", 0, &changed))
+	{
+		delete idx;
+		return;
+	}
+
+	if (!changed && old && idx->dirs.size() == old->dirs.size())
+	{
+		delete idx;
+		printf("Search: index of %s is up to date (%lu ms)\n", root.c_str(), GetTimer(0) - start);
+		return;
+	}
+
+	index_finish(idx);
+	index_save(cache.c_str(), idx);
+	index_publish(idx);
+	printf("Search: indexed %s: %d entries in %lu ms\n", root.c_str(), (int)idx->entries.size(), GetTimer(0) - start);
+}
+
+static void *search_worker(void *)
+{
+	pthread_mutex_lock(&search_lock);
+	while (1)
+	{
+		if (!req_pending)
+		{
+			pthread_cond_wait(&search_cond, &search_lock);
+			continue;
+		}
+
+		std::string root = req_root, full_root = req_full, cache = req_cache;
+		req_pending = 0;
+		req_busy = 1;
+		pthread_mutex_unlock(&search_lock);
+
+		index_build(root, full_root, cache);
+
+		pthread_mutex_lock(&search_lock);
+		req_busy = 0;
+	}
+
+	return NULL;
+}
+
+void search_index(const char *root)
+{
+	if (!root || !*root) return;
+
+	pthread_mutex_lock(&search_lock);
+	if ((req_pending || req_busy) && req_root == root)
+	{
+		pthread_mutex_unlock(&search_lock);
+		return;
+	}
+
+	char name[256];
+	snprintf(name, sizeof(name), "%s", root);
+	for (char *p = name; *p; p++) if (*p == '/' || *p == '.') *p = '_';
+
+	req_root = root;
+	req_full = (root[0] == '/') ? std::string(root) : std::string(getRootDir()) + "/" + root;
+	req_cache = std::string(getRootDir()) + "/" CONFIG_DIR "/search";
+	mkdir(req_cache.c_str(), 0777);
+	req_cache += std::string("/") + name + ".idx";
+	__atomic_store_n(&req_pending, 1, __ATOMIC_RELAXED);
+
+	if (!search_thread)
+	{
+		pthread_attr_t attr;
+		pthread_attr_init(&attr);
+
+		// Stay off core #1 (main)
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(0, &set);
+		pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+
+		pthread_t tid;
+		if (!pthread_create(&tid, &attr, search_worker, NULL))
+		{
+			pthread_detach(tid);
+			search_thread = 1;
+		}
+		pthread_attr_destroy(&attr);
+	}
+
+	pthread_cond_signal(&search_cond);
+	pthread_mutex_unlock(&search_lock);
+}
+
+// All characters of the query (spaces ignored) appear in order.
+static int fuzzy_match(const char *s, const char *q)
+{
+	for (; *q; q++)
+	{
+		if (*q == ' ') continue;
+		s = strchr(s, *q);
+		if (!s) return 0;
+		s++;
+	}
+	return 1;
+}
+
+int search_find(const char *path, const char *query, std::vector<search_hit_t> &hits, int max_hits)
+{
+	hits.clear();
+
+	char q[256];
+	int qlen = 0;
+	while (query[qlen] && qlen < (int)sizeof(q) - 1)
+	{
+		q[qlen] = tolower((uint8_t)query[qlen]);
+		qlen++;
+	}
+	q[qlen] = 0;
+
+	pthread_mutex_lock(&search_lock);
+	searchIndex *idx = search_ready;
+	int rootlen = idx ? idx->root.length() : 0;
+	if (!idx || !qlen || strncasecmp(path, idx->root.c_str(), rootlen) || (path[rootlen] && path[rootlen] != '/'))
+	{
+		pthread_mutex_unlock(&search_lock);
+		return -1;
+	}
+
+	const char *sub = path + rootlen;
+	if (*sub == '/') sub++;
+	int sublen = strlen(sub);
+
+	auto scan = [&](uint32_t n, int fuzzy)
+	{
+		const searchEntry *e = &idx->entries[n];
+		const char *name = idx->names.data() + e->name;
+		if (sublen && (strncasecmp(name, sub, sublen) || name[sublen] != '/')) return;
+
+		const char *base = idx->lower.data() + e->name + e->base;
+		if (fuzzy ? !fuzzy_match(base, q) : !strstr(base, q)) return;
+
+		hits.push_back({ name + (sublen ? sublen + 1 : 0), e->is_dir });
+	};
+
+	uint32_t first = 0, last = idx->entries.size();
+	const uint32_t *list = NULL;
+	if (qlen >= 3)
+	{
+		// Candidates come from the smallest posting list among the query's trigrams.
+		for (int i = 0; i + 3 <= qlen; i++)
+		{
+			uint32_t h = tri_hash(q + i);
+			if (!list || idx->post_start[h + 1] - idx->post_start[h] < last - first)
+			{
+				first = idx->post_start[h];
+				last = idx->post_start[h + 1];
+				list = idx->post.data();
+			}
+		}
+	}
+
+	for (uint32_t i = first; i < last && (int)hits.size() < max_hits; i++) scan(list ? list[i] : i, 0);
+
+	if (hits.empty() && qlen >= 3)
+	{
+		for (uint32_t n = 0; n < idx->entries.size() && (int)hits.size() < max_hits; n++) scan(n, 1);
+	}
+
+	pthread_mutex_unlock(&search_lock);
+	return hits.size();
+}
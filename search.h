@@ -0,0 +1,21 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <string>
+#include <vector>
+
+struct search_hit_t
+{
+	std::string name; // relative to the searched path
+	int is_dir;
+};
+
+// Load (or build) the trigram index of a games folder in the background and
+// refresh it against the directory mtimes. root is relative to the storage root.
+void search_index(const char *root);
+
+// Substring search (fuzzy if nothing matches) over the indexed files under path.
+// Returns the number of hits, or -1 if path is not covered by a ready index.
+int search_find(const char *path, const char *query, std::vector<search_hit_t> &hits, int max_hits);
+
+#endif
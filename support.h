@@ -42,6 +42,7 @@
 
 // Arcade support
 #include "support/arcade/mra_loader.h"
+#include "support/arcade/mra_index.h"
 
 // MEGACD  support
 #include "support/megacd/megacd.h"
@@ -24,42 +24,10 @@ p3docdd_t::p3docdd_t() {
 	SendData = NULL;
 }
 
-static int sgets(char *out, int sz, char **in)
-{
-	*out = 0;
-	do
-	{
-		char *instr = *in;
-		int cnt = 0;
-
-		while (*instr && *instr != 10)
-		{
-			if (*instr == 13)
-			{
-				instr++;
-				continue;
-			}
-
-			if (cnt < sz - 1)
-			{
-				out[cnt++] = *instr;
-				out[cnt] = 0;
-			}
-
-			instr++;
-		}
-
-		if (*instr == 10) instr++;
-		*in = instr;
-	} while (!*out && **in);
-
-	return *out;
-}
-
 int p3docdd_t::LoadCUE(const char* filename) {
 	static char fname[1024 + 10];
 	static char line[256];
-	char *ptr, *lptr;
+	char *lptr;
 	static char cue[100 * 1024];
 	int new_file = 0;
 	int file_size = 0;
@@ -77,7 +45,7 @@ int p3docdd_t::LoadCUE(const char* filename) {
 	int idx, mm, ss, bb, pregap = 0;
 
 	char *buf = cue;
-	while (sgets(line, sizeof(line), &buf))
+	while (cd_sgets(line, sizeof(line), &buf))
 	{
 		lptr = line;
 		while (*lptr == 0x20) lptr++;
@@ -87,25 +55,7 @@ int p3docdd_t::LoadCUE(const char* filename) {
 		{
 			if (this->toc.last == 99) break;
 
-			ptr = fname + strlen(fname) - 1;
-			while ((ptr - fname) && (*ptr != '/') && (*ptr != '\\')) ptr--;
-			if (ptr - fname) ptr++;
-
-			lptr += 4;
-			while (*lptr == 0x20) lptr++;
-
-			if (*lptr == '\"')
-			{
-				lptr++;
-				while ((*lptr != '\"') && (lptr <= (line + 256)) && (ptr < (fname + 1023)))
-					*ptr++ = *lptr++;
-			}
-			else
-			{
-				while ((*lptr != 0x20) && (lptr <= (line + 256)) && (ptr < (fname + 1023)))
-					*ptr++ = *lptr++;
-			}
-			*ptr = 0;
+			lptr = cd_cue_file(fname, 1024, lptr + 4);
 
 			if (!FileOpen(&this->toc.tracks[this->toc.last + 1].f, fname)) return -1;
 			FileSeek(&this->toc.tracks[this->toc.last + 1].f, 0, SEEK_SET);
@@ -679,28 +629,14 @@ void p3docdd_t::ReadData(uint8_t *buf)
 	if (this->toc.tracks[this->track].type == TT_MODE1)
 	{
 		int lba_ = this->lba >= 0 ? this->lba : 0;
+		int sector_size = (this->sectorSize == 2048) ? 2048 : 2352;
 		if (this->toc.chd_f)
 		{
-			int read_offset = 0;
-			if (this->sectorSize == 2048)
-			{
-				read_offset += 16;
-			}
-
-			mister_chd_read_sector(this->toc.chd_f, lba_ + this->toc.tracks[this->track].offset, read_offset, 0, this->sectorSize, buf, this->chd_hunkbuf, &this->chd_hunknum);
+			mister_chd_read_sectors(this->toc.chd_f, lba_ + this->toc.tracks[this->track].offset, 1, sector_size, CD_FMT_RAW, buf, this->chd_hunkbuf, &this->chd_hunknum);
 		}
 		else {
-			if (this->sectorSize == 2048)
-			{
-				offs = (lba_ * 2048) - this->toc.tracks[this->track].offset;
-				FileSeek(&this->toc.tracks[this->track].f, offs, SEEK_SET);
-				FileReadAdv(&this->toc.tracks[this->track].f, buf + 16, 2048);
-			}
-			else {
-				offs = (lba_ * 2352) - this->toc.tracks[this->track].offset;
-				FileSeek(&this->toc.tracks[this->track].f, offs, SEEK_SET);
-				FileReadAdv(&this->toc.tracks[this->track].f, buf, 2352);
-			}
+			offs = (lba_ * sector_size) - this->toc.tracks[this->track].offset;
+			cd_read_sectors(&this->toc.tracks[this->track].f, offs, sector_size, 1, CD_FMT_RAW, buf);
 #ifdef P3DO_DEBUG
 			//printf("\x1b[32m3DO: ");
 			//printf("Read data, lba = %i, track = %i, offset = %i", lba_, this->track, offs);
@@ -2,6 +2,7 @@
 // See iigs_fmt.h and IIGS_DISK_SUPPORT.md.
 
 #include "iigs_fmt.h"
+#include "../../crc32.h"
 #include <string.h>
 
 // ---------------------------------------------------------------------------
@@ -27,13 +28,7 @@ static inline void wr_be32(uint8_t *p, uint32_t v) {
 // ---------------------------------------------------------------------------
 uint32_t woz_crc32(const uint8_t *data, size_t len)
 {
-	uint32_t crc = 0xFFFFFFFFu;
-	for (size_t i = 0; i < len; i++) {
-		crc ^= data[i];
-		for (int b = 0; b < 8; b++)
-			crc = (crc >> 1) ^ (0xEDB88320u & (~(crc & 1) + 1));
-	}
-	return crc ^ 0xFFFFFFFFu;
+	return crc32_update(0, data, len);
 }
 
 // ===========================================================================
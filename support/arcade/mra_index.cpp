@@ -0,0 +1,622 @@
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+
+#include "../../sxmlc.h"
+#include "../../file_io.h"
+#include "miniz.h"
+
+#include "mra_loader.h"
+#include "mra_index.h"
+
+/*
+ * Compact index of the MRA files in _Arcade, built once in the background and
+ * refreshed by mtime/size, so selecting an MRA doesn't need an XML parse to
+ * find its rbf, setname or rotation, the browser can show year and maker, and
+ * missing ROMs are found before the core is loaded.
+ *
+ * Stored as config/arcade_index.bin:
+ *   header, records sorted by path, ROM parts, string pool.
+ */
+
+#define INDEX_NAME    CONFIG_DIR"/arcade_index.bin"
+#define INDEX_MAGIC   0x4941524D // "MRAI"
+#define INDEX_VERSION 3
+
+struct index_header
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t count;
+	uint32_t part_count;
+	uint32_t str_size;
+};
+
+struct index_rec
+{
+	uint32_t path;
+	uint32_t setname;
+	uint32_t rbf;
+	uint32_t year;
+	uint32_t manufacturer;
+	uint32_t part;       // parts[part .. part+part_count)
+	uint32_t part_count;
+	uint32_t pad;
+	int64_t  mtime;
+	int64_t  size;
+	uint16_t flags;
+	uint16_t rotation_dir;
+};
+
+// A named part of a <rom>: the zips it may come from ('|' separated) and its CRC.
+struct index_part
+{
+	uint32_t zip;
+	uint32_t name;
+	uint32_t crc;
+	uint16_t rom;   // <rom> number within the MRA
+	uint16_t index; // the rom's index attribute
+};
+
+struct index_t
+{
+	std::vector<index_rec> recs;
+	std::vector<index_part> parts;
+	std::vector<char> str;
+	std::map<std::string, uint32_t> shared; // while building: zips and makers repeat a lot
+};
+
+static index_t index_cur;
+static int index_loaded = 0;
+static pthread_mutex_t index_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t index_thread;
+static int index_started = 0;
+
+static const char *rec_str(const index_t &idx, uint32_t off)
+{
+	return idx.str.data() + off;
+}
+
+static uint32_t add_str(index_t &idx, const char *s)
+{
+	uint32_t off = idx.str.size();
+	idx.str.insert(idx.str.end(), s, s + strlen(s) + 1);
+	return off;
+}
+
+static uint32_t add_shared_str(index_t &idx, const char *s)
+{
+	auto it = idx.shared.find(s);
+	if (it != idx.shared.end()) return it->second;
+
+	uint32_t off = add_str(idx, s);
+	idx.shared.emplace(s, off);
+	return off;
+}
+
+static const index_rec *find_rec(const index_t &idx, const char *path)
+{
+	auto it = std::lower_bound(idx.recs.begin(), idx.recs.end(), path,
+		[&idx](const index_rec &r, const char *p) { return strcmp(rec_str(idx, r.path), p) < 0; });
+
+	if (it == idx.recs.end() || strcmp(rec_str(idx, it->path), path)) return NULL;
+	return &*it;
+}
+
+// file_io path helpers share a static buffer, so the paths are resolved on the main thread
+static char index_path[1024] = {};
+static char arcade_dir[1024] = {};
+
+static void init_paths()
+{
+	if (index_path[0]) return;
+	snprintf(index_path, sizeof(index_path), "%s", getFullPath(INDEX_NAME));
+	snprintf(arcade_dir, sizeof(arcade_dir), "%s/_Arcade", getRootDir());
+}
+
+static void load_index()
+{
+	index_loaded = 1;
+
+	FILE *fp = fopen(index_path, "rb");
+	if (!fp) return;
+
+	std::vector<char> buf;
+	struct stat64 st;
+	if (!fstat64(fileno(fp), &st) && st.st_size >= (off64_t)sizeof(index_header))
+	{
+		buf.resize(st.st_size);
+		if (fread(buf.data(), 1, buf.size(), fp) != buf.size()) buf.clear();
+	}
+	fclose(fp);
+	if (buf.empty()) return;
+
+	// Anything that doesn't add up rejects the whole index; the indexer rebuilds it.
+	index_header *hdr = (index_header *)buf.data();
+	if (hdr->magic != INDEX_MAGIC || hdr->version != INDEX_VERSION) return;
+
+	uint64_t rec_size = (uint64_t)hdr->count * sizeof(index_rec);
+	uint64_t part_size = (uint64_t)hdr->part_count * sizeof(index_part);
+	if ((uint64_t)buf.size() != sizeof(index_header) + rec_size + part_size + hdr->str_size) return;
+
+	char *p = buf.data() + sizeof(index_header);
+	index_rec *recs = (index_rec *)p;
+	index_part *parts = (index_part *)(p + rec_size);
+	char *str = p + rec_size + part_size;
+	if (hdr->str_size && str[hdr->str_size - 1]) return;
+
+	// every string ends before the pool does since the pool's last byte is 0
+	uint32_t n = hdr->str_size;
+	for (uint32_t i = 0; i < hdr->count; i++)
+	{
+		const index_rec *r = &recs[i];
+		if (r->path >= n || r->setname >= n || r->rbf >= n || r->year >= n || r->manufacturer >= n) return;
+		if (r->part > hdr->part_count || r->part_count > hdr->part_count - r->part) return;
+	}
+
+	for (uint32_t i = 0; i < hdr->part_count; i++)
+	{
+		if (parts[i].zip >= n || parts[i].name >= n) return;
+	}
+
+	index_cur.recs.assign(recs, recs + hdr->count);
+	index_cur.parts.assign(parts, parts + hdr->part_count);
+	index_cur.str.assign(str, str + hdr->str_size);
+
+	printf("MRA index: %d entries loaded.\n", hdr->count);
+}
+
+static void save_index(const index_t &idx)
+{
+	index_header hdr = { INDEX_MAGIC, INDEX_VERSION, (uint32_t)idx.recs.size(), (uint32_t)idx.parts.size(), (uint32_t)idx.str.size() };
+
+	// write aside and rename so a core switch during the save can't leave a truncated index
+	char tmp[1024];
+	snprintf(tmp, sizeof(tmp), "%s.tmp", index_path);
+
+	FILE *fp = fopen(tmp, "wb");
+	if (!fp) return;
+
+	int ok = fwrite(&hdr, sizeof(hdr), 1, fp) == 1;
+	if (hdr.count) ok &= fwrite(idx.recs.data(), sizeof(index_rec), hdr.count, fp) == hdr.count;
+	if (hdr.part_count) ok &= fwrite(idx.parts.data(), sizeof(index_part), hdr.part_count, fp) == hdr.part_count;
+	if (hdr.str_size) ok &= fwrite(idx.str.data(), 1, hdr.str_size, fp) == hdr.str_size;
+	ok &= !fclose(fp);
+
+	if (ok) rename(tmp, index_path);
+	else unlink(tmp);
+}
+
+enum
+{
+	MRA_TAG_NONE,
+	MRA_TAG_SETNAME,
+	MRA_TAG_RBF,
+	MRA_TAG_YEAR,
+	MRA_TAG_MANUFACTURER,
+	MRA_TAG_ROTATION
+};
+
+struct mra_scan_part
+{
+	std::string zip;
+	std::string name;
+	uint32_t crc;
+	int rom;
+	int index;
+};
+
+struct mra_scan
+{
+	int tag;
+	uint32_t flags;
+	std::string text[MRA_TAG_ROTATION + 1];
+
+	// as the loader sees them: a part without its own zip uses the rom's
+	int in_rom;
+	int rom;
+	int rom_index;
+	std::string rom_zip;
+	std::vector<mra_scan_part> parts;
+};
+
+static int xml_index_mra(XMLEvent evt, const XMLNode* node, SXML_CHAR* text, const int n, SAX_Data* sd)
+{
+	(void)n;
+	mra_scan *scan = (mra_scan *)sd->user;
+
+	switch (evt)
+	{
+	case XML_EVENT_START_NODE:
+		scan->tag = MRA_TAG_NONE;
+		if (!strcasecmp(node->tag, "rbf")) scan->tag = MRA_TAG_RBF;
+		else if (!strcasecmp(node->tag, "year")) scan->tag = MRA_TAG_YEAR;
+		else if (!strcasecmp(node->tag, "manufacturer")) scan->tag = MRA_TAG_MANUFACTURER;
+		else if (!strcasecmp(node->tag, "rom"))
+		{
+			scan->in_rom = 1;
+			scan->rom++;
+			scan->rom_index = 0;
+			scan->rom_zip.clear();
+			for (int i = 0; i < node->n_attributes; i++)
+			{
+				if (!strcasecmp(node->attributes[i].name, "zip")) scan->rom_zip = node->attributes[i].value;
+				if (!strcasecmp(node->attributes[i].name, "index")) scan->rom_index = atoi(node->attributes[i].value);
+			}
+		}
+		else if (scan->in_rom && !strcasecmp(node->tag, "part"))
+		{
+			mra_scan_part part = {};
+			part.zip = scan->rom_zip;
+			part.rom = scan->rom;
+			part.index = scan->rom_index;
+			for (int i = 0; i < node->n_attributes; i++)
+			{
+				if (!strcasecmp(node->attributes[i].name, "zip")) part.zip = node->attributes[i].value;
+				if (!strcasecmp(node->attributes[i].name, "name")) part.name = node->attributes[i].value;
+				if (!strcasecmp(node->attributes[i].name, "crc")) part.crc = strtoul(node->attributes[i].value, NULL, 16);
+			}
+
+			// parts without a name carry their data inline
+			if (!part.name.empty()) scan->parts.push_back(part);
+		}
+		else if (!strcasecmp(node->tag, "rotation"))
+		{
+			scan->tag = MRA_TAG_ROTATION;
+			scan->flags |= MRA_INDEX_ROTATION;
+		}
+		else if (!strcasecmp(node->tag, "setname"))
+		{
+			scan->tag = MRA_TAG_SETNAME;
+			scan->flags |= MRA_INDEX_SETNAME;
+			for (int i = 0; i < node->n_attributes; i++)
+			{
+				if (!strcasecmp(node->attributes[i].name, "same_dir") && !strcmp(node->attributes[i].value, "1")) scan->flags |= MRA_INDEX_SAMEDIR;
+			}
+		}
+		break;
+
+	case XML_EVENT_TEXT:
+		if (scan->tag != MRA_TAG_NONE && scan->text[scan->tag].empty()) scan->text[scan->tag] = text;
+		scan->tag = MRA_TAG_NONE;
+		break;
+
+	case XML_EVENT_END_NODE:
+		scan->tag = MRA_TAG_NONE;
+		if (!strcasecmp(node->tag, "rom")) scan->in_rom = 0;
+		break;
+
+	default:
+		break;
+	}
+
+	return true;
+}
+
+static void index_mra(index_t &idx, const char *path, const struct stat64 &st)
+{
+	mra_scan scan = {};
+
+	SAX_Callbacks sax;
+	SAX_Callbacks_init(&sax);
+	sax.all_event = xml_index_mra;
+	if (!XMLDoc_parse_file_SAX(path, &sax, &scan)) return;
+
+	index_rec rec = {};
+	rec.path = add_str(idx, path);
+	rec.setname = add_str(idx, scan.text[MRA_TAG_SETNAME].c_str());
+	rec.rbf = add_str(idx, scan.text[MRA_TAG_RBF].c_str());
+	rec.year = add_shared_str(idx, scan.text[MRA_TAG_YEAR].c_str());
+	rec.manufacturer = add_shared_str(idx, scan.text[MRA_TAG_MANUFACTURER].c_str());
+	rec.part = idx.parts.size();
+	rec.part_count = scan.parts.size();
+	rec.mtime = st.st_mtime;
+	rec.size = st.st_size;
+	rec.flags = scan.flags;
+	rec.rotation_dir = arcade_rotation_dir(scan.text[MRA_TAG_ROTATION].c_str());
+	idx.recs.push_back(rec);
+
+	for (auto &sp : scan.parts)
+	{
+		index_part part = {};
+		part.zip = add_shared_str(idx, sp.zip.c_str());
+		part.name = add_str(idx, sp.name.c_str());
+		part.crc = sp.crc;
+		part.rom = sp.rom;
+		part.index = sp.index;
+		idx.parts.push_back(part);
+	}
+}
+
+static void copy_rec(index_t &idx, const index_t &from, const index_rec *r)
+{
+	index_rec rec = *r;
+	rec.path = add_str(idx, rec_str(from, r->path));
+	rec.setname = add_str(idx, rec_str(from, r->setname));
+	rec.rbf = add_str(idx, rec_str(from, r->rbf));
+	rec.year = add_shared_str(idx, rec_str(from, r->year));
+	rec.manufacturer = add_shared_str(idx, rec_str(from, r->manufacturer));
+	rec.part = idx.parts.size();
+	idx.recs.push_back(rec);
+
+	for (uint32_t i = r->part; i < r->part + r->part_count; i++)
+	{
+		index_part part = from.parts[i];
+		part.zip = add_shared_str(idx, rec_str(from, part.zip));
+		part.name = add_str(idx, rec_str(from, part.name));
+		idx.parts.push_back(part);
+	}
+}
+
+static int scan_dir(index_t &idx, const index_t &old, const char *dirname, int depth)
+{
+	DIR *dir = opendir(dirname);
+	if (!dir) return 0;
+
+	int parsed = 0;
+	struct dirent *entry;
+	while ((entry = readdir(dir)) != NULL)
+	{
+		if (entry->d_name[0] == '.') continue;
+
+		char path[1024];
+		snprintf(path, sizeof(path), "%s/%s", dirname, entry->d_name);
+
+		if (entry->d_type == DT_DIR)
+		{
+			// rbf folder and deep trees hold no MRAs
+			if (depth < 4 && strcasecmp(entry->d_name, "cores")) parsed += scan_dir(idx, old, path, depth + 1);
+			continue;
+		}
+
+		int len = strlen(entry->d_name);
+		if (len <= 4 || strcasecmp(entry->d_name + len - 4, ".mra")) continue;
+
+		struct stat64 st;
+		if (stat64(path, &st)) continue;
+
+		const index_rec *r = find_rec(old, path);
+		if (r && r->mtime == st.st_mtime && r->size == st.st_size)
+		{
+			copy_rec(idx, old, r);
+		}
+		else
+		{
+			index_mra(idx, path, st);
+			parsed++;
+		}
+	}
+
+	closedir(dir);
+	return parsed;
+}
+
+static void *index_thread_func(void *)
+{
+	index_t old, idx;
+
+	pthread_mutex_lock(&index_lock);
+	if (!index_loaded) load_index();
+	old = index_cur;
+	pthread_mutex_unlock(&index_lock);
+
+	int parsed = scan_dir(idx, old, arcade_dir, 0);
+
+	std::sort(idx.recs.begin(), idx.recs.end(),
+		[&idx](const index_rec &a, const index_rec &b) { return strcmp(rec_str(idx, a.path), rec_str(idx, b.path)) < 0; });
+
+	if (parsed || idx.recs.size() != old.recs.size())
+	{
+		save_index(idx);
+		printf("MRA index: %d of %d entries updated.\n", parsed, (int)idx.recs.size());
+	}
+
+	idx.shared.clear();
+	pthread_mutex_lock(&index_lock);
+	std::swap(index_cur, idx);
+	pthread_mutex_unlock(&index_lock);
+
+	return NULL;
+}
+
+void mra_index_start()
+{
+	if (index_started) return;
+	index_started = 1;
+	init_paths();
+
+	pthread_attr_t attr;
+	pthread_attr_init(&attr);
+
+	// Stay off core #1 (main) and only use idle cycles
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(0, &set);
+	pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+
+	struct sched_param param = {};
+	pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+	pthread_attr_setschedpolicy(&attr, SCHED_IDLE);
+	pthread_attr_setschedparam(&attr, &param);
+
+	if (pthread_create(&index_thread, &attr, index_thread_func, NULL)) printf("MRA index: failed to start indexer thread.\n");
+	else pthread_detach(index_thread);
+
+	pthread_attr_destroy(&attr);
+}
+
+static const index_rec *lookup_locked(const char *path)
+{
+	struct stat64 st;
+	if (stat64(path, &st)) return NULL;
+
+	if (!index_loaded)
+	{
+		init_paths();
+		load_index();
+	}
+
+	const index_rec *r = find_rec(index_cur, path);
+	if (!r || r->mtime != st.st_mtime || r->size != st.st_size) return NULL;
+	return r;
+}
+
+int mra_index_lookup(const char *path, mra_info_t *info)
+{
+	pthread_mutex_lock(&index_lock);
+
+	const index_rec *r = lookup_locked(path);
+	if (r)
+	{
+		snprintf(info->setname, sizeof(info->setname), "%s", rec_str(index_cur, r->setname));
+		snprintf(info->rbf, sizeof(info->rbf), "%s", rec_str(index_cur, r->rbf));
+		snprintf(info->year, sizeof(info->year), "%s", rec_str(index_cur, r->year));
+		snprintf(info->manufacturer, sizeof(info->manufacturer), "%s", rec_str(index_cur, r->manufacturer));
+		info->flags = r->flags;
+		info->rotation_dir = r->rotation_dir;
+	}
+
+	pthread_mutex_unlock(&index_lock);
+	return r != NULL;
+}
+
+struct check_part
+{
+	std::string zip;
+	std::string name;
+	uint32_t crc;
+	int rom;
+	int index;
+};
+
+// Zips opened for one check, by full path. NULL if the zip can't be opened.
+typedef std::map<std::string, mz_zip_archive *> zip_map;
+
+static mz_zip_archive *check_zip(zip_map &zips, const char *path)
+{
+	auto it = zips.find(path);
+	if (it != zips.end()) return it->second;
+
+	// only the central directory is read
+	mz_zip_archive *zip = new mz_zip_archive{};
+	if (!mz_zip_reader_init_file(zip, path, 0))
+	{
+		delete zip;
+		zip = NULL;
+	}
+
+	zips.emplace(path, zip);
+	return zip;
+}
+
+static int zip_has_crc(mz_zip_archive *zip, uint32_t crc)
+{
+	for (uint32_t i = 0; i < zip->m_total_files; i++)
+	{
+		mz_zip_archive_file_stat st;
+		if (mz_zip_reader_file_stat(zip, i, &st) && st.m_crc32 == crc) return 1;
+	}
+	return 0;
+}
+
+// Same lookup as the loader: each zip of the list in turn, by CRC then by name.
+static int check_part_found(zip_map &zips, const char *root, const check_part &part, char *zip_path, int zip_path_size)
+{
+	char list[1024];
+	snprintf(list, sizeof(list), "%s", part.zip.c_str());
+
+	char *zipptr = list, *zipname;
+	while ((zipname = strsep(&zipptr, "|")) != NULL)
+	{
+		snprintf(zip_path, zip_path_size, (zipname[0] == '/') ? "%s%s" : "%s/mame/%s", root, zipname);
+
+		mz_zip_archive *zip = check_zip(zips, getFullPath(zip_path));
+		if (!zip) continue;
+		if (part.crc && zip_has_crc(zip, part.crc)) return 1;
+		if (mz_zip_reader_locate_file(zip, part.name.c_str(), NULL, 0) >= 0) return 1;
+	}
+
+	return 0;
+}
+
+int mra_index_check_roms(const char *path, const char *root, char *msg, int msg_size)
+{
+	std::vector<check_part> parts;
+
+	pthread_mutex_lock(&index_lock);
+	const index_rec *r = lookup_locked(path);
+	if (r)
+	{
+		for (uint32_t i = r->part; i < r->part + r->part_count; i++)
+		{
+			const index_part *p = &index_cur.parts[i];
+			parts.push_back({ rec_str(index_cur, p->zip), rec_str(index_cur, p->name), p->crc, p->rom, p->index });
+		}
+	}
+	pthread_mutex_unlock(&index_lock);
+
+	if (!r) return -1;
+
+	// Every rom has to be complete, except that the rom #0 sets are alternatives
+	// (merged sets): the loader keeps the first complete one.
+	zip_map zips;
+	int rom0_sets = 0, rom0_ok = 0;
+	int ok = 1;
+	char missing[1024] = {}, missing0[1024] = {}, block_missing[1024] = {};
+	char zip_path[1024];
+
+	for (size_t i = 0; i < parts.size();)
+	{
+		size_t end = i;
+		int complete = 1;
+		while (end < parts.size() && parts[end].rom == parts[i].rom)
+		{
+			if (complete && !check_part_found(zips, root, parts[end], zip_path, sizeof(zip_path)))
+			{
+				complete = 0;
+				snprintf(block_missing, sizeof(block_missing), "%s\n%s not found", zip_path, parts[end].name.c_str());
+			}
+			end++;
+		}
+
+		if (parts[i].index == 0)
+		{
+			rom0_sets++;
+			if (complete) rom0_ok = 1;
+			else strcpy(missing0, block_missing);
+		}
+		else if (!complete && ok)
+		{
+			ok = 0;
+			strcpy(missing, block_missing);
+		}
+
+		i = end;
+	}
+
+	if (rom0_sets && !rom0_ok)
+	{
+		ok = 0;
+		strcpy(missing, missing0);
+	}
+
+	for (auto &z : zips)
+	{
+		if (!z.second) continue;
+		mz_zip_reader_end(z.second);
+		delete z.second;
+	}
+
+	if (!ok) snprintf(msg, msg_size, "%s", missing);
+	return ok;
+}
@@ -0,0 +1,31 @@
+#ifndef MRA_INDEX_H_
+#define MRA_INDEX_H_
+
+#include <stdint.h>
+
+#define MRA_INDEX_SETNAME   0x01 // <setname> present
+#define MRA_INDEX_SAMEDIR   0x02 // <setname same_dir="1">
+#define MRA_INDEX_ROTATION  0x04 // <rotation> present
+
+struct mra_info_t
+{
+	char     setname[256];
+	char     rbf[256];
+	char     year[16];
+	char     manufacturer[128];
+	uint32_t flags;
+	int      rotation_dir; // as arcade_rotation_dir(): 0 - horizontal, 1 - CW, 2 - CCW
+};
+
+// Start the background indexer walking the _Arcade folder (no-op if already running).
+void mra_index_start();
+
+// Fill info for the given MRA if it is indexed and unchanged since (mtime/size).
+// Returns 0 if the MRA has to be parsed.
+int mra_index_lookup(const char *path, mra_info_t *info);
+
+// Check that the zips under root hold every ROM part the MRA needs, by CRC or name.
+// Returns 1 if all are found, 0 if not (msg names the first missing part), -1 if not indexed.
+int mra_index_check_roms(const char *path, const char *root, char *msg, int msg_size);
+
+#endif
@@ -15,9 +15,11 @@
 #include "../../shmem.h"
 #include "../../str_util.h"
 #include "../../cheats.h"
+#include "../../buffer_pool.h"
 
 #include "buffer.h"
 #include "mra_loader.h"
+#include "mra_index.h"
 
 #define kBigTextSize 1024
 struct arc_struct {
@@ -285,28 +287,37 @@ static int rom_data(const uint8_t *buf, int chunk, int map, struct MD5Context *m
 static int rom_file(const char *name, uint32_t crc32, int start, int len, int map, struct MD5Context *md5context)
 {
 	fileTYPE f = {};
-	static uint8_t buf[8192];
 	if (!FileOpenZip(&f, name, crc32)) return 0;
 	if (start) FileSeek(&f, start, SEEK_SET);
 	unsigned long bytes2send = f.size - f.offset;
 	if (len > 0 && len < (int)bytes2send) bytes2send = len;
 
+	const uint32_t buf_size = iobuf_chunk(&f);
+	uint8_t *buf = (uint8_t *)iobuf_get(buf_size);
+	if (!buf)
+	{
+		FileClose(&f);
+		return 0;
+	}
+
+	int ret = 1;
 	while (bytes2send)
 	{
-		uint16_t chunk = (bytes2send > sizeof(buf)) ? sizeof(buf) : bytes2send;
+		uint32_t chunk = (bytes2send > buf_size) ? buf_size : bytes2send;
 
 		FileReadAdv(&f, buf, chunk);
 		if (!rom_data(buf, chunk, map, md5context))
 		{
-			FileClose(&f);
-			return 0;
+			ret = 0;
+			break;
 		};
 
 		bytes2send -= chunk;
 	}
 
+	iobuf_put(buf);
 	FileClose(&f);
-	return 1;
+	return ret;
 }
 
 static int rom_patch(const uint8_t *buf, int offset, uint16_t len, int dataop)
@@ -773,7 +784,7 @@ static int xml_send_rom(XMLEvent evt, const XMLNode* node, SXML_CHAR* text, cons
 			for (int i = 1; i < 8; i++) romlen[i] = romlen[0];
 		}
 
-		ProgressMessage("Loading", message, ftell(sd->file), arc_info->file_size);
+		ProgressMessage("Loading", message, sd->pos, arc_info->file_size);
 		break;
 
 	case XML_EVENT_TEXT:
@@ -1040,6 +1051,21 @@ static int xml_scan_rbf(XMLEvent evt, const XMLNode* node, SXML_CHAR* text, cons
 	return true;
 }
 
+int arcade_rotation_dir(const char *rotation)
+{
+	if (strncasecmp(rotation, "vertical", 8)) return 0;
+
+	// Check for CCW first (must check before CW since "ccw" contains "cw")
+	if (strstr(rotation, "ccw") || strstr(rotation, "CCW") ||
+	    strstr(rotation, "counterclockwise") || strstr(rotation, "counter-clockwise"))
+	{
+		return 2;
+	}
+
+	// Then check for CW, and fallback to CW if no direction is declared
+	return 1;
+}
+
 static int xml_read_pre_parse(XMLEvent evt, const XMLNode* node, SXML_CHAR* text, const int n, SAX_Data* sd)
 {
 	(void)(sd);
@@ -1088,29 +1114,8 @@ static int xml_read_pre_parse(XMLEvent evt, const XMLNode* node, SXML_CHAR* text
 		}
 		if(inrotation)
 		{
-			is_vertical = strncasecmp(text, "vertical", 8) == 0;
-
-			rotation_dir = 0;
-			if (is_vertical)
-			{
-				// Check for CCW first (must check before CW since "ccw" contains "cw")
-				if (strstr(text, "ccw") || strstr(text, "CCW") ||
-				    strstr(text, "counterclockwise") || strstr(text, "counter-clockwise"))
-				{
-					rotation_dir = 2;
-				}
-				// Then check for CW
-				else if (strstr(text, "cw") || strstr(text, "CW") ||
-				         strstr(text, "clockwise"))
-				{
-					rotation_dir = 1;
-				}
-				// Default to CW if no direction specified
-				else
-				{
-					rotation_dir = 1; // Fallback to CW if no direction is declared
-				}
-			}
+			rotation_dir = arcade_rotation_dir(text);
+			is_vertical = rotation_dir != 0;
 		}
 		break;
 
@@ -1184,6 +1189,23 @@ int arcade_send_rom(const char *xml)
 
 void arcade_pre_parse(const char *xml)
 {
+	mra_info_t info;
+	if (mra_index_lookup(xml, &info))
+	{
+		rotation_dir = 0;
+		if (info.flags & MRA_INDEX_SETNAME && info.setname[0])
+		{
+			user_io_name_override(info.setname, (info.flags & MRA_INDEX_SAMEDIR) ? 1 : 0);
+			snprintf(arcade_setname, sizeof(arcade_setname), "%s", info.setname);
+		}
+		if (info.flags & MRA_INDEX_ROTATION)
+		{
+			rotation_dir = info.rotation_dir;
+			is_vertical = rotation_dir != 0;
+		}
+		return;
+	}
+
 	SAX_Callbacks sax;
 	SAX_Callbacks_init(&sax);
 
@@ -1225,11 +1247,19 @@ static const char *get_rbf(const char *xml, int arcade)
 	static char rbfname[kBigTextSize];
 
 	rbfname[0] = 0;
-	SAX_Callbacks sax;
-	SAX_Callbacks_init(&sax);
+	mra_info_t info;
+	if (arcade && mra_index_lookup(xml, &info))
+	{
+		snprintf(rbfname, sizeof(rbfname), "%s", info.rbf);
+	}
+	else
+	{
+		SAX_Callbacks sax;
+		SAX_Callbacks_init(&sax);
 
-	sax.all_event = xml_scan_rbf;
-	XMLDoc_parse_file_SAX(xml, &sax, rbfname);
+		sax.all_event = xml_scan_rbf;
+		XMLDoc_parse_file_SAX(xml, &sax, rbfname);
+	}
 
 	/* once we have the rbfname fragment from the MRA xml file
 	 * search the arcade folder for the match */
@@ -1262,7 +1292,7 @@ static const char *get_rbf(const char *xml, int arcade)
 	while ((entry = readdir(dir)) != NULL)
 	{
 		len = strlen(entry->d_name);
-		if (entry->d_type != DT_DIR && len > 4 && !strcasecmp(entry->d_name+len-4,".rbf"))
+		if (entry->d_type != DT_DIR && ((len > 4 && !strcasecmp(entry->d_name+len-4,".rbf")) || (len > 8 && !strcasecmp(entry->d_name+len-8,".rbf.zst"))))
 		{
 			static char newstring[kBigTextSize];
 			//printf("entry name: %s\n",entry->d_name);
@@ -1313,7 +1343,14 @@ int xml_load(const char *xml)
 	printf("xml_load [%s]\n", path);
 	const char *rbf = get_rbf(path, is_arcade);
 
-	if (rbf)
+	// With the MRA indexed, missing ROMs are reported without loading the core first.
+	static char msg[kBigTextSize];
+	if (rbf && is_arcade && !mra_index_check_roms(path, get_arcade_root(0), msg, sizeof(msg)))
+	{
+		printf("ERROR: [%s]\n", msg);
+		Info(msg, 1000 * 5);
+	}
+	else if (rbf)
 	{
 		printf("XML: %s, RBF: %s\n", path, rbf);
 		fpga_load_rbf(rbf, NULL, path);
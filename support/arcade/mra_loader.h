@@ -63,6 +63,9 @@ void arcade_sw_load();
 // Read any mra info necessary for ini processing
 void arcade_pre_parse(const char *xml);
 
+// 0 - horizontal, 1 - vertical CW, 2 - vertical CCW
+int arcade_rotation_dir(const char *rotation);
+
 bool arcade_is_vertical();
 int arcade_get_direction();
 
@@ -12,6 +12,7 @@
 #include "../../menu.h"
 #include "../../input.h"
 #include "../../shmem.h"
+#include "../../crc32.h"
 
 #include "c64.h"
 
@@ -289,6 +290,8 @@ static int c64_convert_t64_to_d64(fileTYPE* f_in, fileTYPE* f_out)
 
 int c64_openT64(const char *path, fileTYPE* f)
 {
+	if (FileOpenVDiskCached(f, path)) return 1;
+
 	if (!FileOpenEx(f, "vdsk", -1))
 	{
 		printf("ERROR: fail to create vdsk\n");
@@ -310,12 +313,34 @@ int c64_openT64(const char *path, fileTYPE* f)
 		printf("Failed to convert T64 (%s).\n", path);
 		FileClose(f);
 	}
+	else FileStoreVDiskCache(f, path);
 
 	return ret;
 }
 
 // -----------------------------------------------------------------------------------------
 
+// Synthesized G64 images of recently mounted D64/D71s, keyed by a CRC of the
+// image contents, so switching between the disks of a multi-disk game does not
+// re-encode them. Each entry keeps the D64 data as well, so a track written by
+// the drive is patched into both in place instead of dropping the entry.
+#define G64_CACHE_SLOTS 8
+
+struct g64_cache_t
+{
+	uint32_t crc;
+	uint32_t d64_size;
+	uint8_t  tracks;
+	uint8_t  id[2];
+	uint8_t *d64;
+	uint8_t *g64;
+	uint32_t g64_size;
+	uint32_t stamp;
+};
+
+static g64_cache_t g64_cache[G64_CACHE_SLOTS] = {};
+static uint32_t g64_cache_stamp = 0;
+
 struct img_info
 {
 	fileTYPE *f;
@@ -325,6 +350,8 @@ struct img_info
 	uint32_t trk_map[168];
 	uint32_t spd_map[168];
 	int *sector_map;
+	g64_cache_t *cache; // synthesized image of a D64/D71, valid while its crc matches
+	uint32_t crc;
 };
 
 static img_info gcr_info[16] = {};
@@ -377,7 +404,7 @@ static int start_sectors[4][85] = {
 	// }
 };
 
-static uint32_t c64_synthesize_gcr_track(int idx, uint8_t track_h, int size);
+static uint32_t c64_synthesize_gcr_track(const uint8_t *src, uint8_t *dst, uint8_t track_h, int size, const uint8_t *id);
 static void c64_synthesize_g64_image(int idx, uint32_t phys_addr, uint32_t map_size);
 
 int c64_openGCR(const char *path, fileTYPE *f, int idx)
@@ -466,6 +493,7 @@ int c64_openGCR(const char *path, fileTYPE *f, int idx)
 void c64_closeGCR(int idx)
 {
 	gcr_info[idx].type = 0;
+	gcr_info[idx].cache = 0;
 }
 
 static const uint8_t gcr_lut[16] = {
@@ -482,153 +510,234 @@ static const uint8_t bin_lut[32] = {
 	0, 9, 10, 11, 0, 13, 14, 0
 };
 
-static uint8_t *gcrptr;
-static int gcrcnt = 0;
+// Whole-byte GCR tables built from the nibble ones above: a byte encodes to 10
+// GCR bits (high nibble first), and 10 GCR bits decode back to a byte, with
+// invalid quintets reading as 0 the way VICE's decoder treats them.
+struct gcr_tables_t
+{
+	uint16_t enc[256];
+	uint8_t  dec[1024];
+};
 
-void bin2gcr(uint8_t bin)
+static constexpr gcr_tables_t gcr_make_tables()
 {
-	static uint64_t gcr = 0;
+	gcr_tables_t tab = {};
+	for (int i = 0; i < 256; i++) tab.enc[i] = (uint16_t)((gcr_lut[i >> 4] << 5) | gcr_lut[i & 0xF]);
+	for (int i = 0; i < 1024; i++) tab.dec[i] = (uint8_t)((bin_lut[i >> 5] << 4) | bin_lut[i & 0x1F]);
+	return tab;
+}
 
-	gcr <<= 5;
-	gcr |= gcr_lut[(bin >> 4) & 0xF];
-	gcr <<= 5;
-	gcr |= gcr_lut[bin & 0xF];
+static constexpr gcr_tables_t gcr_tab = gcr_make_tables();
 
-	gcrcnt++;
-	if (gcrcnt == 4)
-	{
-		gcrcnt = 0;
-		*gcrptr++ = (uint8_t)(gcr >> 32);
-		*gcrptr++ = (uint8_t)(gcr >> 24);
-		*gcrptr++ = (uint8_t)(gcr >> 16);
-		*gcrptr++ = (uint8_t)(gcr >> 8);
-		*gcrptr++ = (uint8_t)(gcr);
-	}
+// 4 data bytes -> 5 GCR bytes
+static inline void gcr_encode4(const uint8_t *bin, uint8_t *gcr)
+{
+	uint64_t v = ((uint64_t)gcr_tab.enc[bin[0]] << 30) | ((uint64_t)gcr_tab.enc[bin[1]] << 20) |
+	             ((uint32_t)gcr_tab.enc[bin[2]] << 10) | gcr_tab.enc[bin[3]];
+	gcr[0] = (uint8_t)(v >> 32);
+	gcr[1] = (uint8_t)(v >> 24);
+	gcr[2] = (uint8_t)(v >> 16);
+	gcr[3] = (uint8_t)(v >> 8);
+	gcr[4] = (uint8_t)v;
+}
+
+// 5 GCR bytes -> 4 data bytes
+static inline void gcr_decode4(const uint8_t *gcr, uint8_t *bin)
+{
+	uint64_t v = ((uint64_t)gcr[0] << 32) | ((uint32_t)gcr[1] << 24) | (gcr[2] << 16) | (gcr[3] << 8) | gcr[4];
+	bin[0] = gcr_tab.dec[(v >> 30) & 0x3FF];
+	bin[1] = gcr_tab.dec[(v >> 20) & 0x3FF];
+	bin[2] = gcr_tab.dec[(v >> 10) & 0x3FF];
+	bin[3] = gcr_tab.dec[v & 0x3FF];
 }
 
-void gcr2bin(uint8_t *gcr, uint8_t *bin)
+static inline uint32_t rd_le32(const uint8_t *p)
 {
-	// from VICE
-	register uint32_t tmp = *gcr;
-	tmp <<= 13;
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void wr_le32(uint8_t *p, uint32_t v)
+{
+	p[0] = (uint8_t)v;
+	p[1] = (uint8_t)(v >> 8);
+	p[2] = (uint8_t)(v >> 16);
+	p[3] = (uint8_t)(v >> 24);
+}
 
-	for (int i = 5; i < 13; i += 2, bin++)
+static uint8_t d64_track_h(int idx, uint8_t track_f)
+{
+	return ((track_f >= 42) ? track_f % 42 + gcr_info[idx].tracks / 2 : track_f) + 1;
+}
+
+// Encode one track of D64 sectors at src into GCR at dst. Returns the GCR size.
+static uint32_t c64_synthesize_gcr_track(const uint8_t *src, uint8_t *dst, uint8_t track_h, int size, const uint8_t *id)
+{
+	uint8_t *p = dst;
+	uint8_t blk[260];
+	uint8_t sec = 0;
+	int gap = (track_h < 18) ? 8 : (track_h < 25) ? 17 : (track_h < 31) ? 12 : 9;
+
+	for (int ptr = 0; ptr < size; ptr += 256, sec++)
 	{
-		gcr++;
-		tmp |= ((uint32_t)(*gcr)) << i;
-		*bin = bin_lut[(tmp >> 16) & 0x1f] << 4;
-		tmp <<= 5;
-		*bin |= bin_lut[(tmp >> 16) & 0x1f];
-		tmp <<= 5;
+		// header block
+		memset(p, 0xFF, 5); p += 5;
+		uint8_t hdr[8] = { 0x08, (uint8_t)(sec ^ track_h ^ id[0] ^ id[1]), sec, track_h, id[1], id[0], 0x0F, 0x0F };
+		gcr_encode4(hdr, p);
+		gcr_encode4(hdr + 4, p + 5);
+		p += 10;
+		memset(p, 0x55, 9); p += 9;
+
+		// data block
+		memset(p, 0xFF, 5); p += 5;
+		uint8_t cs = 0;
+		blk[0] = 0x07;
+		for (int i = 0; i < 256; i++) cs ^= (blk[i + 1] = src[ptr + i]);
+		blk[257] = cs;
+		blk[258] = 0;
+		blk[259] = 0;
+		for (int i = 0; i < 260; i += 4, p += 5) gcr_encode4(blk + i, p);
+
+		memset(p, 0x55, gap); p += gap;
 	}
+
+	return p - dst;
 }
 
-static uint32_t c64_synthesize_gcr_track(int idx, uint8_t track_h, int size)
+// Build the whole G64/G71 image for a D64/D71 held in memory. Returns its size.
+static uint32_t c64_build_g64(int idx, const uint8_t *d64, uint8_t *g64)
 {
-	uint8_t sec = 0;
-	gcrptr = gcr_buf + 2;
-	for (int ptr = 0; ptr < size; ptr += 256)
+	uint32_t num_tracks = (gcr_info[idx].tracks > 42) ? 168 : 84;
+	memset(g64, 0, 12 + num_tracks * 8); // Clear header area
+	memcpy(g64, "GCR-1541", 8);
+	g64[8] = 0; // version
+	g64[9] = num_tracks; // max tracks
+
+	uint32_t speed_offset = 12 + num_tracks * 4;
+	uint32_t offset = 12 + num_tracks * 8;
+	for (uint32_t t = 0; t < num_tracks; t += 2)
 	{
-		gcrcnt = 0;
-		*gcrptr++ = 0xFF; *gcrptr++ = 0xFF; *gcrptr++ = 0xFF; *gcrptr++ = 0xFF; *gcrptr++ = 0xFF;
-		bin2gcr(0x08);
-		bin2gcr(sec ^ track_h ^ gcr_info[idx].id[0] ^ gcr_info[idx].id[1]);
-		bin2gcr(sec);
-		bin2gcr(track_h);
-		bin2gcr(gcr_info[idx].id[1]);
-		bin2gcr(gcr_info[idx].id[0]);
-		bin2gcr(0x0F);
-		bin2gcr(0x0F);
-		*gcrptr++ = 0x55; *gcrptr++ = 0x55; *gcrptr++ = 0x55; *gcrptr++ = 0x55; *gcrptr++ = 0x55;
-		*gcrptr++ = 0x55; *gcrptr++ = 0x55; *gcrptr++ = 0x55; *gcrptr++ = 0x55;
+		uint8_t track_f = t >> 1;
+		if (track_f >= 84) break;
 
-		uint8_t cs = 0;
-		uint8_t bt;
+		int size = (gcr_info[idx].sector_map[track_f + 1] - gcr_info[idx].sector_map[track_f]) * 256;
+		if (!size) continue;
+
+		uint8_t track_h = d64_track_h(idx, track_f);
+		uint32_t track_size = c64_synthesize_gcr_track(d64 + gcr_info[idx].sector_map[track_f] * 256, g64 + offset + 2, track_h, size, gcr_info[idx].id);
+
+		// Format requires the length at beginning of track data payload
+		g64[offset] = (uint8_t)track_size;
+		g64[offset + 1] = (uint8_t)(track_size >> 8);
 
-		*gcrptr++ = 0xFF; *gcrptr++ = 0xFF; *gcrptr++ = 0xFF; *gcrptr++ = 0xFF; *gcrptr++ = 0xFF;
-		bin2gcr(0x07);
-		for (int i = 0; i < 256; i++)
+		// Track pointer and speed zone
+		wr_le32(g64 + 12 + t * 4, offset);
+		wr_le32(g64 + speed_offset + t * 4, (track_h < 18) ? 3 : (track_h < 25) ? 2 : (track_h < 31) ? 1 : 0);
+
+		offset += track_size + 2;
+	}
+
+	return offset;
+}
+
+// Load the D64/D71 and find or build its synthesized image in the cache.
+static g64_cache_t *c64_cache_image(int idx, uint32_t max_size)
+{
+	uint32_t d64_size = gcr_info[idx].sector_map[84] * 256;
+	uint8_t *d64 = (uint8_t*)malloc(d64_size);
+	if (!d64) return 0;
+
+	// A short image reads as zeroes past its end.
+	memset(d64, 0, d64_size);
+	FileSeek(gcr_info[idx].f, 0, SEEK_SET);
+	FileReadAdv(gcr_info[idx].f, d64, d64_size);
+
+	uint32_t crc = crc32_update(0, d64, d64_size);
+
+	g64_cache_t *slot = &g64_cache[0];
+	for (int i = 0; i < G64_CACHE_SLOTS; i++)
+	{
+		g64_cache_t *c = &g64_cache[i];
+		if (c->g64 && c->crc == crc && c->d64_size == d64_size && c->tracks == gcr_info[idx].tracks && !memcmp(c->id, gcr_info[idx].id, 2))
 		{
-			bt = trk_buf[ptr + i];
-			cs ^= bt;
-			bin2gcr(bt);
+			free(d64);
+			c->stamp = ++g64_cache_stamp;
+			return c;
 		}
-		bin2gcr(cs);
-		bin2gcr(0);
-		bin2gcr(0);
 
-		int gap = (track_h < 18) ? 8 : (track_h < 25) ? 17 : (track_h < 31) ? 12 : 9;
-		while (gap--) *gcrptr++ = 0x55;
-		sec++;
+		if (!c->g64) { if (slot->g64) slot = c; }
+		else if (slot->g64 && c->stamp < slot->stamp) slot = c;
 	}
 
-	return gcrptr - gcr_buf - 2;
+	uint8_t *g64 = (uint8_t*)malloc(max_size);
+	if (!g64)
+	{
+		free(d64);
+		return 0;
+	}
+
+	uint32_t g64_size = c64_build_g64(idx, d64, g64);
+	uint8_t *shrunk = (uint8_t*)realloc(g64, g64_size);
+	if (shrunk) g64 = shrunk;
+
+	free(slot->d64);
+	free(slot->g64);
+	slot->crc = crc;
+	slot->d64_size = d64_size;
+	slot->tracks = gcr_info[idx].tracks;
+	memcpy(slot->id, gcr_info[idx].id, 2);
+	slot->d64 = d64;
+	slot->g64 = g64;
+	slot->g64_size = g64_size;
+	slot->stamp = ++g64_cache_stamp;
+	return slot;
 }
 
-static void c64_synthesize_g64_image(int idx, uint32_t phys_addr, uint32_t map_size)
+// The drive's cached image, if it still matches the D64 on disk.
+static g64_cache_t *c64_drive_cache(int idx)
 {
-	uint8_t* ddram = (uint8_t*)shmem_map(phys_addr, map_size);
-	if (ddram)
-	{
-		printf("Synthesizing D64/D71 to DDR3 G64 at 0x%X\n", phys_addr);
+	g64_cache_t *c = gcr_info[idx].cache;
+	return (c && c->g64 && c->crc == gcr_info[idx].crc) ? c : 0;
+}
 
-		uint32_t num_tracks = (gcr_info[idx].tracks > 42) ? 168 : 84;
-		memset(ddram, 0, 12 + num_tracks * 8); // Clear header area
-		memcpy(ddram, "GCR-1541", 8);
-		ddram[8] = 0; // version
-		ddram[9] = num_tracks; // max tracks
+// Apply a track the drive has just written back (in trk_buf) to the cached
+// D64 data and re-encode only that track. A new disk id changes every header,
+// so in that case the whole image is rebuilt from the cached D64.
+static void c64_cache_update_track(int idx, g64_cache_t *c, uint8_t track_f, int sec_cnt)
+{
+	uint8_t *d64 = c->d64 + gcr_info[idx].sector_map[track_f] * 256;
+	memcpy(d64, trk_buf, sec_cnt * 256);
 
-		uint32_t offset = 12 + num_tracks * 8;
-		for (uint32_t t = 0; t < num_tracks; t++) {
-			uint8_t track_f = t >> 1;
-			uint8_t track_h = ((track_f >= 42) ? track_f%42 + gcr_info[idx].tracks/2 : track_f) + 1;
+	if (memcmp(c->id, gcr_info[idx].id, 2))
+	{
+		memcpy(c->id, gcr_info[idx].id, 2);
+		c64_build_g64(idx, c->d64, c->g64);
+	}
+	else
+	{
+		uint32_t offset = rd_le32(c->g64 + 12 + track_f * 8);
+		if (offset) c64_synthesize_gcr_track(d64, c->g64 + offset + 2, d64_track_h(idx, track_f), sec_cnt * 256, c->id);
+	}
 
-			int size = 0;
-			if ((t & 1) == 0 && track_f < 84) {
-				size = (gcr_info[idx].sector_map[track_f + 1] - gcr_info[idx].sector_map[track_f]) * 256;
-			}
+	c->crc = crc32_update(0, c->d64, c->d64_size);
+	gcr_info[idx].crc = c->crc;
+}
 
-			if (size) {
-				FileSeek(gcr_info[idx].f, gcr_info[idx].sector_map[track_f] * 256, SEEK_SET);
-				FileReadAdv(gcr_info[idx].f, trk_buf, size);
-
-				uint32_t track_size = c64_synthesize_gcr_track(idx, track_h, size);
-
-				// Format requires the length at beginning of track data payload
-				gcr_buf[0] = (uint8_t)track_size;
-				gcr_buf[1] = (uint8_t)(track_size >> 8);
-
-				// Write track pointer into header offset map
-				ddram[0x0C + t*4] = offset & 0xFF;
-				ddram[0x0D + t*4] = (offset >> 8) & 0xFF;
-				ddram[0x0E + t*4] = (offset >> 16) & 0xFF;
-				ddram[0x0F + t*4] = (offset >> 24) & 0xFF;
-
-				// Write speed zone
-				uint32_t speed_offset = 12 + num_tracks * 4;
-				uint32_t speed = (track_h < 18) ? 3 : (track_h < 25) ? 2 : (track_h < 31) ? 1 : 0;
-				ddram[speed_offset + t*4] = speed & 0xFF;
-				ddram[speed_offset + 1 + t*4] = (speed >> 8) & 0xFF;
-				ddram[speed_offset + 2 + t*4] = (speed >> 16) & 0xFF;
-				ddram[speed_offset + 3 + t*4] = (speed >> 24) & 0xFF;
-
-				memcpy(ddram + offset, gcr_buf, track_size + 2);
-				offset += track_size + 2;
-			} else {
-				// Dummy track (empty)
-				ddram[0x0C + t*4] = 0;
-				ddram[0x0D + t*4] = 0;
-				ddram[0x0E + t*4] = 0;
-				ddram[0x0F + t*4] = 0;
-
-				uint32_t speed_offset = 12 + num_tracks * 4;
-				ddram[speed_offset + t*4] = 0;
-				ddram[speed_offset + 1 + t*4] = 0;
-				ddram[speed_offset + 2 + t*4] = 0;
-				ddram[speed_offset + 3 + t*4] = 0;
-			}
-		}
+static void c64_synthesize_g64_image(int idx, uint32_t phys_addr, uint32_t map_size)
+{
+	g64_cache_t *c = c64_cache_image(idx, map_size);
+	gcr_info[idx].cache = c;
+	gcr_info[idx].crc = c ? c->crc : 0;
+	if (!c)
+	{
+		printf("Cannot synthesize D64/D71: out of memory\n");
+		return;
+	}
 
+	uint8_t* ddram = (uint8_t*)shmem_map(phys_addr, map_size);
+	if (ddram)
+	{
+		printf("Synthesizing D64/D71 to DDR3 G64 at 0x%X\n", phys_addr);
+		memcpy(ddram, c->g64, c->g64_size);
 		shmem_unmap(ddram, map_size);
 	}
 }
@@ -667,15 +776,24 @@ void c64_readGCR(int idx, uint64_t lba, uint32_t blks)
 	}
 	else // D64, T64, D71 (C128)
 	{
-		uint8_t track_h = ((track_f >= 42) ? track_f%42 + gcr_info[idx].tracks/2 : track_f) + 1;
+		uint8_t track_h = d64_track_h(idx, track_f);
 		int size = track_f < 84 ? (gcr_info[idx].sector_map[track_f + 1] - gcr_info[idx].sector_map[track_f]) * 256 : 0;
+		g64_cache_t *c = c64_drive_cache(idx);
 
 		// dbgprintf("GCR physical track=%d%s, logical track=%d, size=%d\n", (track >> 1) + 1, (track & 1) ? ".5" : "", track_h, size);
-		if (size) {
+		if (size && c) {
+			uint32_t offset = rd_le32(c->g64 + 12 + track * 4);
+			track_size = offset ? (c->g64[offset + 1] << 8) | c->g64[offset] : 0;
+			if (track_size > G64_MAX_TRACK_LEN - 2) track_size = G64_MAX_TRACK_LEN - 2;
+			memcpy(gcr_buf + 2, c->g64 + offset + 2, track_size);
+
+			dbgprintf("Read GCR track %d (cached): bin_size = %d, gcr_size = %d\n", track_f+1, size, track_size);
+		}
+		else if (size) {
 			FileSeek(gcr_info[idx].f, gcr_info[idx].sector_map[track_f] * 256, SEEK_SET);
 			FileReadAdv(gcr_info[idx].f, trk_buf, size);
 
-			track_size = c64_synthesize_gcr_track(idx, track_h, size);
+			track_size = c64_synthesize_gcr_track(trk_buf, gcr_buf + 2, track_h, size, gcr_info[idx].id);
 
 			dbgprintf("Read GCR track %d: bin_size = %d, gcr_size = %d\n", track_f+1, size, track_size);
 		}
@@ -910,7 +1028,7 @@ void c64_writeGCR(int idx, uint64_t lba, uint32_t blks)
 			uint8_t *hdr = align(gcr_buf + ptr + off, 11);
 
 			uint32_t bin;
-			gcr2bin(hdr, (uint8_t*)&bin);
+			gcr_decode4(hdr, (uint8_t*)&bin);
 			if (!started && (bin & 0xFF) == 8)
 			{
 				off = ptr - 2;
@@ -924,7 +1042,7 @@ void c64_writeGCR(int idx, uint64_t lba, uint32_t blks)
 			if ((bin & 0xFF) == 8)
 			{
 				sec = (uint8_t)(bin >> 16);
-				gcr2bin(hdr + 5, (uint8_t*)&bin);
+				gcr_decode4(hdr + 5, (uint8_t*)&bin);
 				gcr_info[idx].id[1] = (uint8_t)(bin);
 				gcr_info[idx].id[0] = (uint8_t)(bin >> 8);
 
@@ -941,7 +1059,7 @@ void c64_writeGCR(int idx, uint64_t lba, uint32_t blks)
 					int src = 0;
 					for (; dst < 260; src += 5, dst += 4)
 					{
-						gcr2bin(data + src, sec_buf + dst);
+						gcr_decode4(data + src, sec_buf + dst);
 					}
 
 					memcpy(trk_buf + (sec * 256), sec_buf + 1, 256);
@@ -977,6 +1095,9 @@ void c64_writeGCR(int idx, uint64_t lba, uint32_t blks)
 
 	FileSeek(gcr_info[idx].f, gcr_info[idx].sector_map[track] * 256, SEEK_SET);
 	FileWriteAdv(gcr_info[idx].f, trk_buf, sec_cnt * 256);
+
+	g64_cache_t *c = c64_drive_cache(idx);
+	if (c) c64_cache_update_track(idx, c, track, sec_cnt);
 }
 
 static const int crt_bank_size = 8192 + 16;
@@ -80,39 +80,6 @@ static toc_t toc = {};
 CdgUnpacker cdg_unpack;
 bool sub_loaded_from_cdg;
 
-static int sgets(char* out, int sz, char** in)
-{
-	*out = 0;
-	do
-	{
-		char* instr = *in;
-		int cnt = 0;
-
-		while (*instr && *instr != 10)
-		{
-			if (*instr == 13)
-			{
-				instr++;
-				continue;
-			}
-
-			if (cnt < sz - 1)
-			{
-				out[cnt++] = *instr;
-				out[cnt] = 0;
-			}
-
-			instr++;
-		}
-
-		if (*instr == 10)
-			instr++;
-		*in = instr;
-	} while (!*out && **in);
-
-	return *out;
-}
-
 static void unload_chd(toc_t* table)
 {
 	if (table->chd_f)
@@ -182,7 +149,7 @@ static int load_cue(const char* filename, toc_t* table)
 {
 	static char fname[1024 + 10];
 	static char line[128];
-	char *ptr, *lptr;
+	char *lptr;
 	static char cue[100 * 1024];
 
 	unload_cue(table);
@@ -222,7 +189,7 @@ static int load_cue(const char* filename, toc_t* table)
 	int index1 = 0;
 
 	char* buf = cue;
-	while (sgets(line, sizeof(line), &buf))
+	while (cd_sgets(line, sizeof(line), &buf))
 	{
 		lptr = line;
 		while (*lptr == 0x20)
@@ -231,29 +198,7 @@ static int load_cue(const char* filename, toc_t* table)
 		/* decode FILE commands */
 		if (!(memcmp(lptr, "FILE", 4)))
 		{
-			ptr = fname + strlen(fname) - 1;
-			while ((ptr - fname) && (*ptr != '/') && (*ptr != '\\'))
-				ptr--;
-			if (ptr - fname)
-				ptr++;
-
-			lptr += 4;
-			while (*lptr == 0x20)
-				lptr++;
-
-			if (*lptr == '\"')
-			{
-				lptr++;
-				while ((*lptr != '\"') && (lptr < (line + sizeof(line))) && (ptr < (fname + sizeof(fname) - 1)))
-					*ptr++ = *lptr++;
-			}
-			else
-			{
-				while (*lptr && (*lptr != 0x20) && (lptr < (line + sizeof(line))) &&
-					   (ptr < (fname + sizeof(fname) - 1)))
-					*ptr++ = *lptr++;
-			}
-			*ptr = 0;
+			lptr = cd_cue_file(fname, sizeof(fname), lptr + 4);
 
 			if (!FileOpen(&table->tracks[table->last].f, fname))
 				return 0;
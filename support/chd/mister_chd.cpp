@@ -184,3 +184,19 @@ chd_error mister_chd_read_sector(chd_file *chd_f, int lba, uint32_t d_offset, ui
 	memcpy(destbuf + d_offset, hunkbuf + sector_offset + s_offset, length);
 	return CHDERR_NONE;
 }
+
+// Sectors of a run that share a hunk are copied out of one decompressed hunk.
+chd_error mister_chd_read_sectors(chd_file *chd_f, int lba, int count, int sector_size, int format, uint8_t *destbuf, uint8_t *hunkbuf, int *hunknum)
+{
+	int src_ofs, dst_ofs, len;
+	if (!cd_sector_slice(sector_size, format, &src_ofs, &dst_ofs, &len)) return CHDERR_INVALID_PARAMETER;
+
+	int stride = cd_format_size(format);
+	for (int i = 0; i < count; i++)
+	{
+		chd_error err = mister_chd_read_sector(chd_f, lba + i, i * stride + dst_ofs, src_ofs, len, destbuf, hunkbuf, hunknum);
+		if (err != CHDERR_NONE) return err;
+	}
+
+	return CHDERR_NONE;
+}
@@ -6,6 +6,7 @@
 #include "../../cd.h"
 
 chd_error mister_chd_read_sector(chd_file *chd_f, int lba, uint32_t d_offset, uint32_t s_offset, int length, uint8_t *destbuf, uint8_t *hunkbuf, int *hunknum);
+chd_error mister_chd_read_sectors(chd_file *chd_f, int lba, int count, int sector_size, int format, uint8_t *destbuf, uint8_t *hunkbuf, int *hunknum);
 chd_error mister_load_chd(const char *filename, toc_t *cd_toc);
 
 #endif
@@ -37,44 +37,11 @@ cdd_t::cdd_t() {
 	stat[9] = 0x4;
 }
 
-static int sgets(char *out, int sz, char **in)
-{
-	*out = 0;
-	do
-	{
-		char *instr = *in;
-		int cnt = 0;
-
-		while (*instr && *instr != 10)
-		{
-			if (*instr == 13)
-			{
-				instr++;
-				continue;
-			}
-
-			if (cnt < sz - 1)
-			{
-				out[cnt++] = *instr;
-				out[cnt] = 0;
-			}
-
-			instr++;
-		}
-
-		if(*instr == 10) instr++;
-		*in = instr;
-	}
-	while (!*out && **in);
-
-	return *out;
-}
-
 
 int cdd_t::LoadCUE(const char* filename) {
 	static char fname[1024 + 10];
 	static char line[128];
-	char *ptr, *lptr;
+	char *lptr;
 	static char header[1024];
 	static char toc[100 * 1024];
 
@@ -88,7 +55,7 @@ int cdd_t::LoadCUE(const char* filename) {
 	int mm, ss, bb, pregap = 0;
 
 	char *buf = toc;
-	while (sgets(line, sizeof(line), &buf))
+	while (cd_sgets(line, sizeof(line), &buf))
 	{
 		lptr = line;
 		while (*lptr == 0x20) lptr++;
@@ -96,25 +63,7 @@ int cdd_t::LoadCUE(const char* filename) {
 		/* decode FILE commands */
 		if (!(memcmp(lptr, "FILE", 4)))
 		{
-			ptr = fname + strlen(fname) - 1;
-			while ((ptr - fname) && (*ptr != '/') && (*ptr != '\\')) ptr--;
-			if (ptr - fname) ptr++;
-
-			lptr += 4;
-			while (*lptr == 0x20) lptr++;
-
-			if (*lptr == '\"')
-			{
-				lptr++;
-				while ((*lptr != '\"') && (lptr <= (line + 128)) && (ptr < (fname + 1023)))
-					*ptr++ = *lptr++;
-			}
-			else
-			{
-				while ((*lptr != 0x20) && (lptr <= (line + 128)) && (ptr < (fname + 1023)))
-					*ptr++ = *lptr++;
-			}
-			*ptr = 0;
+			lptr = cd_cue_file(fname, 1024, lptr + 4);
 
 			if(!FileOpen(&this->toc.tracks[this->toc.last].f, fname)) return -1;
 
@@ -976,6 +925,7 @@ int cdd_t::ReadCDDA(uint8_t *buf)
 		}
 
 	} else if (this->toc.tracks[this->index].f.opened()) {
+		FileSetStream(&this->toc.tracks[this->index].f);
 		FileReadAdv(&this->toc.tracks[this->index].f, buf, this->audioLength);
 	}
 
@@ -62,6 +62,7 @@ static struct
 	char base_dir[1024];
 
 	FILE *wav_fp;
+	int wav_stream;
 	uint32_t wav_data_start;
 	uint32_t wav_data_size;
 	uint32_t wav_position;
@@ -160,17 +161,15 @@ static void parse_cue(const char *cue_path)
 	fclose(f);
 }
 
+static void close_wav();
+
 // Open a WAV and locate the "data" chunk (handles non-standard headers)
 static int open_wav(int track)
 {
 	if (track < 1 || track > mdp.num_tracks) return 0;
 	if (!mdp.tracks[track].wav_path[0]) return 0;
 
-	if (mdp.wav_fp)
-	{
-		fclose(mdp.wav_fp);
-		mdp.wav_fp = NULL;
-	}
+	close_wav();
 
 	mdp.wav_fp = fopen(mdp.tracks[track].wav_path, "rb");
 	if (!mdp.wav_fp) return 0;
@@ -194,6 +193,7 @@ static int open_wav(int track)
 			mdp.wav_data_start = pos;
 			mdp.wav_data_size = chunk_size;
 			mdp.wav_position = 0;
+			mdp.wav_stream = FileStreamStart(fileno(mdp.wav_fp));
 			return 1;
 		}
 
@@ -208,6 +208,12 @@ static int open_wav(int track)
 
 static void close_wav()
 {
+	if (mdp.wav_stream)
+	{
+		FileStreamStop(mdp.wav_stream);
+		mdp.wav_stream = 0;
+	}
+
 	if (mdp.wav_fp)
 	{
 		fclose(mdp.wav_fp);
@@ -256,6 +262,7 @@ static void stream_audio(uint16_t rd_ptr)
 
 	size_t got = fread(staging, 1, to_write, mdp.wav_fp);
 	if (got == 0) return;
+	FileStreamRead(mdp.wav_stream, mdp.wav_data_start + mdp.wav_position, got);
 	got &= ~3u;
 
 	// Copy to ring buffer, handling wrap-around
@@ -415,6 +422,7 @@ void mdplus_poll()
 				if (chunk > STREAM_CHUNK) chunk = STREAM_CHUNK;
 				size_t got = fread(staging, 1, chunk, mdp.wav_fp);
 				if (got == 0) break;
+				FileStreamRead(mdp.wav_stream, mdp.wav_data_start + filled, got);
 				got &= ~3u;
 				memcpy((void *)(mdp.ddram + filled), staging, got);
 				filled += got;
@@ -5,8 +5,10 @@
 // the per-pass work: draining the register doorbell and moving received frames
 // into the Amiga's ring.
 //
-// Everything here runs in Main's single thread, driven by a2065_poll() from
-// the poll loop. Nothing blocks and nothing is unbounded.
+// The per-pass work runs on a dedicated network thread pinned to core #0, so
+// ping latency and throughput no longer depend on how often Main's loop gets
+// round to it. Main only starts, stops and reconfigures the card; net_lock
+// serialises those against the thread.
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -15,6 +17,11 @@
 #include <stdint.h>
 #include <time.h>
 #include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
 
 #include "../../shmem.h"
 #include "../../user_io.h"
@@ -41,9 +48,12 @@ extern void gotfunc(const uint8_t *data, int len);
 extern int  rings_rx_has_space(void);
 extern void mac_set_addresses(const uint8_t *fake, const uint8_t *real);
 extern int  ethernet_open(const char *iface, int promiscuous);
+extern int  ethernet_get_fd(void);
 extern void ethernet_close(void);
 extern int  ethernet_recv(uint8_t *buf, int maxlen);
 extern int  ethernet_recv_nb(uint8_t *buf, int maxlen);
+extern int  ethernet_recv_batch(int (*deliver)(const uint8_t *data, int len), int max);
+extern void ethernet_flush(void);
 extern void ethernet_get_mac(uint8_t *mac_out);
 extern int  ethernet_read_iface_mac(const char *iface, uint8_t *out);
 extern int  ethernet_set_mac_filter(const uint8_t *mac);
@@ -230,9 +240,17 @@ static void on_interrupt_cb(void)
 	update_int_state();
 }
 
+// A TDMD doorbell sends every frame the Amiga has queued in the TX ring, as
+// the LANCE's own ring polling would, rather than one frame per doorbell. The
+// frames go out together with one sendmmsg().
+#define TX_BATCH_MAX 32
+
 static int on_transmit_cb(void)
 {
-	int r = do_transmit();
+	int r = 0;
+	for (int i = 0; i < TX_BATCH_MAX && do_transmit(); i++) r = 1;
+	ethernet_flush();
+
 	push_csr_shadow();
 	update_int_state();
 	return r;
@@ -240,41 +258,47 @@ static int on_transmit_cb(void)
 
 // Move whatever the socket already has into the Amiga's receive ring.
 //
-// Non-blocking, and bounded: this runs from Main's poll loop, which is
-// single-threaded and also services the core, the UI and input, so it must
-// hand control back promptly rather than sit on the socket. Anything left
-// over stays in the kernel's buffer and is picked up next time round.
+// Non-blocking, and bounded so a flood of frames cannot hold off a register
+// doorbell for long. Anything left over stays in the kernel's buffer and is
+// picked up on the next pass.
 //
 // Frames are taken in a batch with the per-frame interrupt suppressed, and
 // one INT2 raised at the end: a server's TSO pair then lands together and the
 // Amiga acknowledges it immediately instead of arming its delayed-ACK timer.
 #define RX_BATCH_MAX 64
 
-static void a2065_drain_rx(void)
+static int rx_loop = 0;
+
+// Called for each received frame, straight from the socket's mmap ring when
+// it is available. Returning 0 leaves the frame with the socket.
+static int deliver_rx(const uint8_t *data, int len)
 {
-	static uint8_t rxbuf[MAX_PACKET_SIZE];
-	int taken = 0;
+	// Internal loopback disconnects the LANCE from the wire on real hardware.
+	// gotfunc skips its destination filter in that mode, so live segment
+	// traffic would otherwise flood the ring and turn RXON off, failing the
+	// internal-loopback diagnostic.
+	if (rx_loop) return 1;
 
 	// Backpressure: with no free descriptor, leave the frames in the kernel
 	// buffer rather than overrunning the ring. Overruns used to clear RXON via
 	// RX_OFLO and cascade into a stall; letting the buffer hold the burst is
 	// the same zero-window flow control that made eth1 work.
-	if (!rings_rx_has_space()) return;
+	if (!rings_rx_has_space()) return 0;
 
-	// Internal loopback disconnects the LANCE from the wire on real hardware.
-	// gotfunc skips its destination filter in that mode, so live segment
-	// traffic would otherwise flood the ring and turn RXON off, failing the
-	// internal-loopback diagnostic.
-	int loop = (registers_mode() & MODE_LOOP) != 0;
+	// gotfunc appends the FCS to its copy of the frame.
+	if (len > MAX_PACKET_SIZE - 4) len = MAX_PACKET_SIZE - 4;
+	gotfunc(data, len);
+	return 1;
+}
+
+static int a2065_drain_rx(void)
+{
+	// in loopback the frames are discarded, so they are drained even with the ring full
+	rx_loop = (registers_mode() & MODE_LOOP) != 0;
+	if (!rx_loop && !rings_rx_has_space()) return 0;
 
 	rx_batching = 1;
-	while (taken < RX_BATCH_MAX && (loop || rings_rx_has_space()))
-	{
-		int len = ethernet_recv_nb(rxbuf, sizeof rxbuf);
-		if (len <= 0) break;          // socket empty (0) or error (-1)
-		if (!loop) gotfunc(rxbuf, len);
-		taken++;
-	}
+	int taken = ethernet_recv_batch(deliver_rx, RX_BATCH_MAX);
 	rx_batching = 0;
 
 	if (taken)
@@ -282,6 +306,8 @@ static void a2065_drain_rx(void)
 		push_csr_shadow();
 		update_int_state();
 	}
+
+	return taken;
 }
 
 static void write_mbx_mac(const uint8_t *fakemac)
@@ -409,9 +435,7 @@ static int a2065_setup_iface(const char *iface, const char *parent, int mode)
 }
 
 // Bring the card up: map the mailbox, configure the interface, open the socket.
-// Runs to completion in the caller's context — there is no thread here. Main is
-// single-threaded by design, and a background thread would compete with it for
-// the one CPU it has, adding input lag or making it miss core requests.
+// Runs to completion in the caller's context, before the network thread starts.
 static int a2065_open(void)
 {
 	int sel = a2065_get_iface();
@@ -466,18 +490,19 @@ static int a2065_open(void)
 	return 1;
 }
 
-// One pass of the card's work, called from Main's poll loop.
+// One pass of the card's work. Called with net_lock held.
 //
 // Two jobs: drain any register write the Amiga has posted through the doorbell,
 // and move received frames into its ring. Both are bounded and non-blocking, so
-// the cost per call stays small and predictable.
+// the cost per call stays small and predictable. Returns non-zero if there was
+// anything to do.
 //
 // A register write is DTACK-stretched by the FPGA until the doorbell is
 // drained, so the Amiga is held off for as long as it takes to get back here.
 // That is the reason this must not sit behind anything slow.
-void a2065_poll(void)
+static int a2065_service(void)
 {
-	if (!card_up) return;
+	int work = 0;
 
 	uint64_t cmd = rd64(DDR3_CMD_OFF);
 	if (cmd & DDR3_CMD_PENDING_BIT)
@@ -485,6 +510,7 @@ void a2065_poll(void)
 		uint8_t  rap_v = (cmd >> DDR3_CMD_RAP_SHIFT) & DDR3_CMD_RAP_MASK;
 		uint16_t data  = (cmd >> DDR3_CMD_DATA_SHIFT) & DDR3_CMD_DATA_MASK;
 
+		work = 1;
 		chip_wput(A2065_RAP_OFF, rap_v);
 		chip_wput(A2065_RDP_OFF, data);
 
@@ -518,13 +544,165 @@ void a2065_poll(void)
 		}
 	}
 
-	a2065_drain_rx();
+	if (a2065_drain_rx()) work = 1;
+	return work;
+}
+
+// Network thread.
+//
+// The doorbell is a word in DDR3 with no interrupt behind it, so it has to be
+// polled. After any activity the thread keeps spinning on it for NET_SPIN_US,
+// which covers the register-write bursts of a driver setting up the LANCE or
+// acknowledging interrupts. Once idle it sleeps in epoll on the socket, woken
+// by a frame or by a timer tick that starts at NET_TICK_MIN_US and backs off
+// to NET_TICK_MAX_US, so an idle card costs next to nothing on core #0.
+#define NET_SPIN_US     500
+#define NET_TICK_MIN_US 20
+#define NET_TICK_MAX_US 1000
+
+static pthread_t net_thread;
+static pthread_mutex_t net_lock = PTHREAD_MUTEX_INITIALIZER;
+static int net_running = 0;
+static volatile int net_quit = 0;
+static int net_stop_fd = -1;
+
+static uint64_t net_now_us(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void *net_thread_func(void *)
+{
+	int ep = epoll_create1(EPOLL_CLOEXEC);
+	int tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	int sfd = ethernet_get_fd();
+
+	struct epoll_event ev = {};
+	ev.events = EPOLLIN;
+	ev.data.fd = net_stop_fd;
+	epoll_ctl(ep, EPOLL_CTL_ADD, net_stop_fd, &ev);
+	ev.data.fd = tfd;
+	epoll_ctl(ep, EPOLL_CTL_ADD, tfd, &ev);
+
+	// Edge-triggered: with the Amiga's ring full the socket stays readable, and
+	// a level-triggered wait would spin on it. Every wake runs a full pass, and
+	// a pass that found work is always followed by another, so nothing is left
+	// behind by an edge.
+	if (sfd >= 0)
+	{
+		ev.events = EPOLLIN | EPOLLET;
+		ev.data.fd = sfd;
+		epoll_ctl(ep, EPOLL_CTL_ADD, sfd, &ev);
+	}
+
+	uint64_t last_work = net_now_us();
+	int tick = 0;
+
+	while (!net_quit)
+	{
+		pthread_mutex_lock(&net_lock);
+		int work = a2065_service();
+		pthread_mutex_unlock(&net_lock);
+
+		if (work)
+		{
+			last_work = net_now_us();
+			tick = 0;
+			continue;
+		}
+
+		if (net_now_us() - last_work < NET_SPIN_US) continue;
+
+		tick = tick ? tick * 2 : NET_TICK_MIN_US;
+		if (tick > NET_TICK_MAX_US) tick = NET_TICK_MAX_US;
+
+		struct itimerspec its = {};
+		its.it_value.tv_nsec = tick * 1000;
+		timerfd_settime(tfd, 0, &its, NULL);
+
+		struct epoll_event evs[3];
+		int n = epoll_wait(ep, evs, 3, -1);
+		for (int i = 0; i < n; i++)
+		{
+			if (evs[i].data.fd == tfd)
+			{
+				uint64_t exp;
+				if (read(tfd, &exp, sizeof(exp)) < 0) {}
+			}
+			else if (evs[i].data.fd == sfd)
+			{
+				// Traffic: poll the doorbell closely again, the Amiga is
+				// about to answer.
+				last_work = net_now_us();
+				tick = 0;
+			}
+		}
+	}
+
+	close(tfd);
+	close(ep);
+	return NULL;
+}
+
+static void net_thread_start(void)
+{
+	net_quit = 0;
+	net_stop_fd = eventfd(0, EFD_CLOEXEC);
+
+	pthread_attr_t attr;
+	pthread_attr_init(&attr);
+
+	// Stay off core #1, where Main runs.
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(0, &set);
+	pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+
+	if (net_stop_fd >= 0 && !pthread_create(&net_thread, &attr, net_thread_func, NULL))
+	{
+		net_running = 1;
+	}
+	else
+	{
+		// Fall back to servicing the card from Main's poll loop.
+		printf("A2065: cannot start network thread, polling from main loop\n");
+		if (net_stop_fd >= 0) close(net_stop_fd);
+		net_stop_fd = -1;
+	}
+
+	pthread_attr_destroy(&attr);
+}
+
+static void net_thread_stop(void)
+{
+	if (!net_running) return;
+
+	net_quit = 1;
+	uint64_t one = 1;
+	if (write(net_stop_fd, &one, sizeof(one)) < 0) {}
+	pthread_join(net_thread, NULL);
+
+	close(net_stop_fd);
+	net_stop_fd = -1;
+	net_running = 0;
+}
+
+// Called from Main's poll loop. The network thread does the work; this only
+// stands in for it if the thread could not be started.
+void a2065_poll(void)
+{
+	if (!card_up || net_running) return;
+	a2065_service();
 }
 
 void a2065_stop(void)
 {
 	if (!card_up) return;
 
+	net_thread_stop();
+
 	card_up = 0;
 	wr64(DDR3_INT_OFF, 0);
 	ethernet_close();
@@ -555,23 +733,32 @@ void a2065_start(void)
 		}
 	}
 
-	wr64(DDR3_CMD_OFF, 0);
-	wr64(DDR3_CSR_OFF, 0);
-	wr64(DDR3_INT_OFF, 0);
-
 	// Already up: this is a Minimig reset, so put the LANCE back to its
 	// power-on state rather than tearing the interface down and back up.
 	if (card_up)
 	{
+		pthread_mutex_lock(&net_lock);
+		wr64(DDR3_CMD_OFF, 0);
+		wr64(DDR3_CSR_OFF, 0);
+		wr64(DDR3_INT_OFF, 0);
 		registers_reset();
 		push_csr_shadow();
 		update_int_state();
+		pthread_mutex_unlock(&net_lock);
 		return;
 	}
 
+	wr64(DDR3_CMD_OFF, 0);
+	wr64(DDR3_CSR_OFF, 0);
+	wr64(DDR3_INT_OFF, 0);
+
 	if (a2065_get_iface() == A2065_OFF) return;
 
-	if (a2065_open()) card_up = 1;
+	if (a2065_open())
+	{
+		card_up = 1;
+		net_thread_start();
+	}
 	else a2065_stop();
 }
 
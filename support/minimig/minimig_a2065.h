@@ -6,13 +6,13 @@
 // The FPGA side implements ZorroII autoconfig, the boardram window and the
 // LANCE CSR register file; this module is the host half — the AMD Am7990
 // LANCE controller state machine, the TX/RX descriptor ring walker and the
-// bridge to a host network interface. It runs in Main's single thread, driven
-// by a2065_poll() from the poll loop, and is started when the Minimig core
-// boots and stopped when it unloads.
+// bridge to a host network interface. It runs on its own network thread,
+// pinned away from Main, and is started when the Minimig core boots and
+// stopped when it unloads.
 //
 // FPGA <-> host communication is a DDR3 shared-memory mailbox: register
-// writes raise a doorbell in a DDR3 CMD slot that a2065_poll() drains, and CSR
-// reads are served from a DDR3 shadow it keeps up to date.
+// writes raise a doorbell in a DDR3 CMD slot that the network thread drains,
+// and CSR reads are served from a DDR3 shadow it keeps up to date.
 
 // Interface selection, shown on the Minimig "System" OSD page.
 //
@@ -60,9 +60,9 @@ void a2065_cfg_load(int num);
 void a2065_start(void);
 void a2065_stop(void);
 
-// One pass of the card's work — drain the register doorbell and move any
-// received frames into the Amiga's ring. Bounded and non-blocking; call it
-// from the poll loop. Does nothing when the card is off.
+// Call from the poll loop. The network thread services the card; this only
+// does a pass itself if that thread could not be started. Does nothing when
+// the card is off.
 void a2065_poll(void);
 
 #endif
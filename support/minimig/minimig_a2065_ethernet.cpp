@@ -27,15 +27,92 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <poll.h>
+#include <sys/mman.h>
 
 static int sock_fd = -1;
 static int is_tap = 0;
 static uint8_t host_mac[6];
 
+/* TPACKET_V3 receive ring. The kernel fills whole blocks of frames in the
+ * mmapped area and hands each block over with one status flip, so a burst is
+ * consumed straight from shared memory with no syscall per frame. A block is
+ * retired after RX_RING_TOV ms even when not full, which bounds the added
+ * latency for a lone frame (ping). */
+#define RX_RING_BLOCK_SIZE (64 * 1024)
+#define RX_RING_BLOCK_NR   64          /* 4MB, same budget as the socket rcvbuf */
+#define RX_RING_FRAME_SIZE 2048
+#define RX_RING_TOV        1
+
+static uint8_t *rx_ring = NULL;
+static size_t   rx_ring_size = 0;
+static int      rx_block = 0;
+static struct tpacket3_hdr *rx_pkt = NULL;
+static uint32_t rx_pkt_left = 0;
+
+/* Frame read by the non-ring path that the consumer refused (ring full). */
+static uint8_t  rx_held[MAX_PACKET_SIZE];
+static int      rx_held_len = 0;
+
+/* Transmit queue, flushed with one sendmmsg() per batch. */
+#define TX_QUEUE_LEN 16
+
+static uint8_t  tx_queue[TX_QUEUE_LEN][MAX_PACKET_SIZE];
+static int      tx_queue_len[TX_QUEUE_LEN];
+static int      tx_queued = 0;
+
+static int setup_rx_ring(void)
+{
+    int ver = TPACKET_V3;
+    if (setsockopt(sock_fd, SOL_PACKET, PACKET_VERSION, &ver, sizeof ver) < 0) {
+        perror("[a2065] PACKET_VERSION");
+        return 0;
+    }
+
+    struct tpacket_req3 req;
+    memset(&req, 0, sizeof req);
+    req.tp_block_size = RX_RING_BLOCK_SIZE;
+    req.tp_block_nr = RX_RING_BLOCK_NR;
+    req.tp_frame_size = RX_RING_FRAME_SIZE;
+    req.tp_frame_nr = (RX_RING_BLOCK_SIZE / RX_RING_FRAME_SIZE) * RX_RING_BLOCK_NR;
+    req.tp_retire_blk_tov = RX_RING_TOV;
+
+    if (setsockopt(sock_fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof req) < 0) {
+        perror("[a2065] PACKET_RX_RING");
+        return 0;
+    }
+
+    rx_ring_size = (size_t)req.tp_block_size * req.tp_block_nr;
+    void *ring = mmap(NULL, rx_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED, sock_fd, 0);
+    if (ring == MAP_FAILED) {
+        perror("[a2065] mmap rx ring");
+        rx_ring_size = 0;
+        return 0;
+    }
+
+    rx_ring = (uint8_t *)ring;
+    rx_block = 0;
+    rx_pkt = NULL;
+    rx_pkt_left = 0;
+    LOG("[a2065] RX ring: %d x %d bytes\n", RX_RING_BLOCK_NR, RX_RING_BLOCK_SIZE);
+    return 1;
+}
+
+static void close_rx_ring(void)
+{
+    if (rx_ring) munmap(rx_ring, rx_ring_size);
+    rx_ring = NULL;
+    rx_ring_size = 0;
+    rx_pkt = NULL;
+    rx_pkt_left = 0;
+}
+
 void ethernet_iface_up(const char *iface);  /* forward decl for open_tap */
 
 int ethernet_is_tap(void) { return is_tap; }
 
+/* Socket (or tap) descriptor, for the network thread's epoll set. -1 if closed. */
+int ethernet_get_fd(void) { return sock_fd; }
+
 static int open_tap(const char *iface)
 {
     int fd = open("/dev/net/tun", O_RDWR | O_CLOEXEC);
@@ -51,6 +128,10 @@ static int open_tap(const char *iface)
         return 0;
     }
 
+    /* Non-blocking, so a drain is plain read() calls until EAGAIN with no
+     * poll() in front of each one. */
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
     sock_fd = fd;
     is_tap = 1;
 
@@ -120,6 +201,11 @@ int ethernet_open(const char *iface, int promiscuous)
         }
     }
 
+    /* The ring has to be configured before bind() starts queueing frames;
+     * without it the socket falls back to one recv() per frame. */
+    if (!setup_rx_ring())
+        LOG("[a2065] RX ring unavailable, using recv()\n");
+
     memset(&addr, 0, sizeof addr);
     addr.sll_family   = AF_PACKET;
     addr.sll_protocol = htons(ETH_P_ALL);
@@ -175,15 +261,57 @@ void ethernet_packet_stats(unsigned long *packets, unsigned long *drops)
 
 void ethernet_close(void)
 {
+    tx_queued = 0;
+    rx_held_len = 0;
+    close_rx_ring();
     if (sock_fd >= 0) { close(sock_fd); sock_fd = -1; }
 }
 
+/* Send every queued frame: one sendmmsg() for the raw socket, one write()
+ * per frame for tap (a tap fd takes exactly one frame per write). */
+void ethernet_flush(void)
+{
+    if (!tx_queued) return;
+    if (sock_fd < 0) { tx_queued = 0; return; }
+
+    if (is_tap) {
+        for (int i = 0; i < tx_queued; i++)
+            if (write(sock_fd, tx_queue[i], (size_t)tx_queue_len[i]) < 0 && errno != EAGAIN)
+                perror("[a2065] tap send");
+        tx_queued = 0;
+        return;
+    }
+
+    struct mmsghdr msgs[TX_QUEUE_LEN];
+    struct iovec iov[TX_QUEUE_LEN];
+    memset(msgs, 0, sizeof msgs);
+    for (int i = 0; i < tx_queued; i++) {
+        iov[i].iov_base = tx_queue[i];
+        iov[i].iov_len = (size_t)tx_queue_len[i];
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    int done = 0;
+    while (done < tx_queued) {
+        int n = sendmmsg(sock_fd, msgs + done, (unsigned)(tx_queued - done), 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("[a2065] sendmmsg");
+            break;
+        }
+        done += n;
+    }
+    tx_queued = 0;
+}
+
 void ethernet_send(const uint8_t *frame, int len)
 {
     if (sock_fd < 0 || len <= 0) return;
-    ssize_t sent = is_tap ? write(sock_fd, frame, (size_t)len)
-                          : send(sock_fd, frame, (size_t)len, 0);
-    if (sent < 0) perror("[a2065] send");
+    if (len > MAX_PACKET_SIZE) len = MAX_PACKET_SIZE;
+    if (tx_queued == TX_QUEUE_LEN) ethernet_flush();
+    memcpy(tx_queue[tx_queued], frame, (size_t)len);
+    tx_queue_len[tx_queued++] = len;
 }
 
 int ethernet_recv(uint8_t *buf, int maxlen)
@@ -206,11 +334,12 @@ int ethernet_recv_nb(uint8_t *buf, int maxlen)
 {
     if (sock_fd < 0) return -1;
     if (is_tap) {
-        struct pollfd pfd = { sock_fd, POLLIN, 0 };
-        int pr = poll(&pfd, 1, 0);
-        if (pr <= 0) return 0;
         ssize_t n = read(sock_fd, buf, (size_t)maxlen);
-        if (n < 0) { if (errno != EINTR) perror("[a2065] tap recv_nb"); return -1; }
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+            if (errno != EINTR) perror("[a2065] tap recv_nb");
+            return -1;
+        }
         return (int)n;
     }
     ssize_t n = recv(sock_fd, buf, (size_t)maxlen, MSG_DONTWAIT);
@@ -222,6 +351,58 @@ int ethernet_recv_nb(uint8_t *buf, int maxlen)
     return (int)n;
 }
 
+/* Hand up to max received frames to deliver(), which returns 0 to refuse a
+ * frame (Amiga ring full); a refused frame stays queued for the next call.
+ * With the mmap ring, frames are passed straight out of the shared block and
+ * a block goes back to the kernel once all its frames are consumed. Returns
+ * the number of frames consumed. */
+int ethernet_recv_batch(int (*deliver)(const uint8_t *data, int len), int max)
+{
+    int taken = 0;
+    if (sock_fd < 0) return 0;
+
+    if (!rx_ring) {
+        while (taken < max) {
+            if (!rx_held_len) {
+                int len = ethernet_recv_nb(rx_held, sizeof rx_held);
+                if (len <= 0) break;
+                rx_held_len = len;
+            }
+            if (!deliver(rx_held, rx_held_len)) break;
+            rx_held_len = 0;
+            taken++;
+        }
+        return taken;
+    }
+
+    while (taken < max) {
+        struct tpacket_block_desc *bd =
+            (struct tpacket_block_desc *)(rx_ring + (size_t)rx_block * RX_RING_BLOCK_SIZE);
+
+        if (!rx_pkt) {
+            if (!(bd->hdr.bh1.block_status & TP_STATUS_USER)) break;
+            __sync_synchronize();
+            rx_pkt = (struct tpacket3_hdr *)((uint8_t *)bd + bd->hdr.bh1.offset_to_first_pkt);
+            rx_pkt_left = bd->hdr.bh1.num_pkts;
+        }
+
+        if (rx_pkt_left) {
+            if (!deliver((const uint8_t *)rx_pkt + rx_pkt->tp_mac, (int)rx_pkt->tp_snaplen)) break;
+            taken++;
+            if (--rx_pkt_left)
+                rx_pkt = (struct tpacket3_hdr *)((uint8_t *)rx_pkt + rx_pkt->tp_next_offset);
+        }
+
+        if (!rx_pkt_left) {
+            __sync_synchronize();
+            bd->hdr.bh1.block_status = TP_STATUS_KERNEL;
+            rx_block = (rx_block + 1) % RX_RING_BLOCK_NR;
+            rx_pkt = NULL;
+        }
+    }
+    return taken;
+}
+
 void ethernet_get_mac(uint8_t *mac_out)
 {
     memcpy(mac_out, host_mac, 6);
@@ -478,6 +659,8 @@ void ethernet_dhcpcd_deny(const char *iface)
 
 int ethernet_is_tap(void) { return 0; }
 
+int ethernet_get_fd(void) { return -1; }
+
 int ethernet_open(const char *iface, int promiscuous)
 {
     (void)iface; (void)promiscuous;
@@ -504,6 +687,14 @@ int ethernet_recv_nb(uint8_t *buf, int maxlen)
     return 0;
 }
 
+int ethernet_recv_batch(int (*deliver)(const uint8_t *data, int len), int max)
+{
+    (void)deliver; (void)max;
+    return 0;
+}
+
+void ethernet_flush(void) {}
+
 void ethernet_get_mac(uint8_t *mac_out)
 {
     memset(mac_out, 0, 6);
@@ -8,6 +8,7 @@
 #include "minimig_a2065_types.h"
 #include "minimig_a2065_debug.h"
 #include "minimig_a2065_boardram.h"
+#include "../../crc32.h"
 #include <stdint.h>
 #include <string.h>
 #include <stdio.h>
@@ -15,7 +16,6 @@
 /* External references — resolved at link time */
 extern volatile uint8_t *boardram;
 extern int mungepacket(uint8_t *packet, int len);
-extern uint32_t crc32_compute(const uint8_t *data, int len);
 extern void ethernet_send(const uint8_t *frame, int len);
 
 /* Register accessors from registers.cpp */
@@ -280,7 +280,7 @@ void gotfunc(const uint8_t *databuf, int len)
              * ND/MLD traffic the Amiga never asked for. PROM mode bypasses. */
             if (!registers_prom() &&
                 memcmp(dstmac, BROADCAST_MAC, 6) != 0) {
-                uint32_t hash = (~crc32_compute(dstmac, 6)) >> 26;
+                uint32_t hash = (~crc32_update(0, dstmac, 6)) >> 26;
                 if (!(registers_ladrf() & (1ULL << hash)))
                     return;
             }
@@ -303,7 +303,7 @@ void gotfunc(const uint8_t *databuf, int len)
             memcmp(srcmac, fakemac_buf, 6) == 0) return;
     }
 
-    uint32_t crc = crc32_compute(d, len);
+    uint32_t crc = crc32_update(0, d, len);
     d[len++] = (uint8_t)(crc >> 24);
     d[len++] = (uint8_t)(crc >> 16);
     d[len++] = (uint8_t)(crc >>  8);
@@ -14,6 +14,7 @@
 #include "../../osd.h"
 #include "../../shmem.h"
 #include "../../lib/md5/md5.h"
+#include "../../crc32.h"
 
 #include "miniz.h"
 #include "n64.h"
@@ -2856,7 +2857,7 @@ int n64_rom_tx(const char* name, const unsigned char idx, const uint32_t load_ad
 
 		// CRC32 is used for cheat look-up. Cheat files from gamehacking.org use byte swapped CRC32 for some reason...
 		normalize_data(buf, chunk, ByteOrder::BYTE_SWAPPED);
-		file_crc = crc32(file_crc, buf, chunk);
+		file_crc = crc32_update(file_crc, buf, chunk);
 	}
 
 	MD5Final(md5, &ctx);
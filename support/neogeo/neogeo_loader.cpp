@@ -528,16 +528,11 @@ static void parse_xml(const char* filename, const SAX_Callbacks* sax, void* user
 	fileTYPE f = {};
 	if(FileOpen(&f, filename) && f.size)
 	{
-		void *buf = malloc(f.size+1); // plus null;
+		void *buf = malloc(f.size);
 		if (buf)
 		{
 			int size = FileReadAdv(&f, buf, f.size);
-			if (size)
-			{
-				char *bufc = (char*)buf;
-				bufc[size] = 0;
-				XMLDoc_parse_buffer_SAX(bufc, filename, sax, user);
-			}
+			if (size) XMLDoc_parse_buffer_SAX_insitu((char*)buf, size, filename, sax, user);
 			free(buf);
 		}
 	}
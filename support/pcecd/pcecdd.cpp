@@ -43,43 +43,10 @@ pcecdd_t::pcecdd_t() {
 
 }
 
-static int sgets(char *out, int sz, char **in)
-{
-	*out = 0;
-	do
-	{
-		char *instr = *in;
-		int cnt = 0;
-
-		while (*instr && *instr != 10)
-		{
-			if (*instr == 13)
-			{
-				instr++;
-				continue;
-			}
-
-			if (cnt < sz - 1)
-			{
-				out[cnt++] = *instr;
-				out[cnt] = 0;
-			}
-
-			instr++;
-		}
-
-		if(*instr == 10) instr++;
-		*in = instr;
-	}
-	while (!*out && **in);
-
-	return *out;
-}
-
 int pcecdd_t::LoadCUE(const char* filename) {
 	static char fname[1024 + 10];
 	static char line[128];
-	char *ptr, *lptr;
+	char *lptr;
 	static char toc[100 * 1024];
 	int hdr = 0;
 
@@ -93,7 +60,7 @@ int pcecdd_t::LoadCUE(const char* filename) {
 	int mm, ss, bb, pregap = 0;
 
 	char *buf = toc;
-	while (sgets(line, sizeof(line), &buf))
+	while (cd_sgets(line, sizeof(line), &buf))
 	{
 		lptr = line;
 		while (*lptr == 0x20) lptr++;
@@ -101,25 +68,7 @@ int pcecdd_t::LoadCUE(const char* filename) {
 		/* decode FILE commands */
 		if (!(memcmp(lptr, "FILE", 4)))
 		{
-			ptr = fname + strlen(fname) - 1;
-			while ((ptr - fname) && (*ptr != '/') && (*ptr != '\\')) ptr--;
-			if (ptr - fname) ptr++;
-
-			lptr += 4;
-			while (*lptr == 0x20) lptr++;
-
-			if (*lptr == '\"')
-			{
-				lptr++;
-				while ((*lptr != '\"') && (lptr <= (line + 128)) && (ptr < (fname + 1023)))
-					*ptr++ = *lptr++;
-			}
-			else
-			{
-				while ((*lptr != 0x20) && (lptr <= (line + 128)) && (ptr < (fname + 1023)))
-					*ptr++ = *lptr++;
-			}
-			*ptr = 0;
+			lptr = cd_cue_file(fname, 1024, lptr + 4);
 
 			if(!FileOpen(&this->toc.tracks[this->toc.last].f, fname)) return -1;
 
@@ -909,23 +858,12 @@ void pcecdd_t::ReadData(uint8_t *buf)
 {
 	if (this->toc.tracks[this->index].type && (this->lba >= 0))
 	{
+		int sector_size = (this->toc.tracks[this->index].sector_size == 2048) ? 2048 : 2352;
 		if (this->toc.chd_f)
 		{
-			int s_offset = 0;
-			if (this->toc.tracks[this->index].sector_size != 2048)
-			{
-				s_offset += 16;
-			}
-
-			mister_chd_read_sector(this->toc.chd_f, this->lba + this->toc.tracks[this->index].offset, 0, s_offset, 2048, buf, this->chd_hunkbuf, &this->chd_hunknum);
+			mister_chd_read_sectors(this->toc.chd_f, this->lba + this->toc.tracks[this->index].offset, 1, sector_size, CD_FMT_MODE1, buf, this->chd_hunkbuf, &this->chd_hunknum);
 		} else {
-			if (this->toc.tracks[this->index].sector_size == 2048)
-			{
-				FileSeek(&this->toc.tracks[this->index].f, this->lba * 2048 - this->toc.tracks[this->index].offset, SEEK_SET);
-			} else {
-				FileSeek(&this->toc.tracks[this->index].f, this->lba * 2352 + 16 - this->toc.tracks[this->index].offset, SEEK_SET);
-			}
-			FileReadAdv(&this->toc.tracks[this->index].f, buf, 2048);
+			cd_read_sectors(&this->toc.tracks[this->index].f, this->lba * sector_size - this->toc.tracks[this->index].offset, sector_size, 1, CD_FMT_MODE1, buf);
 		}
 	}
 }
@@ -946,6 +884,7 @@ int pcecdd_t::ReadCDDA(uint8_t *buf)
 			buf[swapidx+1] = temp;
 		}
 	} else if (this->toc.tracks[this->index].f.opened()) {
+		FileSetStream(&this->toc.tracks[this->index].f);
 		FileReadAdv(&this->toc.tracks[this->index].f, buf, this->audioLength);
 	}
 
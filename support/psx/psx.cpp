@@ -20,38 +20,6 @@ static uint8_t *chd_hunkbuf = NULL;
 static int chd_hunknum;
 static int noreset = 0;
 
-static int sgets(char *out, int sz, char **in)
-{
-	*out = 0;
-	do
-	{
-		char *instr = *in;
-		int cnt = 0;
-
-		while (*instr && *instr != 10)
-		{
-			if (*instr == 13)
-			{
-				instr++;
-				continue;
-			}
-
-			if (cnt < sz - 1)
-			{
-				out[cnt++] = *instr;
-				out[cnt] = 0;
-			}
-
-			instr++;
-		}
-
-		if (*instr == 10) instr++;
-		*in = instr;
-	} while (!*out && **in);
-
-	return *out;
-}
-
 static uint32_t libCryptSectors[16] =
 {
 	14105,
@@ -165,7 +133,7 @@ static int load_cue(const char* filename, toc_t *table)
 {
 	static char fname[1024 + 10];
 	static char line[128];
-	char *ptr, *lptr;
+	char *lptr;
 	static char toc[100 * 1024];
 
 	unload_cue(table);
@@ -184,7 +152,7 @@ static int load_cue(const char* filename, toc_t *table)
 	int pregap = 0;
 
 	char *buf = toc;
-	while (sgets(line, sizeof(line), &buf))
+	while (cd_sgets(line, sizeof(line), &buf))
 	{
 		lptr = line;
 		while (*lptr == 0x20) lptr++;
@@ -192,25 +160,7 @@ static int load_cue(const char* filename, toc_t *table)
 		/* decode FILE commands */
 		if (!(memcmp(lptr, "FILE", 4)))
 		{
-			ptr = fname + strlen(fname) - 1;
-			while ((ptr - fname) && (*ptr != '/') && (*ptr != '\\')) ptr--;
-			if (ptr - fname) ptr++;
-
-			lptr += 4;
-			while (*lptr == 0x20) lptr++;
-
-			if (*lptr == '\"')
-			{
-				lptr++;
-				while ((*lptr != '\"') && (lptr <= (line + 128)) && (ptr < (fname + 1023)))
-					*ptr++ = *lptr++;
-			}
-			else
-			{
-				while ((*lptr != 0x20) && (lptr <= (line + 128)) && (ptr < (fname + 1023)))
-					*ptr++ = *lptr++;
-			}
-			*ptr = 0;
+			lptr = cd_cue_file(fname, 1024, lptr + 4);
 
 			if (!FileOpen(&table->tracks[table->last].f, fname)) return 0;
 
@@ -471,86 +421,91 @@ int psx_chd_hunksize()
 }
 
 
+// Track holding lba: the first one whose [start, end] range contains it.
+// Reads are mostly sequential, so the previous hit and the track after it
+// are tried before walking the whole table.
+static int track_hint = 0;
+
+static int psx_find_track(int lba)
+{
+	for (int i = track_hint; i < toc.last && i <= track_hint + 1; i++)
+	{
+		if (lba >= toc.tracks[i].start && lba <= toc.tracks[i].end && (!i || lba > toc.tracks[i - 1].end)) return track_hint = i;
+	}
+
+	for (int i = 0; i < toc.last; i++)
+	{
+		if (lba >= toc.tracks[i].start && lba <= toc.tracks[i].end) return track_hint = i;
+	}
+
+	return -1;
+}
+
 void psx_read_cd(uint8_t *buffer, int lba, int cnt)
 {
 	//printf("req lba=%d, cnt=%d\n", lba, cnt);
 
 	while (cnt > 0)
 	{
+		int i = -1;
+		int run = 1;
+
 		if (lba < toc.tracks[0].start || !toc.last)
 		{
 			memset(buffer, 0, CD_SECTOR_LEN);
 		}
-		else
+		else if ((i = psx_find_track(lba)) < 0)
 		{
 			memset(buffer, 0xAA, CD_SECTOR_LEN);
-			for (int i = 0; i < toc.last; i++)
+		}
+		else
+		{
+			cd_track_t *track = &toc.tracks[i];
+
+			// the rest of the request within this track, its end sector included
+			run = track->end - lba + 1;
+			if (run > cnt) run = cnt;
+
+			//The TOC is setup so that pregap sectors are actually part of the
+			//PREVIOUS track. If the pregap field is set the file doesn't contain
+			//this data, so we have to fake it.
+			//Check the next track's pregap and indexes[1] values to determine
+			//if we're reading pregap sectors
+			int data = run;
+			if (toc.tracks[i + 1].pregap)
 			{
-				if (lba >= toc.tracks[i].start && lba <= toc.tracks[i].end)
-				{
-					if (!toc.chd_f)
-					{
-						if (toc.tracks[i].offset)
-            {
-							FileSeek(&toc.tracks[0].f, toc.tracks[i].offset+((lba-toc.tracks[i].start)*CD_SECTOR_LEN), SEEK_SET);
-
-            }else {
-							FileSeek(&toc.tracks[i].f, (lba - toc.tracks[i].start) * CD_SECTOR_LEN, SEEK_SET);
-            }
-					}
-					while (cnt)
-					{
-            if (toc.tracks[i+1].pregap && lba > (toc.tracks[i+1].start-toc.tracks[i+1].indexes[1]))
-            {
-              //The TOC is setup so that pregap sectors are actually part of the
-              //PREVIOUS track. If the pregap field is set the file doesn't contain
-              //this data, so we have to fake it. 
-              //Check the next track's pregap and indexes[1] values to determine
-              //if we're reading pregap sectors
-              
-
-              memset(buffer, 0x0, CD_SECTOR_LEN);
-            }
-            else if (toc.chd_f)
-						{
+				int pregap_lba = toc.tracks[i + 1].start - toc.tracks[i + 1].indexes[1];
+				if (lba + data - 1 > pregap_lba) data = (lba > pregap_lba) ? 0 : (pregap_lba - lba + 1);
+			}
 
-							// The "fake" 150 sector pregap moves all the LBAs up by 150, so adjust here to read where the core actually wants data from
-							int read_lba = lba - toc.tracks[0].indexes[1];
-							if (mister_chd_read_sector(toc.chd_f, (read_lba + toc.tracks[i].offset), 0, 0, CD_SECTOR_LEN, buffer, chd_hunkbuf, &chd_hunknum) == CHDERR_NONE)
-							{
-								if (!toc.tracks[i].type) //CHD requires byteswap of audio data
-								{
-									for (int swapidx = 0; swapidx < CD_SECTOR_LEN; swapidx += 2)
-									{
-										uint8_t temp = buffer[swapidx];
-										buffer[swapidx] = buffer[swapidx + 1];
-										buffer[swapidx + 1] = temp;
-									}
-								}
-							}
-							else {
-								printf("\x1b[32mPSX: CHD read error: %d\n\x1b[0m", lba);
-							}
-						}
-						else {
-							if (toc.tracks[i].offset)
-								FileReadAdv(&toc.tracks[0].f, buffer, CD_SECTOR_LEN);
-							else
-								FileReadAdv(&toc.tracks[i].f, buffer, CD_SECTOR_LEN);
-						}
-						if ((lba + 1) > toc.tracks[i].end) break;
-						buffer += CD_SECTOR_LEN;
-						cnt--;
-						lba++;
-					}
-					break;
+			if (data && toc.chd_f)
+			{
+				// The "fake" 150 sector pregap moves all the LBAs up by 150, so adjust here to read where the core actually wants data from
+				int read_lba = lba - toc.tracks[0].indexes[1];
+				if (mister_chd_read_sectors(toc.chd_f, read_lba + track->offset, data, CD_SECTOR_LEN, CD_FMT_RAW, buffer, chd_hunkbuf, &chd_hunknum) == CHDERR_NONE)
+				{
+					//CHD requires byteswap of audio data
+					if (!track->type) cd_swap16(buffer, data * CD_SECTOR_LEN);
+				}
+				else
+				{
+					printf("\x1b[32mPSX: CHD read error: %d\n\x1b[0m", lba);
 				}
 			}
+			else if (data)
+			{
+				// single image file: offset is the track position inside it
+				__off64_t pos = (__off64_t)(lba - track->start) * CD_SECTOR_LEN;
+				if (track->offset) cd_read_sectors(&toc.tracks[0].f, track->offset + pos, CD_SECTOR_LEN, data, CD_FMT_RAW, buffer);
+				else cd_read_sectors(&track->f, pos, CD_SECTOR_LEN, data, CD_FMT_RAW, buffer);
+			}
+
+			if (data < run) memset(buffer + data * CD_SECTOR_LEN, 0, (run - data) * CD_SECTOR_LEN);
 		}
 
-		buffer += CD_SECTOR_LEN;
-		cnt--;
-		lba++;
+		buffer += run * CD_SECTOR_LEN;
+		cnt -= run;
+		lba += run;
 	}
 }
 
@@ -46,42 +46,10 @@ satcdd_t::satcdd_t() {
 	SetChecksum(stat);
 }
 
-static int sgets(char *out, int sz, char **in)
-{
-	*out = 0;
-	do
-	{
-		char *instr = *in;
-		int cnt = 0;
-
-		while (*instr && *instr != 10)
-		{
-			if (*instr == 13)
-			{
-				instr++;
-				continue;
-			}
-
-			if (cnt < sz - 1)
-			{
-				out[cnt++] = *instr;
-				out[cnt] = 0;
-			}
-
-			instr++;
-		}
-
-		if (*instr == 10) instr++;
-		*in = instr;
-	} while (!*out && **in);
-
-	return *out;
-}
-
 int satcdd_t::LoadCUE(const char* filename) {
 	static char fname[1024 + 10];
 	static char line[128];
-	char *ptr, *lptr;
+	char *lptr;
 	static char cue[100 * 1024];
 	int new_file = 0;
 	int file_size = 0;
@@ -99,7 +67,7 @@ int satcdd_t::LoadCUE(const char* filename) {
 	int idx, mm, ss, bb, pregap = 0;
 
 	char *buf = cue;
-	while (sgets(line, sizeof(line), &buf))
+	while (cd_sgets(line, sizeof(line), &buf))
 	{
 		lptr = line;
 		while (*lptr == 0x20) lptr++;
@@ -109,25 +77,7 @@ int satcdd_t::LoadCUE(const char* filename) {
 		{
 			if (this->toc.last == 99) break;
 
-			ptr = fname + strlen(fname) - 1;
-			while ((ptr - fname) && (*ptr != '/') && (*ptr != '\\')) ptr--;
-			if (ptr - fname) ptr++;
-
-			lptr += 4;
-			while (*lptr == 0x20) lptr++;
-
-			if (*lptr == '\"')
-			{
-				lptr++;
-				while ((*lptr != '\"') && (lptr <= (line + 128)) && (ptr < (fname + 1023)))
-					*ptr++ = *lptr++;
-			}
-			else
-			{
-				while ((*lptr != 0x20) && (lptr <= (line + 128)) && (ptr < (fname + 1023)))
-					*ptr++ = *lptr++;
-			}
-			*ptr = 0;
+			lptr = cd_cue_file(fname, 1024, lptr + 4);
 
 			if (!FileOpen(&this->toc.tracks[this->toc.last + 1].f, fname)) return -1;
 			FileSeek(&this->toc.tracks[this->toc.last + 1].f, 0, SEEK_SET);
@@ -1144,14 +1094,21 @@ int satcdd_t::SetCommand(uint8_t* data) {
 	return 0;
 }
 
-void satcdd_t::MakeSecureRingData(uint8_t *buf) {
-	int i, j;
+// Security ring sectors carry the same scrambler pattern every time, so it
+// is generated at compile time and copied in.
+struct ring_data_t
+{
+	uint8_t d[2348];
+};
+
+static constexpr ring_data_t make_ring_data()
+{
+	ring_data_t ring = {};
 	uint16_t lfsr = 1;
-	uint8_t a;
-	for (i = 12; i < 2348; i++)
+	for (int i = 12; i < 2348; i++)
 	{
-		a = (i & 1) ? 0x59 : 0xa8;
-		for (j = 0; j < 8; j++)
+		uint8_t a = (i & 1) ? 0x59 : 0xa8;
+		for (int j = 0; j < 8; j++)
 		{
 			a ^= (lfsr & 1);
 			a = (a >> 1) | (a << (7));
@@ -1160,31 +1117,15 @@ void satcdd_t::MakeSecureRingData(uint8_t *buf) {
 			lfsr |= x << 15;
 			lfsr >>= 1;
 		}
-		buf[i] = a;
+		ring.d[i] = a;
 	}
+	return ring;
 }
 
-uint32_t satcdd_t::DataSectorCalcCRC(uint8_t* buf, int len)
-{
-	static uint32_t crc_tab[256];
-	for (int i = 0; i < 256; i++)
-	{
-		uint32_t c = i;
-
-		for (unsigned j = 0; j < 8; j++)
-			c = (c >> 1) ^ ((c & 0x1) ? 0xD8018001 : 0);
+static constexpr ring_data_t ring_data = make_ring_data();
 
-		crc_tab[i] = c;
-	}
-
-	uint32_t crc = 0;
-	for (int i = 0; i < len; i++)
-	{
-		crc ^= buf[i];
-		crc = (crc >> 8) ^ crc_tab[crc & 0xFF];
-	}
-
-	return crc;
+void satcdd_t::MakeSecureRingData(uint8_t *buf) {
+	memcpy(buf + 12, ring_data.d + 12, sizeof(ring_data.d) - 12);
 }
 
 void satcdd_t::ReadData(uint8_t *buf)
@@ -1194,28 +1135,14 @@ void satcdd_t::ReadData(uint8_t *buf)
 	if (this->toc.tracks[this->track].type)
 	{
 		int lba_ = this->lba >= 0 ? this->lba : 0;
+		int sector_size = (this->toc.tracks[this->track].sector_size == 2048) ? 2048 : 2352;
 		if (this->toc.chd_f)
 		{
-			int read_offset = 0;
-			if (this->toc.tracks[this->track].sector_size == 2048)
-			{
-				read_offset += 16;
-			}
-
-			mister_chd_read_sector(this->toc.chd_f, lba_ + this->toc.tracks[this->track].offset, read_offset, 0, this->toc.tracks[this->track].sector_size, buf, this->chd_hunkbuf, &this->chd_hunknum);
+			mister_chd_read_sectors(this->toc.chd_f, lba_ + this->toc.tracks[this->track].offset, 1, this->toc.tracks[this->track].sector_size, CD_FMT_RAW, buf, this->chd_hunkbuf, &this->chd_hunknum);
 		}
 		else {
-			if (this->toc.tracks[this->track].sector_size == 2048)
-			{
-				offs = (lba_ * 2048) - this->toc.tracks[this->track].offset;
-				FileSeek(&this->toc.tracks[this->track].f, offs, SEEK_SET);
-				FileReadAdv(&this->toc.tracks[this->track].f, buf + 16, 2048);
-			}
-			else {
-				offs = (lba_ * 2352) - this->toc.tracks[this->track].offset;
-				FileSeek(&this->toc.tracks[this->track].f, offs, SEEK_SET);
-				FileReadAdv(&this->toc.tracks[this->track].f, buf, 2352);
-			}
+			offs = (lba_ * sector_size) - this->toc.tracks[this->track].offset;
+			cd_read_sectors(&this->toc.tracks[this->track].f, offs, sector_size, 1, CD_FMT_RAW, buf);
 #ifdef SATURN_DEBUG
 			//printf("\x1b[32mSaturn: ");
 			//printf("Read data, lba = %i, track = %i, offset = %i", lba_, this->track, offs);
@@ -1272,8 +1199,10 @@ int satcdd_t::DataSectorSend(uint8_t* header, int speed)
 {
 	static int buf_num_read = 0, buf_num_write = 0;
 
-	uint8_t *shmem_ptr = (uint8_t*)shmem_map(SHMEM_ADDR, 4096 * 4);
-	uint8_t *data_ptr = shmem_ptr + (buf_num_write * 4096);
+	// The sector is put together in cached memory and copied to the shared
+	// buffer in one go, the EDC would otherwise read it back from the FPGA side.
+	static uint8_t sector[2352];
+	uint8_t *data_ptr = sector;
 
 	ReadData(data_ptr);
 	if (header) {
@@ -1281,7 +1210,7 @@ int satcdd_t::DataSectorSend(uint8_t* header, int speed)
 	}
 	uint8_t sec_mode = data_ptr[15];
 
-	uint32_t crc = DataSectorCalcCRC(data_ptr, (sec_mode == 2 ? 2348 : 2064));
+	uint32_t crc = cd_edc(0, data_ptr, (sec_mode == 2 ? 2348 : 2064));
 	if (sec_mode == 0x02) {
 		/*data_ptr[2348] = crc >> 0;
 		data_ptr[2349] = crc >> 8;
@@ -1297,6 +1226,9 @@ int satcdd_t::DataSectorSend(uint8_t* header, int speed)
 	}
 
 	int boot = (data_ptr[12] == 0x00 && data_ptr[13] == 0x02 && data_ptr[14] == 0x00 && data_ptr[15] == 0x01);
+
+	uint8_t *shmem_ptr = (uint8_t*)shmem_map(SHMEM_ADDR, 4096 * 4);
+	memcpy(shmem_ptr + (buf_num_write * 4096), sector, sizeof(sector));
 	shmem_unmap(shmem_ptr, 4096 * 4);
 
 
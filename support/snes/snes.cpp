@@ -554,6 +554,7 @@ void snes_poll(void)
 			snprintf(SelectedPath, sizeof(SelectedPath), "%s-%d.pcm", snes_romFileName, data);
 			printf("MSU: New track selected: %s\n", SelectedPath);
 			FileOpen(&f_audio, SelectedPath);
+			FileSetStream(&f_audio);
 			printf(f_audio.size ? "MSU: Track mounted\n" : "MSU: Track not found!\n");
 			msu_send_command((f_audio.size << 16) | MSU_AUDIO_TRACK_MOUNTED);
 			break;
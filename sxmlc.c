@@ -39,6 +39,13 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#if !defined(SXMLC_UNICODE) && !defined(WIN32) && !defined(WIN64)
+#define SXMLC_INSITU
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 #include "sxmlc.h"
 
 /*
@@ -1220,6 +1227,7 @@ parse_err:
 	return TAG_ERROR;
 }
 
+#ifndef SXMLC_INSITU
 static int _parse_data_SAX(void* in, const DataSourceType in_type, const SAX_Callbacks* sax, SAX_Data* sd)
 {
 	SXML_CHAR *line = NULL, *txt_end, *p;
@@ -1241,6 +1249,7 @@ static int _parse_data_SAX(void* in, const DataSourceType in_type, const SAX_Cal
 	(void)XMLNode_init(&node);
 	while ((n0 = read_line_alloc(in, in_type, &line, &sz, 0, NULC, C2SX('>'), true, C2SX('\n'), &ncr)) != 0) {
 		(void)XMLNode_free(&node);
+		sd->pos = in_type == DATA_SOURCE_FILE ? ftell((FILE*)in) : ((DataSourceBuffer*)in)->cur_pos;
 		for (p = line; *p != NULC && sx_isspace(*p); p++) ; /* Checks if text is only spaces */
 		if (*p == NULC)
 			break;
@@ -1385,6 +1394,322 @@ static int _parse_data_SAX(void* in, const DataSourceType in_type, const SAX_Cal
 
 	return ret;
 }
+#endif
+
+/* --- In-situ SAX parser --- */
+
+/*
+ The in-situ parser works on a writable copy of the whole document (a private mmap of the
+ file or a caller-owned buffer). Tag names, attribute names/values and text are terminated
+ in place and handed to the callbacks as pointers into that copy, so nothing is allocated per
+ node. The only heap block is the attribute array, which lives in a per-document arena and is
+ reused by every node.
+ */
+typedef struct _SAX_Arena {
+	XMLAttribute* attributes;
+	int sz_attributes;
+} SAX_Arena;
+
+static SXML_CHAR* _sx_chr(const SXML_CHAR* p, const SXML_CHAR* end, SXML_CHAR c)
+{
+#ifndef SXMLC_UNICODE
+	return (SXML_CHAR*)memchr(p, c, end - p);
+#else
+	for (; p < end; p++)
+		if (*p == c)
+			return (SXML_CHAR*)p;
+	return NULL;
+#endif
+}
+
+static SXML_CHAR* _sx_str(const SXML_CHAR* p, const SXML_CHAR* end, const SXML_CHAR* s, int len)
+{
+	while ((p = _sx_chr(p, end, *s)) != NULL && end - p >= len) {
+		if (!sx_strncmp(p, s, len))
+			return (SXML_CHAR*)p;
+		p++;
+	}
+	return NULL;
+}
+
+static int _count_lines(const SXML_CHAR* p, const SXML_CHAR* end)
+{
+	int n = 0;
+
+	while ((p = _sx_chr(p, end, C2SX('\n'))) != NULL) {
+		n++;
+		p++;
+	}
+	return n;
+}
+
+static int _arena_add_attribute(SAX_Arena* arena, XMLNode* node, SXML_CHAR* name, SXML_CHAR* value)
+{
+	XMLAttribute* pt;
+	int sz;
+
+	if (node->n_attributes >= arena->sz_attributes) {
+		sz = arena->sz_attributes ? arena->sz_attributes * 2 : 16;
+		pt = (XMLAttribute*)__realloc(arena->attributes, sz * sizeof(XMLAttribute));
+		if (pt == NULL)
+			return false;
+		arena->attributes = pt;
+		arena->sz_attributes = sz;
+	}
+
+	node->attributes = arena->attributes;
+	node->attributes[node->n_attributes].name = name;
+	node->attributes[node->n_attributes].value = (SXML_CHAR*)html2str(value, NULL);
+	node->attributes[node->n_attributes].active = true;
+	node->n_attributes++;
+
+	return true;
+}
+
+/*
+ Parse the tag starting at 's' ('<'), terminating its parts in place and filling 'node'.
+ '*next' receives the position right after the tag.
+ Returns the tag type, 'TAG_PARTIAL' when the document ends inside the tag, 'TAG_NONE' on
+ syntax error or 'TAG_ERROR' on memory error.
+ */
+static TagType _parse_insitu_tag(SXML_CHAR* s, SXML_CHAR* end, XMLNode* node, SAX_Arena* arena, SXML_CHAR** next)
+{
+	static SXML_CHAR empty[1] = { NULC };
+	SXML_CHAR *p, *q, *name, c;
+	_TAG* t;
+	int i, tag_end;
+
+	node->tag = NULL;
+	node->attributes = NULL;
+	node->n_attributes = 0;
+
+	/* "<?", "<!--", "<![CDATA[" and user-registered tags: everything between start and end is the tag */
+	for (i = 0; i < NB_SPECIAL_TAGS + _user_tags.n_tags; i++) {
+		t = i < NB_SPECIAL_TAGS ? &_spec[i] : &_user_tags.tags[i - NB_SPECIAL_TAGS];
+		if (end - s < t->len_start || sx_strncmp(s, t->start, t->len_start))
+			continue;
+		p = _sx_str(s + t->len_start, end, t->end, t->len_end);
+		if (p == NULL)
+			return TAG_PARTIAL;
+		*p = NULC;
+		node->tag = s + t->len_start;
+		*next = p + t->len_end;
+		return node->tag_type = t->tag_type;
+	}
+
+	/* "<!DOCTYPE" ends with "]>" instead of ">" when a '[' is found inside */
+	if (end - s >= 9 && !sx_strncmp(s, C2SX("<!DOCTYPE"), 9)) {
+		p = _sx_chr(s + 9, end, C2SX('>'));
+		q = _sx_chr(s + 9, p ? p : end, C2SX('['));
+		if (q != NULL)
+			p = _sx_str(q, end, C2SX("]>"), 2);
+		if (p == NULL)
+			return TAG_PARTIAL;
+		*next = p + (q != NULL ? 2 : 1);
+		*p = NULC;
+		node->tag = s + 9;
+		return node->tag_type = TAG_DOCTYPE;
+	}
+
+	tag_end = (s + 1 < end && s[1] == C2SX('/'));
+	name = s + 1 + tag_end;
+	for (p = name; p < end && *p != C2SX('>') && *p != C2SX('/') && !sx_isspace(*p); p++) ;
+	if (p >= end)
+		return TAG_PARTIAL;
+	if (p == name)
+		return TAG_NONE;
+	node->tag = name;
+
+	if (tag_end) {
+		q = _sx_chr(p, end, C2SX('>'));
+		if (q == NULL)
+			return TAG_PARTIAL;
+		*p = NULC;
+		*next = q + 1;
+		return node->tag_type = TAG_END;
+	}
+
+	/* 'c' is the character at 'p', which may already have been overwritten by a terminator */
+	c = *p;
+	*p = NULC;
+	while (true) {
+		while (sx_isspace(c)) {
+			if (++p >= end)
+				return TAG_PARTIAL;
+			c = *p;
+		}
+
+		if (c == C2SX('>')) {
+			*next = p + 1;
+			return node->tag_type = TAG_FATHER;
+		}
+		if (c == C2SX('/')) {
+			if (p + 1 >= end)
+				return TAG_PARTIAL;
+			if (p[1] != C2SX('>'))
+				return TAG_NONE;
+			*next = p + 2;
+			return node->tag_type = TAG_SELF;
+		}
+
+		/* Attribute name */
+		name = p;
+		for (; p < end && *p != C2SX('=') && *p != C2SX('>') && *p != C2SX('/') && !sx_isspace(*p); p++) ;
+		if (p >= end)
+			return TAG_PARTIAL;
+		c = *p;
+		*p = NULC;
+		while (sx_isspace(c)) {
+			if (++p >= end)
+				return TAG_PARTIAL;
+			c = *p;
+		}
+
+		/* Attribute without value: keep it with an empty one */
+		if (c != C2SX('=')) {
+			if (!_arena_add_attribute(arena, node, name, empty))
+				return TAG_ERROR;
+			continue;
+		}
+
+		do {
+			if (++p >= end)
+				return TAG_PARTIAL;
+		} while (sx_isspace(*p));
+
+		if (isquote(*p)) {
+			q = _sx_chr(p + 1, end, *p);
+			if (q == NULL || q + 1 >= end)
+				return TAG_PARTIAL;
+			*q = NULC;
+			if (!_arena_add_attribute(arena, node, name, p + 1))
+				return TAG_ERROR;
+			p = q + 1;
+			c = *p;
+		} else {
+			q = p;
+			for (; p < end && *p != C2SX('>') && !sx_isspace(*p) && !(*p == C2SX('/') && p + 1 < end && p[1] == C2SX('>')); p++) ;
+			if (p >= end)
+				return TAG_PARTIAL;
+			c = *p;
+			*p = NULC;
+			if (!_arena_add_attribute(arena, node, name, q))
+				return TAG_ERROR;
+		}
+	}
+}
+
+static int _sax_insitu_error(const SAX_Callbacks* sax, SAX_Data* sd, ParseError err)
+{
+	if (sax->on_error == NULL && sax->all_event == NULL)
+		sx_fprintf(stderr, C2SX("%s:%d: PARSE ERROR %d.\n"), sd->name, sd->line_num, (int)err);
+	else {
+		if (sax->on_error != NULL && !sax->on_error(err, sd->line_num, sd))
+			return false;
+		if (sax->all_event != NULL)
+			(void)sax->all_event(XML_EVENT_ERROR, NULL, (SXML_CHAR*)sd->name, err, sd);
+	}
+
+	return false;
+}
+
+static int _parse_insitu_SAX(SXML_CHAR* buf, size_t len, const SAX_Callbacks* sax, SAX_Data* sd)
+{
+	SXML_CHAR *p = buf, *end = buf + len, *lt, *next = NULL;
+	SAX_Arena arena = { NULL, 0 };
+	XMLNode node;
+	TagType tag_type;
+	int ret = true, exit = false;
+
+	sd->line_num = 1;
+	sd->pos = 0;
+	if (sax->start_doc != NULL && !sax->start_doc(sd))
+		return true;
+	if (sax->all_event != NULL && !sax->all_event(XML_EVENT_START_DOC, NULL, (SXML_CHAR*)sd->name, 0, sd))
+		return true;
+
+	node.init_value = 0;
+	(void)XMLNode_init(&node);
+
+#ifndef SXMLC_UNICODE
+	if (len >= 3 && !memcmp(p, "\xEF\xBB\xBF", 3)) /* Skip UTF-8 BOM */
+		p += 3;
+#endif
+
+	while (!exit && p < end) {
+		lt = _sx_chr(p, end, C2SX('<'));
+		if (lt == NULL) {
+			/* Only spaces are allowed after the last tag */
+			sd->line_num += _count_lines(p, end);
+			for (; p < end && sx_isspace(*p); p++) ;
+			if (p < end)
+				ret = _sax_insitu_error(sax, sd, PARSE_ERR_EOF);
+			break;
+		}
+
+		tag_type = _parse_insitu_tag(lt, end, &node, &arena, &next);
+		sd->line_num += _count_lines(p, tag_type == TAG_PARTIAL || tag_type == TAG_NONE || tag_type == TAG_ERROR ? lt : next);
+
+		/* Text for 'father' (i.e. what is before '<') */
+		if (lt != p && (sax->new_text != NULL || sax->all_event != NULL)) {
+			*lt = NULC;
+			sd->pos = lt - buf;
+			if (sax->new_text != NULL && (exit = !sax->new_text(p, sd)))
+				break;
+			if (sax->all_event != NULL && (exit = !sax->all_event(XML_EVENT_TEXT, NULL, p, sd->line_num, sd)))
+				break;
+		}
+
+		switch (tag_type) {
+			case TAG_ERROR:
+				ret = _sax_insitu_error(sax, sd, PARSE_ERR_MEMORY);
+				break;
+
+			case TAG_NONE:
+				ret = _sax_insitu_error(sax, sd, PARSE_ERR_SYNTAX);
+				break;
+
+			case TAG_PARTIAL:
+				ret = _sax_insitu_error(sax, sd, PARSE_ERR_EOF);
+				break;
+
+			case TAG_END:
+				sd->pos = next - buf;
+				if (sax->end_node != NULL && (exit = !sax->end_node(&node, sd)))
+					break;
+				if (sax->all_event != NULL && (exit = !sax->all_event(XML_EVENT_END_NODE, &node, NULL, sd->line_num, sd)))
+					break;
+				break;
+
+			default:
+				sd->pos = next - buf;
+				if (sax->start_node != NULL && (exit = !sax->start_node(&node, sd)))
+					break;
+				if (sax->all_event != NULL && (exit = !sax->all_event(XML_EVENT_START_NODE, &node, NULL, sd->line_num, sd)))
+					break;
+				if (node.tag_type != TAG_FATHER) {
+					if (sax->end_node != NULL && (exit = !sax->end_node(&node, sd)))
+						break;
+					if (sax->all_event != NULL && (exit = !sax->all_event(XML_EVENT_END_NODE, &node, NULL, sd->line_num, sd)))
+						break;
+				}
+				break;
+		}
+		if (ret == false)
+			break;
+		p = next;
+	}
+
+	/* 'node' only points into 'buf' and the arena: it must not be freed with 'XMLNode_free' */
+	__free(arena.attributes);
+
+	if (sax->end_doc != NULL && !sax->end_doc(sd))
+		return ret;
+	if (sax->all_event != NULL)
+		(void)sax->all_event(XML_EVENT_END_DOC, NULL, (SXML_CHAR*)sd->name, sd->line_num, sd);
+
+	return ret;
+}
 
 int SAX_Callbacks_init(SAX_Callbacks* sax)
 {
@@ -1577,6 +1902,43 @@ int SAX_Callbacks_init_DOM(SAX_Callbacks* sax)
 
 int XMLDoc_parse_file_SAX(const SXML_CHAR* filename, const SAX_Callbacks* sax, void* user)
 {
+#ifdef SXMLC_INSITU
+	struct stat st;
+	SXML_CHAR* buf;
+	SAX_Data sd;
+	int fd, ret;
+
+	if (sax == NULL || filename == NULL || filename[0] == NULC)
+		return false;
+
+	fd = open(filename, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return false;
+	if (fstat(fd, &st) < 0) {
+		close(fd);
+		return false;
+	}
+
+	sd.name = (SXML_CHAR*)filename;
+	sd.user = user;
+	sd.file = NULL;
+
+	if (st.st_size == 0) {
+		close(fd);
+		return _parse_insitu_SAX((SXML_CHAR*)"", 0, sax, &sd);
+	}
+
+	/* Private writable mapping: the parser terminates strings in place, pages are copied on write */
+	buf = (SXML_CHAR*)mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+	close(fd);
+	if (buf == MAP_FAILED)
+		return false;
+
+	ret = _parse_insitu_SAX(buf, st.st_size, sax, &sd);
+	munmap(buf, st.st_size);
+
+	return ret;
+#else
 	FILE* f;
 	int ret;
 	SAX_Data sd;
@@ -1624,11 +1986,33 @@ int XMLDoc_parse_file_SAX(const SXML_CHAR* filename, const SAX_Callbacks* sax, v
 	(void)sx_fclose(f);
 
 	return ret;
+#endif
 }
 
 int XMLDoc_parse_buffer_SAX(const SXML_CHAR* buffer, const SXML_CHAR* name, const SAX_Callbacks* sax, void* user)
 {
-	DataSourceBuffer dsb = { buffer, 0 };
+	SXML_CHAR* copy;
+	size_t len;
+	int ret;
+
+	if (sax == NULL || buffer == NULL)
+		return false;
+
+	/* 'buffer' is read-only: parse a private copy in place */
+	len = sx_strlen(buffer);
+	copy = (SXML_CHAR*)__malloc((len + 1) * sizeof(SXML_CHAR));
+	if (copy == NULL)
+		return false;
+	memcpy(copy, buffer, (len + 1) * sizeof(SXML_CHAR));
+
+	ret = XMLDoc_parse_buffer_SAX_insitu(copy, len, name, sax, user);
+	__free(copy);
+
+	return ret;
+}
+
+int XMLDoc_parse_buffer_SAX_insitu(SXML_CHAR* buffer, size_t len, const SXML_CHAR* name, const SAX_Callbacks* sax, void* user)
+{
 	SAX_Data sd;
 
 	if (sax == NULL || buffer == NULL)
@@ -1636,7 +2020,8 @@ int XMLDoc_parse_buffer_SAX(const SXML_CHAR* buffer, const SXML_CHAR* name, cons
 
 	sd.name = name;
 	sd.user = user;
-	return _parse_data_SAX((void*)&dsb, DATA_SOURCE_BUFFER, sax, &sd);
+	sd.file = NULL;
+	return _parse_insitu_SAX(buffer, len, sax, &sd);
 }
 
 int XMLDoc_parse_file_DOM_text_as_nodes(const SXML_CHAR* filename, XMLDoc* doc, int text_as_nodes)
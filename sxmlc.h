@@ -269,8 +269,9 @@ typedef enum _XMLEvent {
  */
 typedef struct _SAX_Data {
 	const SXML_CHAR* name;
-	FILE *file;
+	FILE *file;		/* NULL when the document is parsed in-situ (mmapped file or buffer) */
 	int line_num;
+	long pos;		/* Offset in the document right after the element being reported */
 	void* user;
 } SAX_Data;
 
@@ -690,6 +691,15 @@ int XMLDoc_parse_file_SAX(const SXML_CHAR* filename, const SAX_Callbacks* sax, v
  */
 int XMLDoc_parse_buffer_SAX(const SXML_CHAR* buffer, const SXML_CHAR* name, const SAX_Callbacks* sax, void* user);
 
+/*
+ Same as 'XMLDoc_parse_buffer_SAX' but parses the 'len' characters of 'buffer' in place:
+ tag names, attributes and text are NUL-terminated inside 'buffer' and handed to the
+ callbacks without being copied, so 'buffer' is modified and must stay valid during the parse.
+ 'buffer' does not need to be NUL-terminated.
+ Return 'false' in case of error (memory or malformed document), 'true' otherwise.
+ */
+int XMLDoc_parse_buffer_SAX_insitu(SXML_CHAR* buffer, size_t len, const SXML_CHAR* name, const SAX_Callbacks* sax, void* user);
+
 /*
  Parse an XML file using the DOM implementation.
  */
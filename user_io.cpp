@@ -29,6 +29,7 @@
 #include "miniz.h"
 #include "cheats.h"
 #include "game_docs.h"
+#include "gamecontroller_db.h"
 #include "video.h"
 #include "audio.h"
 #include "shmem.h"
@@ -40,6 +41,10 @@
 #include "profiling.h"
 #endif
 #include "frame_timer.h"
+#include "input_latency.h"
+#include "crc32.h"
+#include "offload.h"
+#include "buffer_pool.h"
 #include "scaler.h"
 #include "support.h"
 
@@ -1563,6 +1568,8 @@ void user_io_init(const char *path, const char *xml)
 			}
 			else if (is_menu())
 			{
+				mra_index_start();
+				gcdb_init();
 				user_io_status_set("[4]", (cfg.menu_pal) ? 1 : 0);
 				if (cfg.fb_terminal) video_menu_bg(user_io_status_get("[3:1]"));
 				else user_io_status_set("[3:1]", 0);
@@ -1824,6 +1831,7 @@ void user_io_digital_joystick(unsigned char joystick, uint32_t map, int newdir)
 	spi_w(map);
 	if(use32) spi_w(map >> 16);
 	DisableIO();
+	LATENCY_SENT();
 
 	if (!is_minimig() && joy_transl == 1 && newdir)
 	{
@@ -2702,16 +2710,22 @@ int user_io_file_tx_a(const char* name, uint16_t index)
 int user_io_file_tx(const char* name, unsigned char index, char opensave, char mute, char composite, uint32_t load_addr)
 {
 	fileTYPE f = {};
-	static uint8_t buf[4096];
 
 	if (!FileOpen(&f, name, mute)) return 0;
 
+	const uint32_t buf_size = iobuf_chunk(&f);
+	uint8_t *buf = (uint8_t *)iobuf_get(buf_size);
+	if (!buf) return 0;
+
 	uint32_t bytes2send = f.size;
 
 	if (composite)
 	{
-		if (!FileReadSec(&f, buf)) return 0;
-		if (memcmp(buf, "MiSTer", 6)) return 0;
+		if (!FileReadSec(&f, buf) || memcmp(buf, "MiSTer", 6))
+		{
+			iobuf_put(buf);
+			return 0;
+		}
 
 		uint32_t off = 16 + *(uint32_t*)(((uint8_t*)buf) + 12);
 		bytes2send -= off;
@@ -2766,9 +2780,9 @@ int user_io_file_tx(const char* name, unsigned char index, char opensave, char m
 				FileOpen(&fb, user_io_make_filepath(HomeDir(), "bsx_bios.rom")))
 			{
 				printf("Load BSX bios ROM.\n");
-				uint8_t* buf = snes_get_header(&fb);
-				hexdump(buf, 16, 0);
-				user_io_file_tx_data(buf, 512);
+				uint8_t* hdr = snes_get_header(&fb);
+				hexdump(hdr, 16, 0);
+				user_io_file_tx_data(hdr, 512);
 
 				//strip original SNES ROM header if present (not used)
 				if ((bytes2send % 1024) == 512)
@@ -2780,7 +2794,7 @@ int user_io_file_tx(const char* name, unsigned char index, char opensave, char m
 				uint32_t sz = fb.size;
 				while (sz)
 				{
-					uint32_t chunk = (sz > sizeof(buf)) ? sizeof(buf) : sz;
+					uint32_t chunk = (sz > buf_size) ? buf_size : sz;
 					FileReadAdv(&fb, buf, chunk);
 					user_io_file_tx_data(buf, chunk);
 					sz -= chunk;
@@ -2816,7 +2830,7 @@ int user_io_file_tx(const char* name, unsigned char index, char opensave, char m
 			uint8_t *rom = snes_get_mirrored_rom(&f, &rom_size);
 			if (rom) {
 				uint32_t orig_size = (f.size & 512) ? f.size - 512 : f.size;
-				file_crc = crc32(0, rom, orig_size);
+				file_crc = crc32_update(0, rom, orig_size);
 
 				uint32_t remaining = rom_size;
 				uint32_t sent = 0;
@@ -2858,7 +2872,7 @@ int user_io_file_tx(const char* name, unsigned char index, char opensave, char m
 				uint32_t sz = fg.size;
 				while (sz)
 				{
-					uint32_t chunk = (sz > sizeof(buf)) ? sizeof(buf) : sz;
+					uint32_t chunk = (sz > buf_size) ? buf_size : sz;
 					FileReadAdv(&fg, buf, chunk);
 					user_io_file_tx_data(buf, chunk);
 					sz -= chunk;
@@ -2883,28 +2897,74 @@ int user_io_file_tx(const char* name, unsigned char index, char opensave, char m
 		uint8_t *mem = (uint8_t *)shmem_map(fpga_mem(load_addr), map_size);
 		if (mem)
 		{
+			// When the CRC is needed, read through a cached staging buffer
+			// instead of straight into the mapping: the CRC then runs on the
+			// offload core over cached memory, in parallel with the copy and
+			// the next read, rather than reading the uncached window back.
+			const uint32_t stage_size = 256 * 1024;
+			uint8_t *stage[2] = {};
+			if (!is_snes() && use_cheats)
+			{
+				stage[0] = (uint8_t *)iobuf_get(stage_size);
+				stage[1] = (uint8_t *)iobuf_get(stage_size);
+				if (!stage[0] || !stage[1])
+				{
+					iobuf_put(stage[0]);
+					iobuf_put(stage[1]);
+					stage[0] = stage[1] = NULL;
+				}
+			}
+			int stage_cur = 0;
+
 			while (bytes2send)
 			{
 				uint32_t gap = (is_snes() && (load_addr < 0x22000000) && (load_addr + size - bytes2send) >= 0x22000000) ? 0x800000 : 0;
 
 				uint32_t chunk = (bytes2send > (256 * 1024)) ? (256 * 1024) : bytes2send;
-				FileReadAdv(&f, mem + size - bytes2send + gap, chunk);
+				uint8_t *dst = mem + size - bytes2send + gap;
 
-				if(!is_snes() && use_cheats) file_crc = crc32(file_crc, mem + skip + size - bytes2send, chunk - skip);
+				if (stage[0])
+				{
+					uint8_t *sbuf = stage[stage_cur];
+					FileReadAdv(&f, sbuf, chunk);
+
+					// The previous chunk's CRC was working on the other half.
+					offload_wait();
+					uint8_t *crc_ptr = sbuf + skip;
+					uint32_t crc_len = chunk - skip;
+					offload_add_work([=] { file_crc = crc32_update(file_crc, crc_ptr, crc_len); });
+
+					memcpy(dst, sbuf, chunk);
+					stage_cur ^= 1;
+				}
+				else
+				{
+					FileReadAdv(&f, dst, chunk);
+					if(!is_snes() && use_cheats) file_crc = crc32_update(file_crc, dst + skip, chunk - skip);
+				}
 				skip = 0;
 
 				if (use_progress) ProgressMessage("Loading", f.name, size - bytes2send, size);
 				bytes2send -= chunk;
 			}
 
+			if (stage[0])
+			{
+				offload_wait();
+				iobuf_put(stage[0]);
+				iobuf_put(stage[1]);
+			}
+
 			shmem_unmap(mem, map_size);
 		}
 	}
 	else
 	{
+		// The BS header patch expects the file in 4KB pieces.
+		const uint32_t chunk_max = (is_snes() && (snes_file == SNES_FILE_BS)) ? 4096 : buf_size;
 		while (dosend && bytes2send)
 		{
-			uint32_t chunk = (bytes2send > sizeof(buf)) ? sizeof(buf) : bytes2send;
+			uint32_t chunk = (bytes2send > chunk_max) ? chunk_max : bytes2send;
 
 			FileReadAdv(&f, buf, chunk);
 			if (is_snes() && (snes_file == SNES_FILE_BS)) snes_patch_bs_header(&f, buf);
@@ -2916,7 +2976,7 @@ int user_io_file_tx(const char* name, unsigned char index, char opensave, char m
 			if (skip >= chunk) skip -= chunk;
 			else
 			{
-				file_crc = crc32(file_crc, buf + skip, chunk - skip);
+				file_crc = crc32_update(file_crc, buf + skip, chunk - skip);
 				skip = 0;
 			}
 		}
@@ -2958,6 +3018,7 @@ int user_io_file_tx(const char* name, unsigned char index, char opensave, char m
 
 	mdplus_init(name); // MD+ CDDA init
 
+	iobuf_put(buf);
 	return 1;
 }
 
@@ -10,8 +10,14 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <sched.h>
+#include <sys/wait.h>
 #include <math.h>
 
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
+
 #include "hardware.h"
 #include "user_io.h"
 #include "spi.h"
@@ -31,7 +37,7 @@
 #include "support.h"
 #include "support/arcade/mra_loader.h"
 #include "lib/imlib2/Imlib2.h"
-#include "lib/md5/md5.h"
+#include "crc32.h"
 
 #define FB_SIZE  (1920*1080)
 #define FB_ADDR  (0x20000000 + (32*1024*1024)) // 512mb + 32mb(Core's fb)
@@ -326,21 +332,11 @@ struct FilterPhase
 
 static constexpr int N_PHASES = 256;
 
-struct VideoFilterDigest
-{
-	VideoFilterDigest() { memset(md5, 0, sizeof(md5)); }
-	bool operator!=(const VideoFilterDigest& other) { return memcmp(md5, other.md5, sizeof(md5)) != 0; }
-	bool operator==(const VideoFilterDigest& other) { return memcmp(md5, other.md5, sizeof(md5)) == 0; }
-
-	unsigned char md5[16];
-};
-
 struct VideoFilter
 {
 	bool is_adaptive;
 	FilterPhase phases[N_PHASES];
 	FilterPhase adaptive_phases[N_PHASES];
-	VideoFilterDigest digest;
 };
 
 static VideoFilter scaler_flt_data[4];
@@ -370,21 +366,75 @@ static bool scale_phases(FilterPhase out_phases[N_PHASES], FilterPhase *in_phase
 	return true;
 }
 
-static bool read_video_filter(int type, VideoFilter *out)
+// Filters, gamma curves and shadow masks are kept compiled in /tmp, keyed by the
+// source path and checked against its size and mtime, so presets and core
+// switches (each one restarts the binary) don't parse the text files again.
+#define LUT_CACHE_MAGIC 0x4354554C // LUTC
+
+struct lut_cache_hdr_t
 {
-	PROFILE_FUNCTION();
+	uint32_t magic;
+	uint32_t key;
+	uint32_t size;
+	uint32_t pad;
+	int64_t  src_size;
+	int64_t  src_mtime;
+	int64_t  src_mtime_ns;
+};
 
+static int lut_cache_open(const char *src, lut_cache_hdr_t *hdr, int size, char *cache_name, int cache_name_sz)
+{
+	struct stat st;
+	if (stat(getFullPath(src), &st) || !S_ISREG(st.st_mode)) return 0;
+
+	memset(hdr, 0, sizeof(*hdr));
+	hdr->magic = LUT_CACHE_MAGIC;
+	hdr->key = crc32_update(0, (const uint8_t *)src, strlen(src));
+	hdr->size = size;
+	hdr->src_size = st.st_size;
+	hdr->src_mtime = st.st_mtim.tv_sec;
+	hdr->src_mtime_ns = st.st_mtim.tv_nsec;
+
+	snprintf(cache_name, cache_name_sz, "/tmp/lut_%08X.bin", hdr->key);
+	return 1;
+}
+
+static int lut_cache_load(const char *src, void *data, int size)
+{
+	lut_cache_hdr_t hdr, chk;
+	char name[64];
+	if (!lut_cache_open(src, &hdr, size, name, sizeof(name))) return 0;
+
+	int fd = open(name, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) return 0;
+
+	int ok = read(fd, &chk, sizeof(chk)) == sizeof(chk) && !memcmp(&chk, &hdr, sizeof(hdr)) && read(fd, data, size) == size;
+	close(fd);
+	return ok;
+}
+
+static void lut_cache_save(const char *src, const void *data, int size)
+{
+	lut_cache_hdr_t hdr;
+	char name[64];
+	if (!lut_cache_open(src, &hdr, size, name, sizeof(name))) return;
+
+	int fd = open(name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0) return;
+
+	int ok = (write(fd, &hdr, sizeof(hdr)) == sizeof(hdr)) && (write(fd, data, size) == size);
+	close(fd);
+	if (!ok) unlink(name);
+}
+
+static bool parse_video_filter(const char *filename, VideoFilter *out)
+{
 	fileTextReader reader = {};
 	FilterPhase phases[512];
 	int count = 0;
 	bool is_adaptive = false;
 	int scale = 2;
 
-	memset(out, 0, sizeof(VideoFilter));
-
-	static char filename[1024];
-	snprintf(filename, sizeof(filename), COEFF_DIR"/%s", scaler_flt[type].filename);
-
 	if (FileOpenTextReader(&reader, filename))
 	{
 		const char *line;
@@ -417,7 +467,7 @@ static bool read_video_filter(int type, VideoFilter *out)
 	}
 
 	printf( "Filter \'%s\', phases: %d adaptive: %s\n",
-			scaler_flt[type].filename,
+			filename,
 			is_adaptive ? count / 2 : count,
 			is_adaptive ? "true" : "false" );
 
@@ -451,29 +501,73 @@ static bool read_video_filter(int type, VideoFilter *out)
 		scale_phases(out->phases, nn_phases, 2);
 	}
 
-	MD5Context ctx;
-	MD5Init(&ctx);
-	MD5Update(&ctx, (unsigned char *)&out->is_adaptive, sizeof(VideoFilter::is_adaptive));
-	MD5Update(&ctx, (unsigned char *)out->phases, sizeof(VideoFilter::phases));
-	MD5Update(&ctx, (unsigned char *)out->adaptive_phases, sizeof(VideoFilter::adaptive_phases));
-	MD5Final(out->digest.md5, &ctx);
-
 	return valid;
 }
 
+static bool read_video_filter(int type, VideoFilter *out)
+{
+	PROFILE_FUNCTION();
+
+	struct
+	{
+		VideoFilter flt;
+		uint32_t valid;
+	} compiled;
+
+	static char filename[1024];
+	snprintf(filename, sizeof(filename), COEFF_DIR"/%s", scaler_flt[type].filename);
+
+	if (!lut_cache_load(filename, &compiled, sizeof(compiled)))
+	{
+		memset(&compiled, 0, sizeof(compiled));
+		compiled.valid = parse_video_filter(filename, &compiled.flt);
+		lut_cache_save(filename, &compiled, sizeof(compiled));
+	}
+
+	memcpy(out, &compiled.flt, sizeof(VideoFilter));
+	return compiled.valid;
+}
+
+// Coefficients currently in the scaler, per slot (horizontal, vertical and the two
+// adaptive sets). Every write is addressed, so only the phases that differ are sent.
+static FilterPhase sent_phases[4][N_PHASES];
+static bool sent_valid[4] = {};
+static int sent_ver = -1;
+
+static bool phase_sent(int slot, int idx, const FilterPhase *p)
+{
+	return sent_valid[slot] && !memcmp(&sent_phases[slot][idx], p, sizeof(FilterPhase));
+}
+
+static void phases_sent(int slot, const FilterPhase phases[N_PHASES])
+{
+	memcpy(sent_phases[slot], phases, sizeof(sent_phases[slot]));
+	sent_valid[slot] = true;
+}
+
+static bool phases_changed(int slot, const FilterPhase phases[N_PHASES])
+{
+	return !sent_valid[slot] || memcmp(sent_phases[slot], phases, sizeof(sent_phases[slot]));
+}
+
 static void send_phases_legacy(int addr, const FilterPhase phases[N_PHASES])
 {
 	PROFILE_FUNCTION();
 
+	int slot = addr ? 1 : 0;
 	for (int idx = 0; idx < N_PHASES; idx += 16)
 	{
 		const FilterPhase *p = &phases[idx];
-		spi_w(((p->t[0] >> 1) & 0x1FF) | ((addr + 0) << 9));
-		spi_w(((p->t[1] >> 1) & 0x1FF) | ((addr + 1) << 9));
-		spi_w(((p->t[2] >> 1) & 0x1FF) | ((addr + 2) << 9));
-		spi_w(((p->t[3] >> 1) & 0x1FF) | ((addr + 3) << 9));
+		if (!phase_sent(slot, idx, p))
+		{
+			spi_w(((p->t[0] >> 1) & 0x1FF) | ((addr + 0) << 9));
+			spi_w(((p->t[1] >> 1) & 0x1FF) | ((addr + 1) << 9));
+			spi_w(((p->t[2] >> 1) & 0x1FF) | ((addr + 2) << 9));
+			spi_w(((p->t[3] >> 1) & 0x1FF) | ((addr + 3) << 9));
+		}
 		addr += 4;
 	}
+	phases_sent(slot, phases);
 }
 
 static void send_phases(int addr, const FilterPhase phases[N_PHASES], bool full_precision)
@@ -483,21 +577,24 @@ static void send_phases(int addr, const FilterPhase phases[N_PHASES], bool full_
 	const int skip = full_precision ? 1 : 4;
 	const int shift = full_precision ? 0 : 1;
 
+	int slot = addr;
 	addr *= full_precision ? (N_PHASES * 4) : (64 * 4);
 
 	for (int idx = 0; idx < N_PHASES; idx += skip)
 	{
 		const FilterPhase *p = &phases[idx];
-		spi_w(addr + 0); spi_w((p->t[0] >> shift) & 0x3FF);
-		spi_w(addr + 1); spi_w((p->t[1] >> shift) & 0x3FF);
-		spi_w(addr + 2); spi_w((p->t[2] >> shift) & 0x3FF);
-		spi_w(addr + 3); spi_w((p->t[3] >> shift) & 0x3FF);
+		if (!phase_sent(slot, idx, p))
+		{
+			spi_w(addr + 0); spi_w((p->t[0] >> shift) & 0x3FF);
+			spi_w(addr + 1); spi_w((p->t[1] >> shift) & 0x3FF);
+			spi_w(addr + 2); spi_w((p->t[2] >> shift) & 0x3FF);
+			spi_w(addr + 3); spi_w((p->t[3] >> shift) & 0x3FF);
+		}
 		addr += 4;
 	}
+	phases_sent(slot, phases);
 }
 
-static VideoFilterDigest horiz_filter_digest, vert_filter_digest;
-
 static void send_video_filters(const VideoFilter *horiz, const VideoFilter *vert, int ver)
 {
 	PROFILE_FUNCTION();
@@ -506,28 +603,32 @@ static void send_video_filters(const VideoFilter *horiz, const VideoFilter *vert
 
 	const bool full_precision = (ver & 0x4) != 0;
 
-	const bool send_horiz = horiz_filter_digest != horiz->digest;
-	const bool send_vert = vert_filter_digest != vert->digest;
+	// slot addressing depends on the interface version and precision
+	if (sent_ver != (ver & 0x7))
+	{
+		sent_ver = ver & 0x7;
+		memset(sent_valid, 0, sizeof(sent_valid));
+	}
 
 	switch( ver & 0x3 )
 	{
 		case 1:
-			if (send_horiz) send_phases_legacy(0, horiz->phases);
-			if (send_vert) send_phases_legacy(64, vert->phases);
+			send_phases_legacy(0, horiz->phases);
+			send_phases_legacy(64, vert->phases);
 			break;
 		case 2:
-			if (send_horiz) send_phases(0, horiz->phases, full_precision);
-			if (send_vert) send_phases(1, vert->phases, full_precision);
+			send_phases(0, horiz->phases, full_precision);
+			send_phases(1, vert->phases, full_precision);
 			break;
 		case 3:
-			if (send_horiz) send_phases(0, horiz->phases, full_precision);
-			if (send_vert) send_phases(1, vert->phases, full_precision);
+			send_phases(0, horiz->phases, full_precision);
+			send_phases(1, vert->phases, full_precision);
 
-			if (horiz->is_adaptive && send_horiz)
+			if (horiz->is_adaptive && phases_changed(2, horiz->adaptive_phases))
 			{
 				send_phases(2, horiz->adaptive_phases, full_precision);
 			}
-			else if (vert->is_adaptive && send_vert)
+			else if (vert->is_adaptive)
 			{
 				send_phases(3, vert->adaptive_phases, full_precision);
 			}
@@ -536,9 +637,6 @@ static void send_video_filters(const VideoFilter *horiz, const VideoFilter *vert
 			break;
 	}
 
-	horiz_filter_digest = horiz->digest;
-	vert_filter_digest = vert->digest;
-
 	DisableIO();
 }
 
@@ -692,46 +790,87 @@ static char active_gamma_cfg[1024] = { 0 };
 static char gamma_cfg[1024] = { 0 };
 static char has_gamma = 0; // set in video_init
 
+struct GammaCurve
+{
+	uint32_t count;
+	uint8_t c[256][3];
+};
+
+static bool parse_gamma(const char *filename, GammaCurve *out)
+{
+	fileTextReader reader = {};
+	if (!FileOpenTextReader(&reader, filename)) return false;
+
+	const char *line;
+	while ((line = FileReadLine(&reader)))
+	{
+		int c0, c1, c2;
+		int n = sscanf(line, "%d,%d,%d", &c0, &c1, &c2);
+		if (n == 1)
+		{
+			c1 = c0;
+			c2 = c0;
+			n = 3;
+		}
+
+		if (n == 3)
+		{
+			out->c[out->count][0] = c0;
+			out->c[out->count][1] = c1;
+			out->c[out->count][2] = c2;
+
+			out->count++;
+			if (out->count >= 256) break;
+		}
+	}
+
+	return true;
+}
+
+// Curve currently in the core. Entries are addressed, so only the changed ones are sent.
+static GammaCurve gamma_sent = {};
+
 static void setGamma()
 {
 	PROFILE_FUNCTION();
 
 	if (!memcmp(active_gamma_cfg, gamma_cfg, sizeof(gamma_cfg))) return;
 
-	fileTextReader reader = {};
 	static char filename[1024];
 
 	if (!has_gamma) return;
 
 	snprintf(filename, sizeof(filename), GAMMA_DIR"/%s", gamma_cfg + 1);
 
-	if (FileOpenTextReader(&reader, filename))
+	struct
+	{
+		GammaCurve curve;
+		uint32_t valid;
+	} compiled;
+
+	if (!lut_cache_load(filename, &compiled, sizeof(compiled)))
+	{
+		memset(&compiled, 0, sizeof(compiled));
+		compiled.valid = parse_gamma(filename, &compiled.curve);
+		lut_cache_save(filename, &compiled, sizeof(compiled));
+	}
+
+	if (compiled.valid)
 	{
 		spi_uio_cmd_cont(UIO_SET_GAMCURV);
 
-		const char *line;
-		int index = 0;
-		while ((line = FileReadLine(&reader)))
+		const GammaCurve *curve = &compiled.curve;
+		for (uint32_t index = 0; index < curve->count; index++)
 		{
-			int c0, c1, c2;
-			int n = sscanf(line, "%d,%d,%d", &c0, &c1, &c2);
-			if (n == 1)
-			{
-				c1 = c0;
-				c2 = c0;
-				n = 3;
-			}
+			if (index < gamma_sent.count && !memcmp(gamma_sent.c[index], curve->c[index], 3)) continue;
 
-			if (n == 3)
-			{
-				spi_w((index << 8) | (c0 & 0xFF));
-				spi_w((index << 8) | (c1 & 0xFF));
-				spi_w((index << 8) | (c2 & 0xFF));
-
-				index++;
-				if (index >= 256) break;
-			}
+			spi_w((index << 8) | curve->c[index][0]);
+			spi_w((index << 8) | curve->c[index][1]);
+			spi_w((index << 8) | curve->c[index][2]);
+			memcpy(gamma_sent.c[index], curve->c[index], 3);
 		}
+		if (gamma_sent.count < curve->count) gamma_sent.count = curve->count;
+
 		DisableIO();
 		spi_uio_cmd8(UIO_SET_GAMMA, gamma_cfg[0]);
 	}
@@ -820,6 +959,117 @@ enum
 	SM_MODE_COUNT
 };
 
+// A mask file may hold several masks, each one starting after a "resolution=N" line.
+// Compiled form: the words each possible starting point produces, so picking the
+// mask for the current resolution needs no parsing.
+#define SM_MAX_STARTS 32
+#define SM_MAX_WORDS  (16 * 16 + 3)
+
+struct ShadowMaskStart
+{
+	uint32_t res;
+	uint32_t count;
+	uint16_t words[SM_MAX_WORDS];
+};
+
+struct ShadowMask
+{
+	uint32_t starts; // starts[0] is the beginning of the file
+	ShadowMaskStart start[SM_MAX_STARTS];
+};
+
+static void parse_shadow_mask_from(fileTextReader *reader, ShadowMaskStart *out)
+{
+	const char *line;
+	int w = -1, h = -1;
+	int y = 0;
+	int v2 = 0;
+	int loaded = 0;
+
+	while ((line = FileReadLine(reader)))
+	{
+		if (w == -1)
+		{
+			if (!strcasecmp(line, "v2"))
+			{
+				v2 = 1;
+				continue;
+			}
+
+			if (!strncasecmp(line, "resolution=", 11))
+			{
+				continue;
+			}
+
+			int n = sscanf(line, "%d,%d", &w, &h);
+			if ((n != 2) || (w <= 0) || (h <= 0) || (w > 16) || (h > 16))
+			{
+				break;
+			}
+		}
+		else
+		{
+			unsigned int p[16] = {};
+			int n = sscanf(line, "%X,%x,%x,%x,%x,%x,%x,%x,%x,%x,%x,%x,%x,%x,%x,%x", p + 0, p + 1, p + 2, p + 3, p + 4, p + 5, p + 6, p + 7, p + 8, p + 9, p + 10, p + 11, p + 12, p + 13, p + 14, p + 15);
+			if (n != w)
+			{
+				break;
+			}
+
+			for (int x = 0; x < 16; x++) out->words[out->count++] = SM_LUT(v2 ? (p[x] & 0x7FF) : (((p[x] & 7) << 8) | 0x2A));
+			y += 1;
+
+			if (y == h)
+			{
+				loaded = 1;
+				break;
+			}
+		}
+	}
+
+	if (y == h)
+	{
+		out->words[out->count++] = SM_HMAX(w - 1);
+		out->words[out->count++] = SM_VMAX(h - 1);
+	}
+
+	if (!loaded) out->words[out->count++] = SM_FLAG(0);
+}
+
+static bool parse_shadow_mask(const char *filename, ShadowMask *out)
+{
+	fileTextReader reader;
+	if (!FileOpenTextReader(&reader, filename)) return false;
+
+	char *pos[SM_MAX_STARTS];
+	pos[0] = reader.pos;
+	out->starts = 1;
+
+	const char *line;
+	uint32_t res = 0;
+	while ((line = FileReadLine(&reader)) && out->starts < SM_MAX_STARTS)
+	{
+		if (!strncasecmp(line, "resolution=", 11) && sscanf(line + 11, "%u", &res))
+		{
+			out->start[out->starts].res = res;
+			pos[out->starts++] = reader.pos;
+		}
+	}
+
+	for (uint32_t i = 0; i < out->starts; i++)
+	{
+		reader.pos = pos[i];
+		parse_shadow_mask_from(&reader, &out->start[i]);
+	}
+
+	return true;
+}
+
+// Words last sent to the core. The mask is streamed without addresses, so it is
+// either resent as a whole or skipped when nothing changed.
+static uint16_t sm_sent[SM_MAX_WORDS + 1];
+static uint32_t sm_sent_count = 0;
+
 static void setShadowMask()
 {
 	PROFILE_FUNCTION();
@@ -834,92 +1084,55 @@ static void setShadowMask()
 	}
 
 	has_shadow_mask = 1;
+
+	uint16_t words[SM_MAX_WORDS + 1];
+	uint32_t count = 0;
+
 	switch (video_get_shadow_mask_mode())
 	{
-		default: spi_w(SM_FLAG(0)); break;
-		case SM_MODE_1X: spi_w(SM_FLAG(SM_FLAG_ENABLED)); break;
-		case SM_MODE_2X: spi_w(SM_FLAG(SM_FLAG_ENABLED | SM_FLAG_2X)); break;
-		case SM_MODE_1X_ROTATED: spi_w(SM_FLAG(SM_FLAG_ENABLED | SM_FLAG_ROTATED)); break;
-		case SM_MODE_2X_ROTATED: spi_w(SM_FLAG(SM_FLAG_ENABLED | SM_FLAG_ROTATED | SM_FLAG_2X)); break;
+		default: words[count++] = SM_FLAG(0); break;
+		case SM_MODE_1X: words[count++] = SM_FLAG(SM_FLAG_ENABLED); break;
+		case SM_MODE_2X: words[count++] = SM_FLAG(SM_FLAG_ENABLED | SM_FLAG_2X); break;
+		case SM_MODE_1X_ROTATED: words[count++] = SM_FLAG(SM_FLAG_ENABLED | SM_FLAG_ROTATED); break;
+		case SM_MODE_2X_ROTATED: words[count++] = SM_FLAG(SM_FLAG_ENABLED | SM_FLAG_ROTATED | SM_FLAG_2X); break;
 	}
 
-	int loaded = 0;
 	snprintf(filename, sizeof(filename), SMASK_DIR"/%s", shadow_mask_cfg + 1);
 
-	fileTextReader reader;
-	if (FileOpenTextReader(&reader, filename))
+	static struct
 	{
-		char *start_pos = reader.pos;
-		const char *line;
-		uint32_t res = 0;
-		while ((line = FileReadLine(&reader)))
-		{
-			if (!strncasecmp(line, "resolution=", 11))
-			{
-				if (sscanf(line + 11, "%u", &res))
-				{
-					if (v_cur.item[5] >= res)
-					{
-						start_pos = reader.pos;
-					}
-				}
-			}
-		}
-
-		int w = -1, h = -1;
-		int y = 0;
-		int v2 = 0;
-
-		reader.pos = start_pos;
-		while ((line = FileReadLine(&reader)))
-		{
-			if (w == -1)
-			{
-				if (!strcasecmp(line, "v2"))
-				{
-					v2 = 1;
-					continue;
-				}
-
-				if (!strncasecmp(line, "resolution=", 11))
-				{
-					continue;
-				}
-
-				int n = sscanf(line, "%d,%d", &w, &h);
-				if ((n != 2) || (w <= 0) || (h <= 0) || (w > 16) || (h > 16))
-				{
-					break;
-				}
-			}
-			else
-			{
-				unsigned int p[16];
-				int n = sscanf(line, "%X,%x,%x,%x,%x,%x,%x,%x,%x,%x,%x,%x,%x,%x,%x,%x", p + 0, p + 1, p + 2, p + 3, p + 4, p + 5, p + 6, p + 7, p + 8, p + 9, p + 10, p + 11, p + 12, p + 13, p + 14, p + 15);
-				if (n != w)
-				{
-					break;
-				}
+		ShadowMask mask;
+		uint32_t valid;
+	} compiled;
 
-				for (int x = 0; x < 16; x++) spi_w(SM_LUT(v2 ? (p[x] & 0x7FF) : (((p[x] & 7) << 8) | 0x2A)));
-				y += 1;
+	if (!lut_cache_load(filename, &compiled, sizeof(compiled)))
+	{
+		memset(&compiled, 0, sizeof(compiled));
+		compiled.valid = parse_shadow_mask(filename, &compiled.mask);
+		lut_cache_save(filename, &compiled, sizeof(compiled));
+	}
 
-				if (y == h)
-				{
-					loaded = 1;
-					break;
-				}
-			}
-		}
+	if (compiled.valid)
+	{
+		// the last mask whose resolution is not above the current one
+		const ShadowMask *mask = &compiled.mask;
+		uint32_t sel = 0;
+		for (uint32_t i = 1; i < mask->starts; i++) if (v_cur.item[5] >= mask->start[i].res) sel = i;
 
-		if (y == h)
-		{
-			spi_w(SM_HMAX(w - 1));
-			spi_w(SM_VMAX(h - 1));
-		}
+		memcpy(words + count, mask->start[sel].words, mask->start[sel].count * sizeof(uint16_t));
+		count += mask->start[sel].count;
+	}
+	else
+	{
+		words[count++] = SM_FLAG(0);
 	}
 
-	if (!loaded) spi_w(SM_FLAG(0));
+	if (count != sm_sent_count || memcmp(words, sm_sent, count * sizeof(uint16_t)))
+	{
+		for (uint32_t i = 0; i < count; i++) spi_w(words[i]);
+		memcpy(sm_sent, words, count * sizeof(uint16_t));
+		sm_sent_count = count;
+	}
 	DisableIO();
 }
 
@@ -3532,40 +3745,70 @@ static void video_fb_config()
 	fb_write_module_params();
 }
 
-static void draw_checkers()
+// Background generators render into a cached buffer (stride fb_width) and only
+// for rows [y0, y1), so a frame can be split between both cores. Rows that
+// repeat the previous one are copied instead of recomputed.
+static void bg_fill(uint32_t *dst, uint32_t color, int n)
+{
+#ifdef __ARM_NEON
+	uint32x4_t v = vdupq_n_u32(color);
+	for (; n >= 4; n -= 4, dst += 4) vst1q_u32(dst, v);
+#endif
+	while (n-- > 0) *dst++ = color;
+}
+
+static uint32_t bg_color(int base_color, int gray)
 {
-	volatile uint32_t* buf = fb_base + (FB_SIZE*menu_bgn);
+	uint32_t color = 0;
+	if (base_color & 4) color |= gray;
+	if (base_color & 2) color |= gray << 8;
+	if (base_color & 1) color |= gray << 16;
+	return color;
+}
 
+static void draw_checkers(uint32_t *buf, int y0, int y1)
+{
 	uint32_t col1 = 0x888888;
 	uint32_t col2 = 0x666666;
 	int sz = fb_width / 128;
+	if (sz < 1) sz = 1;
 
-	for (int y = brd_y; y < fb_height - brd_y; y++)
+	int xe = fb_width - brd_x;
+	for (int y = y0; y < y1; y++)
 	{
 		int c1 = (y / sz) & 1;
-		int pos = y * fb_width;
-		for (int x = brd_x; x < fb_width - brd_x; x++)
+		uint32_t *row = buf + y * fb_width;
+		if (y > y0 && ((y - 1) / sz) == (y / sz))
+		{
+			memcpy(row + brd_x, row - fb_width + brd_x, (xe - brd_x) * 4);
+			continue;
+		}
+
+		for (int x = brd_x; x < xe;)
 		{
-			int c2 = c1 ^ ((x / sz) & 1);
-			buf[pos + x] = c2 ? col2 : col1;
+			int end = ((x / sz) + 1) * sz;
+			if (end > xe) end = xe;
+			bg_fill(row + x, (c1 ^ ((x / sz) & 1)) ? col2 : col1, end - x);
+			x = end;
 		}
 	}
 }
 
-static void draw_hbars1()
+static void draw_hbars1(uint32_t *buf, int y0, int y1)
 {
-	volatile uint32_t* buf = fb_base + (FB_SIZE*menu_bgn);
 	int height = fb_height - 2 * brd_y;
+	int width = fb_width - 2 * brd_x;
 
 	int old_base = 0;
 	int gray = 255;
 	int sz = height / 7;
+	if (sz < 1) sz = 1;
 	int stp = 0;
 
-	for (int y = brd_y; y < fb_height - brd_y; y++)
+	// the fade carries from row to row, so run it from the top
+	for (int y = brd_y; y < y1; y++)
 	{
-		int pos = y * fb_width;
-		int base_color = ((7 * (y-brd_y)) / height) + 1;
+		int base_color = ((7 * (y - brd_y)) / height) + 1;
 		if (old_base != base_color)
 		{
 			stp = sz;
@@ -3573,63 +3816,65 @@ static void draw_hbars1()
 		}
 
 		gray = 255 * stp / sz;
-
-		for (int x = brd_x; x < fb_width - brd_x; x++)
-		{
-			uint32_t color = 0;
-			if (base_color & 4) color |= gray;
-			if (base_color & 2) color |= gray << 8;
-			if (base_color & 1) color |= gray << 16;
-			buf[pos + x] = color;
-		}
+		if (y >= y0) bg_fill(buf + y * fb_width + brd_x, bg_color(base_color, gray), width);
 
 		stp--;
 		if (stp < 0) stp = 0;
 	}
 }
 
-static void draw_hbars2()
+static void draw_hbars2(uint32_t *buf, int y0, int y1)
 {
-	volatile uint32_t* buf = fb_base + (FB_SIZE*menu_bgn);
 	int height = fb_height - 2 * brd_y;
 	int width = fb_width - 2 * brd_x;
 
-	for (int y = brd_y; y < fb_height - brd_y; y++)
+	int prev = -1;
+	for (int y = y0; y < y1; y++)
 	{
-		int pos = y * fb_width;
+		uint32_t *row = buf + y * fb_width + brd_x;
 		int base_color = ((14 * (y - brd_y)) / height);
+		if (base_color == prev)
+		{
+			memcpy(row, row - fb_width, width * 4);
+			continue;
+		}
+		prev = base_color;
+
 		int inv = base_color & 1;
 		base_color >>= 1;
 		base_color = (inv ? base_color : 6 - base_color) + 1;
-		for (int x = brd_x; x < fb_width - brd_x; x++)
+		for (int x = 0; x < width; x++)
 		{
-			int gray = (256 * (x - brd_x)) / width;
+			int gray = (256 * x) / width;
 			if (inv) gray = 255 - gray;
-			uint32_t color = 0;
-			if (base_color & 4) color |= gray;
-			if (base_color & 2) color |= gray << 8;
-			if (base_color & 1) color |= gray << 16;
-			buf[pos + x] = color;
+			row[x] = bg_color(base_color, gray);
 		}
 	}
 }
 
-static void draw_vbars1()
+static void draw_vbars1(uint32_t *buf, int y0, int y1)
 {
-	volatile uint32_t* buf = fb_base + (FB_SIZE*menu_bgn);
 	int width = fb_width - 2 * brd_x;
 
 	int sz = width / 7;
+	if (sz < 1) sz = 1;
 	int stp = 0;
 
-	for (int y = brd_y; y < fb_height - brd_y; y++)
+	// every row is the same
+	for (int y = y0; y < y1; y++)
 	{
-		int pos = y * fb_width;
+		uint32_t *row = buf + y * fb_width + brd_x;
+		if (y > y0)
+		{
+			memcpy(row, row - fb_width, width * 4);
+			continue;
+		}
+
 		int old_base = 0;
 		int gray = 255;
-		for (int x = brd_x; x < fb_width - brd_x; x++)
+		for (int x = 0; x < width; x++)
 		{
-			int base_color = ((7 * (x - brd_x)) / width) + 1;
+			int base_color = ((7 * x) / width) + 1;
 			if (old_base != base_color)
 			{
 				stp = sz;
@@ -3637,12 +3882,7 @@ static void draw_vbars1()
 			}
 
 			gray = 255 * stp / sz;
-
-			uint32_t color = 0;
-			if (base_color & 4) color |= gray;
-			if (base_color & 2) color |= gray << 8;
-			if (base_color & 1) color |= gray << 16;
-			buf[pos + x] = color;
+			row[x] = bg_color(base_color, gray);
 
 			stp--;
 			if (stp < 0) stp = 0;
@@ -3650,64 +3890,70 @@ static void draw_vbars1()
 	}
 }
 
-static void draw_vbars2()
+static void draw_vbars2(uint32_t *buf, int y0, int y1)
 {
-	volatile uint32_t* buf = fb_base + (FB_SIZE*menu_bgn);
 	int height = fb_height - 2 * brd_y;
 	int width = fb_width - 2 * brd_x;
 
-	for (int y = brd_y; y < fb_height - brd_y; y++)
+	for (int y = y0; y < y1; y++)
 	{
-		int pos = y * fb_width;
-		for (int x = brd_x; x < fb_width - brd_x; x++)
+		uint32_t *row = buf + y * fb_width + brd_x;
+		int gray = ((256 * (y - brd_y)) / height);
+		for (int x = 0; x < width; x++)
 		{
-			int gray = ((256 * (y - brd_y)) / height);
-			int base_color = ((14 * (x - brd_x)) / width);
+			int base_color = ((14 * x) / width);
 			int inv = base_color & 1;
 			base_color >>= 1;
 			base_color = (inv ? base_color : 6 - base_color) + 1;
-
-			if (inv) gray = 255 - gray;
-			uint32_t color = 0;
-			if (base_color & 4) color |= gray;
-			if (base_color & 2) color |= gray << 8;
-			if (base_color & 1) color |= gray << 16;
-			buf[pos + x] = color;
+			row[x] = bg_color(base_color, inv ? 255 - gray : gray);
 		}
 	}
 }
 
-static void draw_spectrum()
+static void draw_spectrum(uint32_t *buf, int y0, int y1)
 {
-	volatile uint32_t* buf = fb_base + (FB_SIZE*menu_bgn);
 	int height = fb_height - 2 * brd_y;
 	int width = fb_width - 2 * brd_x;
 
-	for (int y = brd_y; y < fb_height - brd_y; y++)
+	for (int y = y0; y < y1; y++)
 	{
-		int pos = y * fb_width;
+		uint32_t *row = buf + y * fb_width + brd_x;
 		int blue = ((256 * (y - brd_y)) / height);
-		for (int x = brd_x; x < fb_width - brd_x; x++)
+		for (int x = 0; x < width; x++)
 		{
-			int green = ((256 * (x - brd_x)) / width) - blue / 2;
+			int green = ((256 * x) / width) - blue / 2;
 			int red = 255 - green - blue / 2;
 			if (red < 0) red = 0;
 			if (green < 0) green = 0;
 
-			buf[pos + x] = (red << 16) | (green << 8) | blue;
+			row[x] = (red << 16) | (green << 8) | blue;
 		}
 	}
 }
 
-static void draw_black()
+// Darken by the curtain: each pass is a 0x63 alpha blend of black, so the
+// channels are scaled by (156/255)^passes.
+static void bg_darken(uint32_t *buf, int n, int passes)
 {
-	volatile uint32_t* buf = fb_base + (FB_SIZE*menu_bgn);
+	uint32_t mul = 256;
+	for (int i = 0; i < passes; i++) mul = (mul * 156 + 127) / 255;
+
+	uint8_t *p = (uint8_t *)buf;
+	int len = n * 4;
+	int i = 0;
 
-	for (int y = 0; y < fb_height; y++)
+#ifdef __ARM_NEON
+	uint8x8_t m = vdup_n_u8(mul > 255 ? 255 : mul);
+	for (; i + 16 <= len; i += 16)
 	{
-		int pos = y * fb_width;
-		for (int x = 0; x < fb_width; x++) buf[pos++] = 0;
+		uint8x16_t v = vld1q_u8(p + i);
+		uint8x8_t lo = vshrn_n_u16(vmull_u8(vget_low_u8(v), m), 8);
+		uint8x8_t hi = vshrn_n_u16(vmull_u8(vget_high_u8(v), m), 8);
+		vst1q_u8(p + i, vcombine_u8(lo, hi));
 	}
+#endif
+
+	for (; i < len; i++) p[i] = (p[i] * mul) >> 8;
 }
 
 static uint64_t getus()
@@ -3737,53 +3983,215 @@ static void vs_wait()
 	printf("vs_wait(us): %llu\n", t2 - t1);
 }
 
-static char *get_file_fromdir(const char* dir, int num, int *count)
+static uint32_t get_random()
 {
-	static char name[256+32];
+	uint32_t rnd;
+	int rndfd = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+	if (rndfd >= 0)
+	{
+		read(rndfd, &rnd, sizeof(rnd));
+		close(rndfd);
+	}
+
+	return rnd;
+}
+
+// Pick one wallpaper of a directory in a single pass (reservoir sampling),
+// other than skip when there is a choice.
+static char *get_random_file(const char* dir, const char *skip)
+{
+	static char name[256 + 32];
 	name[0] = 0;
-	if(count) *count = 0;
+
 	DIR *d = opendir(getFullPath(dir));
 	if (d)
 	{
+		uint32_t seed = get_random();
 		int cnt = 0;
-		struct dirent *de = readdir(d);
-		while (de)
+		struct dirent *de;
+		while ((de = readdir(d)))
 		{
 			int len = strlen(de->d_name);
 			if (len > 4 && (de->d_name[0] != '.') && (!strcasecmp(de->d_name + len - 4, ".png") || !strcasecmp(de->d_name + len - 4, ".jpg")))
 			{
-				if (num == cnt) break;
+				char fname[256 + 32];
+				snprintf(fname, sizeof(fname), "%s/%s", dir, de->d_name);
+				if (skip && !strcmp(fname, skip)) continue;
+
 				cnt++;
+				if (!(rand_r(&seed) % cnt)) strcpy(name, fname);
 			}
+		}
+		closedir(d);
+	}
 
-			de = readdir(d);
+	return name;
+}
+
+// Decoded images survive core reloads (the binary restarts with each core) in
+// /tmp, as raw pixels in the framebuffer's own format. key identifies the
+// source and the size the image was prepared for.
+#define IMG_CACHE_MAGIC 0x43474D49 // IMGC
+#define WALLPAPER_CACHE_MAX 3
+#define WALLPAPER_NEXT "/tmp/wallpaper.next"
+
+struct img_cache_hdr_t
+{
+	uint32_t magic;
+	uint32_t key;
+	int32_t  w, h;
+};
+
+static uint32_t *img_cache_load(const char *name, uint32_t key, int *w, int *h)
+{
+	int fd = open(name, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) return NULL;
+
+	uint32_t *px = NULL;
+	img_cache_hdr_t hdr;
+	if (read(fd, &hdr, sizeof(hdr)) == sizeof(hdr) && hdr.magic == IMG_CACHE_MAGIC && hdr.key == key && hdr.w > 0 && hdr.h > 0)
+	{
+		ssize_t sz = hdr.w * hdr.h * 4;
+		px = (uint32_t *)malloc(sz);
+		if (px && read(fd, px, sz) == sz)
+		{
+			*w = hdr.w;
+			*h = hdr.h;
 		}
+		else
+		{
+			free(px);
+			px = NULL;
+		}
+	}
 
-		if (de)
+	close(fd);
+	return px;
+}
+
+// Written aside and renamed, so a reader never sees a half-written file.
+static void img_cache_save(const char *name, uint32_t key, int w, int h, const uint32_t *px)
+{
+	char tmp[300];
+	snprintf(tmp, sizeof(tmp), "%s.tmp", name);
+
+	int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0) return;
+
+	img_cache_hdr_t hdr = { IMG_CACHE_MAGIC, key, w, h };
+	ssize_t sz = w * h * 4;
+	int ok = (write(fd, &hdr, sizeof(hdr)) == sizeof(hdr)) && (write(fd, px, sz) == sz);
+	close(fd);
+	if (!ok || rename(tmp, name)) unlink(tmp);
+}
+
+// Keep the newest few wallpapers only, they are a few MB each.
+static void wallpaper_cache_trim()
+{
+	DIR *d = opendir("/tmp");
+	if (!d) return;
+
+	char oldest[300] = {};
+	time_t oldest_time = 0;
+	int cnt = 0;
+
+	struct dirent *de;
+	while ((de = readdir(d)))
+	{
+		int len = strlen(de->d_name);
+		if (strncmp(de->d_name, "wallpaper_", 10) || len < 4 || strcmp(de->d_name + len - 4, ".raw")) continue;
+
+		char path[300];
+		snprintf(path, sizeof(path), "/tmp/%s", de->d_name);
+		struct stat st;
+		if (stat(path, &st)) continue;
+
+		cnt++;
+		if (!oldest[0] || st.st_mtime < oldest_time)
 		{
-			snprintf(name, sizeof(name), "%s/%s", dir, de->d_name);
+			strcpy(oldest, path);
+			oldest_time = st.st_mtime;
 		}
-		closedir(d);
-		if(count) *count = cnt;
 	}
+	closedir(d);
 
-	return name;
+	if (cnt >= WALLPAPER_CACHE_MAX) unlink(oldest);
 }
 
-static uint32_t get_random()
+static int wallpaper_cache_name(const char *path, int w, int h, uint32_t *key, char *cache_name, int size)
 {
-	uint32_t rnd;
-	int rndfd = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
-	if (rndfd >= 0)
+	struct stat64 *st = getPathStat(path);
+	if (!st) return 0;
+
+	struct
 	{
-		read(rndfd, &rnd, sizeof(rnd));
-		close(rndfd);
+		int64_t size, mtime;
+		int32_t w, h;
+	} id = { st->st_size, st->st_mtime, w, h };
+
+	*key = crc32_update(0, path, strlen(path));
+	*key = crc32_update(*key, &id, sizeof(id));
+	snprintf(cache_name, size, "/tmp/wallpaper_%08X.raw", *key);
+	return 1;
+}
+
+// Scale the image onto a black w x h canvas, like the framebuffer it used to
+// be drawn onto.
+static uint32_t *wallpaper_decode(const char *path, int w, int h)
+{
+	Imlib_Load_Error error = IMLIB_LOAD_ERROR_NONE;
+	Imlib_Image img = imlib_load_image_with_error_return(path, &error);
+	if (!img)
+	{
+		printf("Image %s loading error %d\n", path, error);
+		return NULL;
 	}
 
-	return rnd;
+	imlib_context_set_image(img);
+	int src_w = imlib_image_get_width();
+	int src_h = imlib_image_get_height();
+
+	uint32_t *px = NULL;
+	Imlib_Image scaled = imlib_create_image(w, h);
+	if (scaled)
+	{
+		imlib_context_set_image(scaled);
+		uint32_t *data = imlib_image_get_data();
+		memset(data, 0, w * h * 4);
+		imlib_image_put_back_data(data);
+		imlib_blend_image_onto_image(img, 0, 0, 0, src_w, src_h, 0, 0, w, h);
+
+		px = (uint32_t *)malloc(w * h * 4);
+		if (px) memcpy(px, imlib_image_get_data_for_reading_only(), w * h * 4);
+		imlib_free_image();
+	}
+
+	imlib_context_set_image(img);
+	imlib_free_image();
+	return px;
+}
+
+// The wallpaper the previous start chose for this one, if it is still there.
+static const char *wallpaper_next(const char *dir)
+{
+	static char name[256 + 32];
+
+	int fd = open(WALLPAPER_NEXT, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) return NULL;
+	int len = read(fd, name, sizeof(name) - 1);
+	close(fd);
+	if (len <= 0) return NULL;
+	name[len] = 0;
+
+	int dirlen = strlen(dir);
+	if (strncmp(name, dir, dirlen) || name[dirlen] != '/' || strchr(name + dirlen + 1, '/')) return NULL;
+	return FileExists(name) ? name : NULL;
 }
 
-static Imlib_Image load_bg()
+// Directory the wallpaper was picked from, empty for a fixed menu.png/jpg.
+static char menubg_dir[128] = {};
+
+static const char *load_bg_name()
 {
 	const char* fname = "menu.png";
 	if (!FileExists(fname))
@@ -3808,32 +4216,263 @@ static Imlib_Image load_bg()
 
 		if (PathIsDir(bgdir))
 		{
-			int count = 0;
-			get_file_fromdir(bgdir, -1, &count);
-			if (count > 0) fname = get_file_fromdir(bgdir, get_random() % count, &count);
+			fname = wallpaper_next(bgdir);
+			if (!fname) fname = get_random_file(bgdir, 0);
+			if (!fname[0]) fname = 0;
+			else strcpy(menubg_dir, bgdir);
 		}
 	}
 
-	if (fname)
+	return fname;
+}
+
+// Menu background, scaled to the framebuffer area it covers.
+static char menubg_name[256 + 32] = {};
+static uint32_t *menubg = 0;
+static int menubg_w = 0, menubg_h = 0;
+
+static void load_bg(int w, int h)
+{
+	if (menubg && menubg_w == w && menubg_h == h) return;
+
+	free(menubg);
+	menubg = 0;
+
+	if (w <= 0 || h <= 0) return;
+
+	if (!menubg_name[0])
+	{
+		const char *fname = load_bg_name();
+		if (!fname) return;
+		snprintf(menubg_name, sizeof(menubg_name), "%s", fname);
+	}
+
+	const char *path = getFullPath(menubg_name);
+	uint32_t key;
+	char cache_name[64];
+	if (!wallpaper_cache_name(path, w, h, &key, cache_name, sizeof(cache_name))) return;
+
+	menubg = img_cache_load(cache_name, key, &menubg_w, &menubg_h);
+	if (menubg && menubg_w == w && menubg_h == h)
 	{
-		Imlib_Load_Error error = IMLIB_LOAD_ERROR_NONE;
-		Imlib_Image img = imlib_load_image_with_error_return(getFullPath(fname), &error);
-		if (img) return img;
-		printf("Image %s loading error %d\n", fname, error);
+		// newest again, so the trim evicts older ones first
+		utimensat(AT_FDCWD, cache_name, NULL, 0);
+		return;
 	}
 
-	return NULL;
+	free(menubg);
+	menubg = wallpaper_decode(path, w, h);
+	if (menubg)
+	{
+		menubg_w = w;
+		menubg_h = h;
+
+		wallpaper_cache_trim();
+		img_cache_save(cache_name, key, w, h, menubg);
+	}
+}
+
+// Choose the wallpaper for the next start now and decode it into the cache
+// while the menu is up, so the next start finds it ready. The decode runs in
+// a detached process on core 0: imlib keeps global state, and a separate
+// process leaves this one's untouched.
+static void wallpaper_prefetch(int w, int h)
+{
+	static int done = 0;
+	if (done || !menubg_dir[0]) return;
+	done = 1;
+
+	const char *fname = get_random_file(menubg_dir, menubg_name);
+	if (!fname[0])
+	{
+		unlink(WALLPAPER_NEXT);
+		return;
+	}
+
+	int fd = open(WALLPAPER_NEXT, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd >= 0)
+	{
+		write(fd, fname, strlen(fname));
+		close(fd);
+	}
+
+	char path[1024];
+	snprintf(path, sizeof(path), "%s", getFullPath(fname));
+
+	uint32_t key;
+	char cache_name[64];
+	if (!wallpaper_cache_name(path, w, h, &key, cache_name, sizeof(cache_name)) || !access(cache_name, F_OK)) return;
+
+	pid_t child = fork();
+	if (child > 0)
+	{
+		waitpid(child, 0, 0);
+		return;
+	}
+	if (child < 0) return;
+
+	if (!fork())
+	{
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(0, &set);
+		sched_setaffinity(0, sizeof(set), &set);
+		nice(10);
+
+		uint32_t *px = wallpaper_decode(path, w, h);
+		if (px)
+		{
+			wallpaper_cache_trim();
+			img_cache_save(cache_name, key, w, h, px);
+		}
+	}
+	_exit(0);
+}
+
+extern uint8_t  _binary_logo_png_start[], _binary_logo_png_end[];
+
+// The built-in logo, decoded and rotated for the OSD orientation.
+static Imlib_Image load_logo()
+{
+	Imlib_Image logo = 0;
+	int size = _binary_logo_png_end - _binary_logo_png_start;
+	uint32_t key = crc32_update(cfg.osd_rotate, _binary_logo_png_start, size);
+
+	int w, h;
+	uint32_t *px = img_cache_load("/tmp/logo.raw", key, &w, &h);
+	if (px)
+	{
+		logo = imlib_create_image_using_copied_data(w, h, px);
+		free(px);
+		if (logo)
+		{
+			imlib_context_set_image(logo);
+			imlib_image_set_has_alpha(1);
+			return logo;
+		}
+	}
+
+	Imlib_Load_Error error;
+	unlink("/tmp/logo.png");
+	if (FileSave("/tmp/logo.png", _binary_logo_png_start, size))
+	{
+		while(1)
+		{
+			error = IMLIB_LOAD_ERROR_NONE;
+			if ((logo = imlib_load_image_with_error_return("/tmp/logo.png", &error))) break;
+			else
+			{
+				if (error != IMLIB_LOAD_ERROR_NO_LOADER_FOR_FILE_FORMAT)
+				{
+					printf("logo.png error = %d\n", error);
+					break;
+				}
+			}
+			vs_wait();
+		};
+
+		if (logo)
+		{
+			imlib_context_set_image(logo);
+			if (cfg.osd_rotate) imlib_image_orientate(cfg.osd_rotate == 1 ? 3 : 1);
+			img_cache_save("/tmp/logo.raw", key, imlib_image_get_width(), imlib_image_get_height(), imlib_image_get_data_for_reading_only());
+		}
+	}
+	else
+	{
+		printf("Fail to save to /tmp/logo.png\n");
+	}
+	unlink("/tmp/logo.png");
+
+	return logo;
 }
 
 static Imlib_Image *bg = 0;
-static Imlib_Image menubg = 0;
 static int bg_has_picture = 0;
-extern uint8_t  _binary_logo_png_start[], _binary_logo_png_end[];
+
+// The background is composed in cached memory and copied to the framebuffer
+// in one pass. The pattern under the overlays is kept and only rendered again
+// when it changes.
+static uint32_t *bg_pattern = 0;
+static uint32_t *bg_frame = 0;
+static Imlib_Image bg_frame_img = 0;
+static int bg_pattern_n = 0;
+static int bg_pattern_pic = 0;
+static int bg_w = 0, bg_h = 0, bg_brd_x = 0, bg_brd_y = 0; // layout the buffers were built for
+
+static void bg_free()
+{
+	if (bg_frame_img)
+	{
+		imlib_context_set_image(bg_frame_img);
+		imlib_free_image();
+		bg_frame_img = 0;
+	}
+
+	free(bg_pattern);
+	free(bg_frame);
+	bg_pattern = 0;
+	bg_frame = 0;
+	bg_pattern_n = 0;
+}
+
+// Render the pattern rows with the offload core taking the top half.
+static void bg_draw_split(void (*draw)(uint32_t *buf, int y0, int y1))
+{
+	uint32_t *buf = bg_pattern;
+	int y0 = brd_y;
+	int y1 = fb_height - brd_y;
+	int mid = (y0 + y1) / 2;
+
+	offload_add_work([=] { draw(buf, y0, mid); });
+	draw(buf, mid, y1);
+	offload_wait();
+}
+
+static void bg_render_pattern(int n)
+{
+	memset(bg_pattern, 0, fb_width * fb_height * 4);
+	bg_pattern_pic = 0;
+
+	void (*draw)(uint32_t *buf, int y0, int y1) = 0;
+	switch (n)
+	{
+	case 1:
+		load_bg(fb_width - (brd_x * 2), fb_height - (brd_y * 2));
+		if (menubg)
+		{
+			uint32_t *dst = bg_pattern + (brd_y * fb_width) + brd_x;
+			for (int y = 0; y < menubg_h; y++) memcpy(dst + (y * fb_width), menubg + (y * menubg_w), menubg_w * 4);
+			bg_pattern_pic = 1;
+			wallpaper_prefetch(menubg_w, menubg_h);
+			break;
+		}
+		draw = draw_checkers;
+		break;
+	case 2:
+		draw = draw_hbars1;
+		break;
+	case 3:
+		draw = draw_hbars2;
+		break;
+	case 4:
+		draw = draw_vbars1;
+		break;
+	case 5:
+		draw = draw_vbars2;
+		break;
+	case 6:
+		draw = draw_spectrum;
+		break;
+	}
+
+	if (draw) bg_draw_split(draw);
+	bg_pattern_n = n;
+}
 
 void video_menu_bg(int n, int idle)
 {
 	static Imlib_Image bg1 = 0, bg2 = 0;
-	static Imlib_Image curtain = 0;
 
 	static int cached_idle = 0;
 	bg_has_picture = 0;
@@ -3845,7 +4484,7 @@ void video_menu_bg(int n, int idle)
 
 		imlib_context_set_image(bg1); imlib_free_image(); bg1 = 0;
 		imlib_context_set_image(bg2); imlib_free_image(); bg2 = 0;
-		imlib_context_set_image(curtain); imlib_free_image(); curtain = 0;
+		bg_free();
 	}
 	else
 	{
@@ -3858,39 +4497,10 @@ void video_menu_bg(int n, int idle)
 		//printf("**** BG DEBUG START ****\n");
 		//printf("n = %d\n", n);
 
-		Imlib_Load_Error error;
 		static Imlib_Image logo = 0;
 		if (!logo)
 		{
-			unlink("/tmp/logo.png");
-			if (FileSave("/tmp/logo.png", _binary_logo_png_start, _binary_logo_png_end - _binary_logo_png_start))
-			{
-				while(1)
-				{
-					error = IMLIB_LOAD_ERROR_NONE;
-					if ((logo = imlib_load_image_with_error_return("/tmp/logo.png", &error))) break;
-					else
-					{
-						if (error != IMLIB_LOAD_ERROR_NO_LOADER_FOR_FILE_FORMAT)
-						{
-							printf("logo.png error = %d\n", error);
-							break;
-						}
-					}
-					vs_wait();
-				};
-
-				if (cfg.osd_rotate)
-				{
-					imlib_context_set_image(logo);
-					imlib_image_orientate(cfg.osd_rotate == 1 ? 3 : 1);
-				}
-			}
-			else
-			{
-				printf("Fail to save to /tmp/logo.png\n");
-			}
-			unlink("/tmp/logo.png");
+			logo = load_logo();
 			printf("Logo = %p\n", logo);
 		}
 
@@ -3904,73 +4514,36 @@ void video_menu_bg(int n, int idle)
 		bg = (menu_bgn == 1) ? &bg1 : &bg2;
 		//printf("*bg = %p\n", *bg);
 
-		if (!curtain)
+		int sz = fb_width * fb_height;
+		if (bg_frame_img && (bg_w != fb_width || bg_h != fb_height || bg_brd_x != brd_x || bg_brd_y != brd_y)) bg_free();
+		if (!bg_frame_img)
 		{
-			curtain = imlib_create_image(fb_width, fb_height);
-			imlib_context_set_image(curtain);
-			imlib_image_set_has_alpha(1);
-
-			uint32_t *data = imlib_image_get_data();
-			int sz = fb_width * fb_height;
-			for (int i = 0; i < sz; i++)
+			bg_pattern = (uint32_t*)malloc(sz * 4);
+			bg_frame = (uint32_t*)malloc(sz * 4);
+			if (bg_pattern && bg_frame) bg_frame_img = imlib_create_image_using_data(fb_width, fb_height, bg_frame);
+			if (!bg_frame_img)
 			{
-				*data++ = 0x63000000;
+				printf("Warning: no memory for the background\n");
+				bg_free();
+				video_fb_enable(0);
+				return;
 			}
-		}
 
-		draw_black();
+			bg_w = fb_width;
+			bg_h = fb_height;
+			bg_brd_x = brd_x;
+			bg_brd_y = brd_y;
+		}
 
 		if (idle < 3)
 		{
-			switch (n)
-			{
-			case 1:
-				if (!menubg) menubg = load_bg();
-				if (menubg)
-				{
-					imlib_context_set_image(menubg);
-					int src_w = imlib_image_get_width();
-					int src_h = imlib_image_get_height();
-					//printf("menubg: src_w=%d, src_h=%d\n", src_w, src_h);
-
-					if (*bg)
-					{
-						imlib_context_set_image(*bg);
-						imlib_blend_image_onto_image(menubg, 0,
-							0, 0,                           //int source_x, int source_y,
-							src_w, src_h,                   //int source_width, int source_height,
-							brd_x, brd_y,                   //int destination_x, int destination_y,
-							fb_width - (brd_x * 2), fb_height - (brd_y * 2) //int destination_width, int destination_height
-						);
-						bg_has_picture = 1;
-						break;
-					}
-					else
-					{
-						printf("*bg = 0!\n");
-					}
-				}
-				draw_checkers();
-				break;
-			case 2:
-				draw_hbars1();
-				break;
-			case 3:
-				draw_hbars2();
-				break;
-			case 4:
-				draw_vbars1();
-				break;
-			case 5:
-				draw_vbars2();
-				break;
-			case 6:
-				draw_spectrum();
-				break;
-			case 7:
-				draw_black();
-				break;
-			}
+			if (bg_pattern_n != n) bg_render_pattern(n);
+			memcpy(bg_frame, bg_pattern, sz * 4);
+			bg_has_picture = bg_pattern_pic;
+		}
+		else
+		{
+			memset(bg_frame, 0, sz * 4);
 		}
 
 		if (cfg.logo && logo && !idle)
@@ -4010,11 +4583,11 @@ void video_menu_bg(int n, int idle)
 				dst_h = src_h * dst_w / src_w;
 			}
 
-			if (*bg)
+			if (bg_frame_img)
 			{
 				if (cfg.direct_video && (v_cur.item[5] < 300)) dst_h /= 2;
 
-				imlib_context_set_image(*bg);
+				imlib_context_set_image(bg_frame_img);
 				imlib_blend_image_onto_image(logo, 1,
 					0, 0,         //int source_x, int source_y,
 					src_w, src_h, //int source_width, int source_height,
@@ -4022,10 +4595,6 @@ void video_menu_bg(int n, int idle)
 					dst_w, dst_h  //int destination_width, int destination_height
 				);
 			}
-			else
-			{
-				printf("*bg = 0!\n");
-			}
 		}
 
 		if (logo && idle == 4)
@@ -4041,9 +4610,9 @@ void video_menu_bg(int n, int idle)
 			int x = get_random() % (fb_width - dst_w);
 			int y = get_random() % (fb_height - dst_h);
 
-			if (*bg)
+			if (bg_frame_img)
 			{
-				imlib_context_set_image(*bg);
+				imlib_context_set_image(bg_frame_img);
 				imlib_blend_image_onto_image(logo, 1,
 					0, 0,             //int source_x, int source_y,
 					src_w, src_h,     //int source_width, int source_height,
@@ -4053,27 +4622,10 @@ void video_menu_bg(int n, int idle)
 			}
 		}
 
-		if (curtain)
-		{
-			if (idle > 1 && *bg)
-			{
-				imlib_context_set_image(*bg);
-				int k = (idle == 4) ? 4 : 2;
-				for (int i = 0; i < k; i++)
-				{
-					imlib_blend_image_onto_image(curtain, 1,
-						0, 0,                //int source_x, int source_y,
-						fb_width, fb_height, //int source_width, int source_height,
-						0, 0,                //int destination_x, int destination_y,
-						fb_width, fb_height  //int destination_width, int destination_height
-					);
-				}
-			}
-		}
-		else
-		{
-			printf("curtain = 0!\n");
-		}
+		// the curtain dims the screen when idle
+		if (idle > 1) bg_darken(bg_frame, sz, (idle == 4) ? 4 : 2);
+
+		memcpy((void*)(fb_base + (FB_SIZE * menu_bgn)), bg_frame, sz * 4);
 
 		//test the fb driver
 		//vs_wait();